@@ -1,16 +1,34 @@
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include <assert.h>
 
 #define GLAD_GL_IMPLEMENTATION
 #include <gl45.h>
 
+// Flatten glyph outlines with stbtt_FlattenShape() (Wang's formula) in the rasterizers and the batch, see --bench=flatten
+#define STBTT_FLATTEN_ANALYTIC
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 
 #include <SDL/SDL.h>
 
+// For log_file_t (--tail): read(), inotify and an SSE2 newline scan where available
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LOG_FILE_SSE2
+#endif
+
 
 // 
 // Some utilities and OpenGL helper functions I cooked up over the years
@@ -82,7 +100,7 @@ utf8_iterator_t utf8_next(utf8_iterator_t it) {
 		// Error, we're at an intermediate byte.
 		// Skip all intermediate bytes (or to the end of the buffer) and return the replacement
 		// character.
-		while ( (*(it.buffer) & 0xC0) == 0x80 && it.buffer < it.end )
+		while ( it.buffer < it.end && (*(it.buffer) & 0xC0) == 0x80 )
 			it.buffer++;
 		it.codepoint = 0xFFFD;
 	}
@@ -100,6 +118,16 @@ utf8_iterator_t utf8_first(const char* buffer) {
 	});
 }
 
+// Same as utf8_first() for text that isn't zero terminated (e.g. a line read from a log file). The iterator stops at
+// buffer + length like at a zero terminator.
+utf8_iterator_t utf8_first_n(const char* buffer, size_t length) {
+	return utf8_next((utf8_iterator_t){
+		.buffer = buffer,
+		.end    = buffer + length,
+		.codepoint = 0
+	});
+}
+
 /**
  * Returns a pointer to the zero terminated `malloc()`ed contents of the file. If size is
  * not `NULL` it's target is set to the size of the file not including the zero terminator
@@ -172,73 +200,160 @@ void gl_debug_callback(GLenum src, GLenum type, GLuint id, GLenum severity, GLsi
 	fprintf(stderr, "[GL %s %s %s] %u: %s\n", src_str, type_str, severity_str, id, msg);
 }
 
+// How much of the OpenGL debug output we want (--gl-debug). Logging every message is nice during development but some
+// drivers get slower with debug output enabled and flood the log, so production can turn it off or only log errors.
+// GL_DEBUG_LEVEL_PERF also logs errors but only counts performance warnings (buffer reallocations, shader recompiles,
+// etc.) by id and prints a summary every gl_debug_perf_report_interval frames, see gl_debug_perf_report().
+typedef enum { GL_DEBUG_LEVEL_OFF, GL_DEBUG_LEVEL_ERRORS, GL_DEBUG_LEVEL_PERF, GL_DEBUG_LEVEL_ALL } gl_debug_level_t;
+gl_debug_level_t gl_debug_level = GL_DEBUG_LEVEL_ALL;
+int gl_debug_perf_report_interval = 600;
+
+// Performance warnings counted by id. Without GL_DEBUG_OUTPUT_SYNCHRONOUS the driver may call the callback from any
+// thread, so entries are claimed and counted with atomics. The first message of an id is kept to make the summary
+// readable. When the table is full further ids only go into the overflow count.
+typedef struct {
+	GLuint id_plus_one;  // 0 for empty entries
+	bool   message_ready;
+	int    count, total_count;
+	char   message[160];
+} gl_debug_perf_entry_t;
+
+gl_debug_perf_entry_t gl_debug_perf_entries[64];
+int gl_debug_perf_overflows = 0;
+
+void gl_debug_perf_count(GLuint id, GLchar const* msg) {
+	size_t capacity = sizeof(gl_debug_perf_entries) / sizeof(gl_debug_perf_entries[0]);
+	for (size_t i = 0; i < capacity; i++) {
+		gl_debug_perf_entry_t* entry = &gl_debug_perf_entries[(id + i) % capacity];
+		GLuint expected = 0;
+		if ( !__atomic_compare_exchange_n(&entry->id_plus_one, &expected, id + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ) {
+			if (expected != id + 1)
+				continue;
+		} else {
+			snprintf(entry->message, sizeof(entry->message), "%s", msg);
+			__atomic_store_n(&entry->message_ready, true, __ATOMIC_RELEASE);
+		}
+		__atomic_fetch_add(&entry->count, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	__atomic_fetch_add(&gl_debug_perf_overflows, 1, __ATOMIC_RELAXED);
+}
+
+// Prints the performance warnings counted since the last report (if there were any) and starts counting anew.
+void gl_debug_perf_report(int frames) {
+	size_t capacity = sizeof(gl_debug_perf_entries) / sizeof(gl_debug_perf_entries[0]);
+	int overflows = __atomic_exchange_n(&gl_debug_perf_overflows, 0, __ATOMIC_RELAXED);
+	bool header_printed = false;
+	for (size_t i = 0; i < capacity; i++) {
+		gl_debug_perf_entry_t* entry = &gl_debug_perf_entries[i];
+		if ( __atomic_load_n(&entry->id_plus_one, __ATOMIC_ACQUIRE) == 0 )
+			continue;
+		int count = __atomic_exchange_n(&entry->count, 0, __ATOMIC_RELAXED);
+		if (count == 0)
+			continue;
+		entry->total_count += count;
+		
+		if (!header_printed) {
+			fprintf(stderr, "[GL PERFORMANCE] warnings in the last %d frames:\n", frames);
+			header_printed = true;
+		}
+		const char* message = __atomic_load_n(&entry->message_ready, __ATOMIC_ACQUIRE) ? entry->message : "";
+		fprintf(stderr, "  %6d x %u: %s\n", count, entry->id_plus_one - 1, message);
+	}
+	if (overflows > 0)
+		fprintf(stderr, "  %6d x other ids (table full)\n", overflows);
+}
+
+void gl_debug_perf_callback(GLenum src, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const* msg, void const* user_param) {
+	if (type == GL_DEBUG_TYPE_PERFORMANCE)
+		gl_debug_perf_count(id, msg);
+	else
+		gl_debug_callback(src, type, id, severity, length, msg, user_param);
+}
+
 void gl_init_debug_log() {
+	if (gl_debug_level == GL_DEBUG_LEVEL_OFF) {
+		glDisable(GL_DEBUG_OUTPUT);
+		return;
+	}
+	
 	glEnable(GL_DEBUG_OUTPUT);
 	// Uncomment this if you want to debug into your OpenGL driver by setting a breakpoint into the message callback below
 	//glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-	glDebugMessageCallback(gl_debug_callback, NULL);
-	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+	if (gl_debug_level == GL_DEBUG_LEVEL_ALL) {
+		glDebugMessageCallback(gl_debug_callback, NULL);
+		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+		return;
+	}
+	
+	// Disable everything, then enable errors (and performance warnings). The driver can skip generating messages that
+	// are disabled, so that's cheaper than filtering in the callback.
+	glDebugMessageCallback((gl_debug_level == GL_DEBUG_LEVEL_PERF) ? gl_debug_perf_callback : gl_debug_callback, NULL);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_FALSE);
+	glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, NULL, GL_TRUE);
+	if (gl_debug_level == GL_DEBUG_LEVEL_PERF)
+		glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, NULL, GL_TRUE);
 }
 
-GLuint gl_load_shader_program(const char* vertex_shader_code, const char* fragment_shader_code) {
-	void fprint_shader_source_with_line_numbers(FILE* f, const char* source, int error_line_number) {
-		int line_number = 1;
-		const char *line_start = source;
-		while (*line_start != '\0') {
-			const char* line_end = line_start;
-			while ( !(*line_end == '\n' || *line_end == '\0') )
-				line_end++;
-			
-			// Print the line if no error line number was given (aka print all lines), or if the line number is close
-			// to the given error line number.
-			if ( error_line_number == -1 || abs(line_number - error_line_number) < 5 )
-				fprintf(f, "%3d: %.*s\n", line_number, (int)(line_end - line_start), line_start);
-			line_number++;
-			
-			line_start = (*line_end == '\n') ? line_end + 1 : line_end;
-		}
+void gl_fprint_shader_source_with_line_numbers(FILE* f, const char* source, int error_line_number) {
+	int line_number = 1;
+	const char *line_start = source;
+	while (*line_start != '\0') {
+		const char* line_end = line_start;
+		while ( !(*line_end == '\n' || *line_end == '\0') )
+			line_end++;
+		
+		// Print the line if no error line number was given (aka print all lines), or if the line number is close
+		// to the given error line number.
+		if ( error_line_number == -1 || abs(line_number - error_line_number) < 5 )
+			fprintf(f, "%3d: %.*s\n", line_number, (int)(line_end - line_start), line_start);
+		line_number++;
+		
+		line_start = (*line_end == '\n') ? line_end + 1 : line_end;
 	}
+}
+
+int gl_compile_and_attach_shader(GLenum gl_shader_type, const char* code, GLuint program, const char* shader_type_name) {
+	GLuint shader = glCreateShader(gl_shader_type);
+	glShaderSource(shader, 1, (const char*[]){ code }, NULL);
+	glCompileShader(shader);
 	
-	int compile_and_attach_shader(GLenum gl_shader_type, const char* code, GLuint program, const char* shader_type_name) {
-		GLuint shader = glCreateShader(gl_shader_type);
-		glShaderSource(shader, 1, (const char*[]){ code }, NULL);
-		glCompileShader(shader);
-		
-		GLint is_compiled = GL_FALSE;
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
-		if (is_compiled) {
-			glAttachShader(program, shader);
-			glDeleteShader(shader);
-			return GL_TRUE;
-		} else {
-			GLint log_size = 0;
-			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
-			char* log_buffer = malloc(log_size);
-				glGetShaderInfoLog(shader, log_size, NULL, log_buffer);
-				fprintf(stderr, "ERROR on compiling %s:\n%s\n", shader_type_name, log_buffer);
-				
-				// Try to extract the line number from the first error.
-				// Example error from Linux AMD driver: "0:136(45): error: no function with name 'color_srgb_to_linear'".
-				// Not sure what the first "0" is supposed to mean. On nVidia it seems to be the source string index in case that glShaderSource()
-				// is passed multiple strings. But on AMD this seems to stay 0 in that case. So in case of multiple source strings we would have
-				// to concat everything together into one string.
-				// If sscanf() fails it just leaves -1 in line_number and fprint_shader_source_with_line_numbers() then ignores that argument.
-				int line_number = -1;
-				sscanf(log_buffer, "%*u:%u", &line_number);
-				
-				fprintf(stderr, "Shader source:\n");
-				fprint_shader_source_with_line_numbers(stderr, code, line_number);
-			free(log_buffer);
+	GLint is_compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
+	if (is_compiled) {
+		glAttachShader(program, shader);
+		glDeleteShader(shader);
+		return GL_TRUE;
+	} else {
+		GLint log_size = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
+		char* log_buffer = malloc(log_size);
+			glGetShaderInfoLog(shader, log_size, NULL, log_buffer);
+			fprintf(stderr, "ERROR on compiling %s:\n%s\n", shader_type_name, log_buffer);
 			
-			glDeleteShader(shader);
-			return GL_FALSE;
-		}
+			// Try to extract the line number from the first error.
+			// Example error from Linux AMD driver: "0:136(45): error: no function with name 'color_srgb_to_linear'".
+			// Not sure what the first "0" is supposed to mean. On nVidia it seems to be the source string index in case that glShaderSource()
+			// is passed multiple strings. But on AMD this seems to stay 0 in that case. So in case of multiple source strings we would have
+			// to concat everything together into one string.
+			// If sscanf() fails it just leaves -1 in line_number and gl_fprint_shader_source_with_line_numbers() then ignores that argument.
+			int line_number = -1;
+			sscanf(log_buffer, "%*u:%u", &line_number);
+			
+			fprintf(stderr, "Shader source:\n");
+			gl_fprint_shader_source_with_line_numbers(stderr, code, line_number);
+		free(log_buffer);
+		
+		glDeleteShader(shader);
+		return GL_FALSE;
 	}
-	
+}
+
+GLuint gl_load_shader_program(const char* vertex_shader_code, const char* fragment_shader_code) {
 	GLuint program = glCreateProgram();
-	if ( ! compile_and_attach_shader(GL_VERTEX_SHADER, vertex_shader_code, program, "vertex shader") )
+	if ( ! gl_compile_and_attach_shader(GL_VERTEX_SHADER, vertex_shader_code, program, "vertex shader") )
 		goto fail;
-	if ( ! compile_and_attach_shader(GL_FRAGMENT_SHADER, fragment_shader_code, program, "fragment shader") )
+	if ( ! gl_compile_and_attach_shader(GL_FRAGMENT_SHADER, fragment_shader_code, program, "fragment shader") )
 		goto fail;
 	
 	// Note: Error reporting needed since linker errors (like missing local group size) are not reported as OpenGL errors
@@ -256,9 +371,38 @@ GLuint gl_load_shader_program(const char* vertex_shader_code, const char* fragme
 		free(log_buffer);
 		
 		fprintf(stderr, "Vertex source code:\n");
-		fprint_shader_source_with_line_numbers(stderr, vertex_shader_code, -1);
+		gl_fprint_shader_source_with_line_numbers(stderr, vertex_shader_code, -1);
 		fprintf(stderr, "Fragment shader code:\n");
-		fprint_shader_source_with_line_numbers(stderr, fragment_shader_code, -1);
+		gl_fprint_shader_source_with_line_numbers(stderr, fragment_shader_code, -1);
+		
+		goto fail;
+	}
+	
+	fail:
+		glDeleteProgram(program);
+		return 0;
+}
+
+GLuint gl_load_compute_shader_program(const char* compute_shader_code) {
+	GLuint program = glCreateProgram();
+	if ( ! gl_compile_and_attach_shader(GL_COMPUTE_SHADER, compute_shader_code, program, "compute shader") )
+		goto fail;
+	
+	glLinkProgram(program);
+	GLint is_linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+	if (is_linked) {
+		return program;
+	} else {
+		GLint log_size = GL_FALSE;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
+		char* log_buffer = malloc(log_size);
+			glGetProgramInfoLog(program, log_size, NULL, log_buffer);
+			fprintf(stderr, "ERROR on linking shader:\n%s\n", log_buffer);
+		free(log_buffer);
+		
+		fprintf(stderr, "Compute shader code:\n");
+		gl_fprint_shader_source_with_line_numbers(stderr, compute_shader_code, -1);
 		
 		goto fail;
 	}
@@ -270,489 +414,4982 @@ GLuint gl_load_shader_program(const char* vertex_shader_code, const char* fragme
 
 
 //
-// Main program. Only renders one string.
+// Font metrics and text measurement (no glyph atlas, no GPU)
 //
 
-int main(int, char**) {
-	SDL_Init(SDL_INIT_VIDEO);
-	atexit(SDL_Quit);
-	
-	
-	// Init window and OpenGL context
-	int window_width = 400, window_height = 100;
-	SDL_Window* window = SDL_CreateWindow("Minimal subpixel font rendering", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
-	
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-	SDL_GLContext gl_ctx = SDL_GL_CreateContext(window);
-	SDL_GL_SetSwapInterval(1);
+// Everything layout needs to know about a font. All metrics are kept in font units (unscaled) so the same font_t
+// works for every font size. The glyph indices, advances and kerning pairs of ASCII are looked up once in
+// font_init() so layout doesn't have to search the cmap, hmtx and kern tables of the font file for every character.
+// ascii_pair_advances[prev][c] is the kerning between prev and c plus the advance of c. Row 0 is used at the start
+// of a line (no previous character) and just contains the advances. That way measuring ASCII text needs one table
+// lookup per byte.
+// The glyph infos cache what rasterizing a glyph needs from the glyph header and the hmtx table. They're in font units
+// too, so each glyph is looked up once no matter in how many sizes it's rasterized, see font_glyph_info().
+typedef struct {
+	int16_t x0, y0, x1, y1;  // glyph box from stbtt_GetGlyphBox(), all 0 for glyphs without shape (e.g. space)
+	int16_t left_side_bearing;
+	bool    decoded;
+	bool    coverage_measured;
+	uint8_t average_coverage;  // see font_glyph_coverage()
+} glyph_info_t;
+
+typedef struct {
+	stbtt_fontinfo info;
+	int ascent, descent, line_gap;
+	// Top of the underline and strikethrough strokes relative to the baseline (positive is up) and their thickness
+	int underline_position, underline_thickness;
+	int strikethrough_position, strikethrough_thickness;
+	int x_height;  // height of lowercase letters above the baseline
 	
-	gladLoadGL((GLADloadfunc)SDL_GL_GetProcAddress); // Expects a function that returns a function pointer, but SDL_GL_GetProcAddress() just returns a void pointer. Hence the cast.
-	gl_init_debug_log();
+	int     ascii_glyph_indices[128];
+	int16_t ascii_advances[128];
+	int16_t ascii_pair_advances[128][128];
 	
+	glyph_info_t* glyph_infos;  // one per glyph of the font, filled in on first use
+} font_t;
+
+bool font_init(font_t* font, const void* font_data) {
+	if ( !stbtt_InitFont(&font->info, font_data, 0) )
+		return false;
+	stbtt_GetFontVMetrics(&font->info, &font->ascent, &font->descent, &font->line_gap);
 	
-	// Setup stuff to render rectangles with OpenGL.
-	// Use instancing to render the rects. One VBO that contains the data for a single rectangle instance, and another
-	// one with all the per-instance data (stuff that is unique for each rect).
-	// First setup the vertex and fragment shader, then setup the buffers and their formats and finally the vertex array
-	// object that reads the buffers and feeds that data into the vertex shader.
-	GLuint shader_program = gl_load_shader_program(
-		// Vertex shader
-			"#version 450 core\n"
-			"\n"
-			"layout(location = 0) uniform vec2 half_viewport_size;\n"
-			"\n"
-			"layout(location = 0) in uvec2 ltrb_index;\n"
-			"layout(location = 1) in vec4  rect_ltrb;\n"
-			"layout(location = 2) in vec4  rect_tex_ltrb;\n"
-			"layout(location = 3) in vec4  rect_color;\n"
-			"layout(location = 4) in float rect_subpixel_shift;\n"
-			"\n"
-			"out vec2  tex_coords;\n"
-			"out vec4  color;\n"
-			"out float subpixel_shift;\n"
-			"\n"
-			"void main() {\n"
-			"	// Convert color to pre-multiplied alpha\n"
-			"	color = vec4(rect_color.rgb * rect_color.a, rect_color.a);\n"
-			"	\n"
-			"	vec2 pos   = vec2(rect_ltrb[ltrb_index.x],     rect_ltrb[ltrb_index.y]);\n"
-			"	tex_coords = vec2(rect_tex_ltrb[ltrb_index.x], rect_tex_ltrb[ltrb_index.y]);\n"
-			"	subpixel_shift = rect_subpixel_shift;"
-			"	\n"
-			"	vec2 axes_flip  = vec2(1, -1);  // to flip y axis from bottom-up (OpenGL standard) to top-down (normal for UIs)\n"
-			"	vec2 pos_in_ndc = (pos / half_viewport_size - 1.0) * axes_flip;\n"
-			"	gl_Position = vec4(pos_in_ndc, 0, 1);\n"
-			"}\n"
-		,
-		// Fragment shader
-			"#version 450 core\n"
-			"\n"
-			"layout(location = 1) uniform float coverage_adjustment;\n"
-			"\n"
-			"// Note: binding is the number of the texture unit, not the uniform location. We don't care about the uniform location\n"
-			"// since we already set the texture unit via the binding here and don't have to set it via OpenGL as a uniform.\n"
-			"layout(binding = 0) uniform sampler2DRect glyph_atlas;\n"
-			"\n"
-			"in      vec2  tex_coords;\n"
-			"in flat vec4  color;\n"
-			"in flat float subpixel_shift;\n"
-			"\n"
-			"// Use dual-source blending to blend individual color components with different weights instead of just one weight (alpha) for the entire pixel\n"
-			"layout(location = 0, index = 0) out vec4 fragment_color;\n"
-			"layout(location = 0, index = 1) out vec4 blend_weights;\n"
-			"\n"
-			"void main() {\n"
-			"	// Shift the subpixel weights according to the subpixel position of this specific glyph (the atlas only contains the glyph with a subpixel shift of 0)\n"
-			"	// Based on the shifting code from the paper Higher Quality 2D Text Rendering by Nicolas P. Rougier, Listing 2. Subpixel positioning fragment shader, from https://jcgt.org/published/0002/01/04/paper.pdf\n"
-			"	vec3 current  = texelFetch(glyph_atlas, ivec2(tex_coords) + ivec2( 0, 0)).rgb;\n"
-			"	vec3 previous = texelFetch(glyph_atlas, ivec2(tex_coords) + ivec2(-1, 0)).rgb;\n"
-			"	float r = current.r, g = current.g, b = current.b;\n"
-			"	if (subpixel_shift <= 1.0/3.0) {\n"
-			"		float z = 3.0 * subpixel_shift;\n"
-			"		r = mix(current.r, previous.b, z);\n"
-			"		g = mix(current.g, current.r, z);\n"
-			"		b = mix(current.b, current.g, z);\n"
-			"	} else if (subpixel_shift <= 2.0/3.0) {\n"
-			"		float z = 3.0 * subpixel_shift - 1.0;\n"
-			"		r = mix(previous.b, previous.g, z);\n"
-			"		g = mix(current.r,  previous.b, z);\n"
-			"		b = mix(current.g,  current.r,  z);\n"
-			"	} else if (subpixel_shift < 1.0) {\n"
-			"		float z = 3.0 * subpixel_shift - 2.0;\n"
-			"		r = mix(previous.g, previous.r, z);\n"
-			"		g = mix(previous.b, previous.g, z);\n"
-			"		b = mix(current.r,  previous.b, z);\n"
-			"	}\n"
-			"	vec3 pixel_coverages = vec3(r, g, b);\n"
-			"	\n"
-			"	// Coverage adjustment variant 1: Increase or decrease the slope of the gradient by a linear factor.\n"
-			"	// Gives sharper results than variant 2 but overdoing it degrades quality quickly.\n"
-			"	// coverage_adjustment = 0: does nothing\n"
-			"	// coverage_adjustment = +0.2: makes the glyphs slightly bolder (multiply slope by 1.2 with coverage 0 as reference point)\n"
-			"	// coverage_adjustment = -0.2: makes them slightly thinner (multiply slope by 1.2 with coverage 1 as reference point)\n"
-			"	if (coverage_adjustment >= 0) {\n"
-			"		pixel_coverages = min(pixel_coverages * (1 + coverage_adjustment), 1);\n"
-			"	} else {\n"
-			"		pixel_coverages = max((1 - (1 - pixel_coverages) * (1 + -coverage_adjustment)), 0);\n"
-			"	}\n"
-			"	\n"
-			"	// Coverage adjustment variant 2: Use a power function to distort the coverages toward higher or lower values.\n"
-			"	// Note: The code might look similar to gamma correction \n"
-			"	// coverage_adjustment = 1.0: does nothing\n"
-			"	// coverage_adjustment = 0.80: makes the glyphs slightly bolder, nice for source code, etc.\n"
-			"	// coverage_adjustment = 1.20: makes them slightly thinner, but can make bright text on bright backgrounds harder to read.\n"
-			"	// coverage_adjustment = 2.2 and 0.45: Gives you the look of text distorted by gamma correction (2.2 for black on white, 0.45 = 1/2.2 for white on black).\n"
-			"	// Comment variant 1 and uncomment this one to give it a try.\n"
-			"	//pixel_coverages = pow(pixel_coverages, vec3(coverage_adjustment));\n"
-			"	\n"
-			"	// Use dual-source blending to blend each subpixel (color channel) individually.\n"
-			"	// Note: The blend equation is setup for pre-multiplied alpha blending. color is already pre-multiplied in the vertex shader.\n"
-			"	// color * vec4(pixel_coverages, 1) gives us a color mask where all subpixels of the glyph have the proper values for the text\n"
-			"	// color and all other subpixels are 0. This is what we add to the framebuffer (since color is pre-multiplied).\n"
-			"	// The blend weights are then set to remove the portion of the background we no longer want. The blend equation does a 1 - alpha\n"
-			"	// for each channel so here we set the weights to the part that the glyph color contributes. But only where the glyph actually"
-			"	// covers the subpixels, thats what color.a * pixel_coverages does.\n"
-			"	fragment_color = color * vec4(pixel_coverages, 1);\n"
-			"	blend_weights = vec4(color.a * pixel_coverages, color.a);\n"
-			"}\n"
-	);
-	if (!shader_program)
-		return 1;
+	// stb_truetype doesn't read the underline and strikethrough metrics, so get them from the "post" and "OS/2" tables
+	// ourselves. Use something derived from the ascent if the font doesn't have those tables.
+	uint8_t* data = font->info.data;
+	uint32_t post = stbtt__find_table(data, font->info.fontstart, "post");
+	uint32_t os2  = stbtt__find_table(data, font->info.fontstart, "OS/2");
+	font->underline_position      = post ? ttSHORT(data + post + 8)  : -font->ascent / 8;
+	font->underline_thickness     = post ? ttSHORT(data + post + 10) : font->ascent / 12;
+	font->strikethrough_thickness = os2  ? ttSHORT(data + os2  + 26) : font->ascent / 12;
+	font->strikethrough_position  = os2  ? ttSHORT(data + os2  + 28) : font->ascent / 3;
+	// sxHeight is only in version 2 and later of the OS/2 table, otherwise take the top of the "x" glyph
+	int x_y1 = 0;
+	stbtt_GetGlyphBox(&font->info, stbtt_FindGlyphIndex(&font->info, 'x'), NULL, NULL, NULL, &x_y1);
+	font->x_height = (os2 && ttUSHORT(data + os2) >= 2) ? ttSHORT(data + os2 + 86) : x_y1;
 	
-	// Small fixed buffer that just contains the 6 vertices (two triangles) making up one rectange.
-	// Note: ltrb is short for left, top, right , bottom and those coordinates are used to describe a rectangle on the
-	// screen. Requires only half the data as 4 complete points. Thats mostly for rect_instance_t below but here we use
-	// the same convention.
-	struct { uint16_t ltrb_index_x, ltrb_index_y; } rect_vertices[] = {
-		{ 0, 1 }, // left  top
-		{ 0, 3 }, // left  bottom
-		{ 2, 1 }, // right top
-		{ 0, 3 }, // left  bottom
-		{ 2, 3 }, // right bottom
-		{ 2, 1 }, // right top
-	};
-	GLuint rect_vertices_vbo = 0;
-	glCreateBuffers(1, &rect_vertices_vbo);
-	glNamedBufferStorage(rect_vertices_vbo, sizeof(rect_vertices), rect_vertices, 0);
+	for (int c = 0; c < 128; c++) {
+		int advance = 0;
+		font->ascii_glyph_indices[c] = stbtt_FindGlyphIndex(&font->info, c);
+		stbtt_GetGlyphHMetrics(&font->info, font->ascii_glyph_indices[c], &advance, NULL);
+		font->ascii_advances[c] = advance;
+	}
+	for (int prev = 0; prev < 128; prev++) {
+		for (int c = 0; c < 128; c++) {
+			int kerning = (prev == 0) ? 0 : stbtt_GetGlyphKernAdvance(&font->info, font->ascii_glyph_indices[prev], font->ascii_glyph_indices[c]);
+			font->ascii_pair_advances[prev][c] = kerning + font->ascii_advances[c];
+		}
+	}
 	
-	// Data format and CPU-side buffer for the per-rectangle information.
-	// Here we just use one fixed size rect_buffer for demonstration purposes.
-	typedef struct { int16_t left, top, right, bottom; } int16_rect_t;
-	typedef struct { uint8_t r, g, b, a; } color_t;
-	typedef struct {
-		int16_rect_t pos;
-		int16_rect_t tex_coords;
-		color_t      color;
-		float        subpixel_shift;
-	} rect_instance_t;
+	font->glyph_infos = calloc(font->info.numGlyphs, sizeof(font->glyph_infos[0]));
+	return true;
+}
+
+void font_destroy(font_t* font) {
+	free(font->glyph_infos);
+}
+
+/**
+ * Returns the box and left side bearing of a glyph. They're read from the font the first time a glyph is used and
+ * after that come from the cache in the font_t. Pass the box to stbtt_GetBitmapBoxForGlyphBox() to get the bitmap box
+ * for a scale and to the *WithBox() functions of stb_truetype so they don't look it up again.
+ */
+const glyph_info_t* font_glyph_info(const font_t* font, int glyph_index) {
+	glyph_info_t* glyph_info = &font->glyph_infos[glyph_index];
+	if (!glyph_info->decoded) {
+		int x0 = 0, y0 = 0, x1 = 0, y1 = 0, left_side_bearing = 0;
+		stbtt_GetGlyphBox(&font->info, glyph_index, &x0, &y0, &x1, &y1);
+		stbtt_GetGlyphHMetrics(&font->info, glyph_index, NULL, &left_side_bearing);
+		*glyph_info = (glyph_info_t){ x0, y0, x1, y1, left_side_bearing, true, false, 0 };
+	}
+	return glyph_info;
+}
+
+// Size font_glyph_coverage() rasterizes glyphs at. Large enough that thin strokes don't round away.
+#define GLYPH_COVERAGE_REFERENCE_SIZE_PX 32
+
+/**
+ * Returns how much of its glyph box a glyph covers (0 to 1), e.g. 0.35 for an "o". Measured once per glyph by
+ * rasterizing it at a reference size without any filtering. The ratio hardly depends on the size, so it's used for
+ * text that is drawn too small to read, see glyph_run_emit_greeked(). 0 for glyphs without shape.
+ */
+float font_glyph_coverage(const font_t* font, int glyph_index) {
+	glyph_info_t* glyph_info = &font->glyph_infos[glyph_index];
+	font_glyph_info(font, glyph_index);
+	if (!glyph_info->coverage_measured) {
+		float scale = stbtt_ScaleForMappingEmToPixels(&font->info, GLYPH_COVERAGE_REFERENCE_SIZE_PX);
+		int width = 0, height = 0;
+		uint8_t* bitmap = stbtt_GetGlyphBitmap(&font->info, scale, scale, glyph_index, &width, &height, NULL, NULL);
+		int64_t coverage_sum = 0;
+		for (int i = 0; i < width * height; i++)
+			coverage_sum += bitmap[i];
+		stbtt_FreeBitmap(bitmap, NULL);
+		glyph_info->average_coverage = (width * height > 0) ? round(coverage_sum / (double)(width * height)) : 0;
+		glyph_info->coverage_measured = true;
+	}
+	return glyph_info->average_coverage / 255.0f;
+}
+
+float font_scale_for_size(const font_t* font, float font_size_pt) {
+	// From "Font Size in Pixels or Points" in stb_truetype.h
+	// > Windows traditionally uses a convention that there are 96 pixels per inch, thus making 'inch'
+	// > measurements have nothing to do with inches, and thus effectively defining a point to be 1.333 pixels.
+	float font_size_px = font_size_pt * 1.333333;
+	return stbtt_ScaleForMappingEmToPixels(&font->info, font_size_px);
+}
+
+typedef struct {
+	float width, height;  // width of the longest line (pen advance, not ink bounds) and line_count * line height, in pixels
+	float baseline;       // distance from the top of the first line to its baseline, in pixels
+	int   line_count;
+} text_extents_t;
+
+/**
+ * Classifies 8 bytes at once (SWAR): Returns how many bytes at the start of the word (in memory order) are printable
+ * ASCII (32 to 127), 8 if all are. Adding 0x60 sets the high bit of exactly those bytes and masking with ~word drops
+ * the ones that had it set already (128 and up). A carry only goes from a byte that isn't printable to the next one,
+ * so the bytes before the first one that isn't printable are always classified correctly. Assumes little endian.
+ */
+static inline int ascii_printable_prefix_8(uint64_t word) {
+	const uint64_t high_bits = 0x8080808080808080;
+	uint64_t not_printable = ~((word + 0x6060606060606060) & ~word) & high_bits;
+	return not_printable ? __builtin_ctzll(not_printable) / 8 : 8;
+}
+
+/**
+ * Calculates the extents of `text_length` bytes of UTF-8 text (or up to the first zero terminator) without rasterizing
+ * any glyphs, touching the glyph atlas or allocating memory. Uses the same metrics, kerning and line breaks ('\n')
+ * as the rendering code in `main()`.
+ *
+ * The pen position is summed up in font units and only scaled at the end of each line. ASCII goes through the cached
+ * `ascii_pair_advances` table, everything else is decoded with `utf8_next()` and looked up in the font directly.
+ */
+text_extents_t text_measure(const font_t* font, float font_size_pt, const char* text, size_t text_length) {
+	float font_scale  = font_scale_for_size(font, font_size_pt);
+	float line_height = (font->ascent - font->descent + font->line_gap) * font_scale;
 	
-	int rect_buffer_filled = 0;
-	rect_instance_t rect_buffer[255];
+	// Find the terminator once, after that every byte up to end can be read without checking for it
+	const uint8_t* pos = (const uint8_t*)text;
+	const uint8_t* end = memchr(text, '\0', text_length);
+	if (!end)
+		end = pos + text_length;
 	
-	GLuint rect_instances_vbo = 0;
-	glCreateBuffers(1, &rect_instances_vbo);
+	int64_t line_width = 0, max_line_width = 0;
+	int line_count = 1;
+	// prev is the previous ASCII char (0 at line start) or 128 + the previous glyph index for all other codepoints
+	int prev = 0;
+	while (pos < end) {
+		// Hot loop for runs of printable ASCII: Classify 8 bytes at once (see ascii_printable_prefix_8()) and then do
+		// the table lookups for the printable ones without any further checks. 4 independent sums let the CPU overlap
+		// the lookups. The last few bytes of the text are done byte by byte.
+		if (prev < 128) {
+			const uint8_t* run_start = pos;
+			int64_t w0 = 0, w1 = 0, w2 = 0, w3 = 0;
+			uint8_t run_prev = prev;
+			while (end - pos >= 8) {
+				uint64_t word = 0;
+				memcpy(&word, pos, sizeof(word));
+				int printable = ascii_printable_prefix_8(word);
+				if (printable == 8) {
+					uint8_t c0 = pos[0], c1 = pos[1], c2 = pos[2], c3 = pos[3], c4 = pos[4], c5 = pos[5], c6 = pos[6], c7 = pos[7];
+					w0 += font->ascii_pair_advances[run_prev][c0];
+					w1 += font->ascii_pair_advances[c0][c1];
+					w2 += font->ascii_pair_advances[c1][c2];
+					w3 += font->ascii_pair_advances[c2][c3];
+					w0 += font->ascii_pair_advances[c3][c4];
+					w1 += font->ascii_pair_advances[c4][c5];
+					w2 += font->ascii_pair_advances[c5][c6];
+					w3 += font->ascii_pair_advances[c6][c7];
+					run_prev = c7;
+					pos += 8;
+				} else {
+					for (int i = 0; i < printable; i++) {
+						w0 += font->ascii_pair_advances[run_prev][pos[i]];
+						run_prev = pos[i];
+					}
+					pos += printable;
+					break;
+				}
+			}
+			while (pos < end && (uint8_t)(*pos - 32) < 96) {
+				w0 += font->ascii_pair_advances[run_prev][*pos];
+				run_prev = *pos;
+				pos++;
+			}
+			if (pos != run_start) {
+				line_width += w0 + w1 + w2 + w3;
+				prev = run_prev;
+				continue;
+			}
+		}
+		
+		uint8_t c = *pos;
+		if (c == '\n') {
+			if (line_width > max_line_width)
+				max_line_width = line_width;
+			line_width = 0;
+			line_count++;
+			prev = 0;
+			pos++;
+		} else if (c < 128 && prev < 128) {
+			line_width += font->ascii_pair_advances[prev][c];
+			prev = c;
+			pos++;
+		} else {
+			// Slow path for non-ASCII codepoints or ASCII after a non-ASCII codepoint
+			utf8_iterator_t it = utf8_next((utf8_iterator_t){ .buffer = (const char*)pos, .end = (const char*)end });
+			int glyph_index = (c < 128) ? font->ascii_glyph_indices[c] : stbtt_FindGlyphIndex(&font->info, it.codepoint);
+			int prev_glyph_index = (prev < 128) ? font->ascii_glyph_indices[prev] : prev - 128;
+			
+			int advance = 0;
+			stbtt_GetGlyphHMetrics(&font->info, glyph_index, &advance, NULL);
+			if (prev != 0)
+				line_width += stbtt_GetGlyphKernAdvance(&font->info, prev_glyph_index, glyph_index);
+			line_width += advance;
+			
+			prev = (c < 128) ? c : 128 + glyph_index;
+			pos = (const uint8_t*)it.buffer;
+		}
+	}
+	if (line_width > max_line_width)
+		max_line_width = line_width;
 	
-	// Create the vertex array object (VAO) that reads one entry from rect_vertices_vbo for each vertex and one entry
+	return (text_extents_t){
+		.width      = max_line_width * font_scale,
+		.height     = line_count * round(line_height),
+		.baseline   = round(font->ascent * font_scale),
+		.line_count = line_count
+	};
+}
+
+
+//
+// Glyph atlas and glyph runs
+//
+
+// Data format for the per-rectangle information that is uploaded to the GPU. See the vertex array object setup in main().
+// Note: ltrb is short for left, top, right , bottom and those coordinates are used to describe a rectangle on the
+// screen. Requires only half the data as 4 complete points.
+typedef struct { int16_t left, top, right, bottom; } int16_rect_t;
+typedef struct { uint8_t r, g, b, a; } color_t;
+typedef struct {
+	int16_rect_t pos;
+	int16_rect_t tex_coords;
+	color_t      color;
+	float        subpixel_shift;
+	uint16_t     kind;        // RECT_GLYPH or RECT_SOLID
+	uint16_t     clip_index;  // 0 for no clipping, otherwise an index into the clip rects (see CLIP_RECT_CAPACITY)
+} rect_instance_t;
+
+// Glyphs read their coverages from the glyph atlas (tex_coords and subpixel_shift). Solid rects ignore both and just
+// fill their area with color. They're drawn in the same batch as the glyphs, e.g. for underlines, selections or cell
+// backgrounds, and are blended in the order they appear in the rect buffer.
+#define RECT_GLYPH 0
+#define RECT_SOLID 1
+
+// The same constants for the shaders, put right after their #version line. That way the shaders can't get out of sync
+// with the values used on the CPU.
+#define RECT_KIND_VALUE_STRING(value) #value
+#define RECT_KIND_STRING(kind) RECT_KIND_VALUE_STRING(kind)
+#define RECT_KIND_SHADER_DEFINES "#define RECT_GLYPH " RECT_KIND_STRING(RECT_GLYPH) "\n#define RECT_SOLID " RECT_KIND_STRING(RECT_SOLID) "\n"
+
+// Rects can be clipped to one of the clip rects in a uniform buffer (one vec4 of left, top, right, bottom in pixels
+// each). The vertex shader trims the rect to its clip rect and moves the tex coords along, so rects of differently
+// clipped panels can be drawn with the same draw call instead of one draw with glScissor() per panel. Entry 0 is
+// unused since clip_index 0 means no clipping. 1024 vec4 are 16 KiB, the minimum GL_MAX_UNIFORM_BLOCK_SIZE.
+#define CLIP_RECT_CAPACITY 1024
+
+// A simple mockup of an atlas allocator that you would use to allocate and manage small glyph rectangles in the
+// atlas texture. Glyphs are looked up by font, glyph index and scale in a small hash table (open addressing with
+// linear probing) that stores the relevant glyph data, e.g. where the glyph is in the atlas texture.
+// Additionally we just make each atlas item 32x32 pixel in size and hand them out left to right and top to bottom
+// as glyphs are rasterized.
+// You wouldn't want such a lousy atlas allocator for anything real. It can't evict glyphs and it wastes
+// phenomenal amounts of space. But it's ok for demonstration purposes while being simple enough to not distract
+// from the font rendering itself.
+// It uses a GL_TEXTURE_RECTANGLE so we can use pixel coordinates instead of coordinates in the range 0..1. But that
+// doesn't really matter since we use texelFetch() in the fragment shader and that works on integer coordinates
+// anyway. Rectangle textures can't have mipmaps but we don't want them for the glyph atlas.
+typedef struct {
+	const font_t* font;  // NULL for unused entries in the hash table
+	float         font_scale;
+	int           glyph_index;
+	
+	int16_rect_t tex_coords;  // all -1 for glyphs without visual representation (e.g. space)
+	int          distance_from_baseline_to_top_px;
+	float        left_side_bearing_px;
+} glyph_atlas_item_t;
+
+#define GLYPH_ATLAS_ITEM_SIZE 32
+#define GLYPH_ATLAS_HASH_TABLE_SIZE 1024  // initial size, the hash table grows as needed
+
+// The atlas can be shared by several OpenGL contexts (e.g. one per window) as long as they share objects. The glyph
+// data is in this struct so each glyph is rasterized and uploaded exactly once. Before drawing with the atlas in a
+// context call glyph_atlas_sync() so that context waits for uploads done by other contexts.
+typedef struct {
+	GLuint   texture;
+	uint32_t width, height;
+	int      items_used;
+	// Every glyph takes a slot in the hash table, also the ones without visual representation that don't use an atlas
+	// item. So slots_used is counted separately from items_used.
+	glyph_atlas_item_t* hash_table;
+	uint32_t            hash_table_size, slots_used;
+	
+	bool          uploads_pending;       // glyphs were uploaded since the last glyph_atlas_sync()
+	GLsync        upload_fence;          // signaled when the last uploads are done
+	SDL_GLContext upload_fence_context;  // the context that did those uploads
+} glyph_atlas_t;
+
+void glyph_atlas_init(glyph_atlas_t* atlas, uint32_t width, uint32_t height) {
+	memset(atlas, 0, sizeof(*atlas));
+	atlas->width = width;
+	atlas->height = height;
+	atlas->hash_table_size = GLYPH_ATLAS_HASH_TABLE_SIZE;
+	atlas->hash_table = calloc(atlas->hash_table_size, sizeof(atlas->hash_table[0]));
+	glCreateTextures(GL_TEXTURE_RECTANGLE, 1, &atlas->texture);
+	glTextureStorage2D(atlas->texture, 1, GL_RGB8, width, height);
+}
+
+void glyph_atlas_destroy(glyph_atlas_t* atlas) {
+	if (atlas->upload_fence)
+		glDeleteSync(atlas->upload_fence);
+	glDeleteTextures(1, &atlas->texture);
+	free(atlas->hash_table);
+}
+
+// Number of atlas items that can still be handed out
+int glyph_atlas_free_items(const glyph_atlas_t* atlas) {
+	int capacity = (atlas->width / GLYPH_ATLAS_ITEM_SIZE) * (atlas->height / GLYPH_ATLAS_ITEM_SIZE);
+	return capacity - atlas->items_used;
+}
+
+// Forgets all glyphs so the whole atlas can be handed out again. The texture is left as is, new glyphs overwrite their
+// items. Draw everything that uses the atlas before clearing it. Anything that kept tex_coords of atlas items around
+// (e.g. glyph_run_templates_t or gpu_text_layout_t) has to rebuild them afterwards.
+void glyph_atlas_clear(glyph_atlas_t* atlas) {
+	memset(atlas->hash_table, 0, atlas->hash_table_size * sizeof(atlas->hash_table[0]));
+	atlas->items_used = 0;
+	atlas->slots_used = 0;
+}
+
+/**
+ * Call before drawing with the atlas texture. Other contexts can't see texture uploads of a context until they
+ * waited for them. So if glyphs were uploaded in the current context put a fence behind them. Otherwise wait (on the
+ * GPU, the CPU doesn't block) for the uploads done in another context. Rebinding the texture after the wait (e.g.
+ * with glBindTextureUnit()) then makes the new contents visible.
+ */
+void glyph_atlas_sync(glyph_atlas_t* atlas) {
+	SDL_GLContext current_context = SDL_GL_GetCurrentContext();
+	bool fence_from_other_context = atlas->upload_fence && atlas->upload_fence_context != current_context;
+	
+	if (fence_from_other_context)
+		glWaitSync(atlas->upload_fence, 0, GL_TIMEOUT_IGNORED);
+	
+	if (atlas->uploads_pending) {
+		// The new fence comes after the wait above, so it also covers the uploads of the other context
+		if (atlas->upload_fence)
+			glDeleteSync(atlas->upload_fence);
+		atlas->upload_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		atlas->upload_fence_context = current_context;
+		atlas->uploads_pending = false;
+		// Other contexts can only wait for a fence that has been flushed
+		glFlush();
+	}
+}
+
+// Padding around each glyph in the atlas. The glyph is shifted by up to 1 pixel to the right by the fragment shader
+// for subpixel positioning and the FreeType LCD filter below spreads the coverage of each subpixel up to 2 subpixels
+// in each direction.
+const int horizontal_filter_padding = 1, subpixel_positioning_left_padding = 1;
+
+/**
+ * Looks for the glyph in the hash table of the atlas. Returns the slot of its item or, if the glyph isn't in the atlas
+ * yet, the empty slot where its item should go.
+ */
+uint32_t glyph_atlas_find(const glyph_atlas_t* atlas, const font_t* font, float font_scale, int glyph_index) {
+	// The scale is part of the key so different font sizes get different items.
+	uint32_t font_scale_bits = 0;
+	memcpy(&font_scale_bits, &font_scale, sizeof(font_scale_bits));
+	uint32_t hash = (uint32_t)glyph_index * 2654435761u ^ font_scale_bits * 40503u ^ (uint32_t)(uintptr_t)font;
+	uint32_t slot = hash % atlas->hash_table_size;
+	while (atlas->hash_table[slot].font != NULL) {
+		const glyph_atlas_item_t* item = &atlas->hash_table[slot];
+		if (item->font == font && item->font_scale == font_scale && item->glyph_index == glyph_index)
+			break;
+		slot = (slot + 1) % atlas->hash_table_size;
+	}
+	return slot;
+}
+
+/**
+ * Puts a new item into the hash table and returns where it ended up. The table is kept at most half full, otherwise
+ * the linear probing gets slow (and would never end in a full table). When it's half full it's doubled in size and all
+ * items are put into the new table. So items returned by glyph_atlas_get() are only valid until the next new glyph.
+ */
+glyph_atlas_item_t* glyph_atlas_insert(glyph_atlas_t* atlas, glyph_atlas_item_t item) {
+	if (atlas->slots_used + 1 > atlas->hash_table_size / 2) {
+		glyph_atlas_item_t* old_table = atlas->hash_table;
+		uint32_t old_size = atlas->hash_table_size;
+		atlas->hash_table_size = old_size * 2;
+		atlas->hash_table = calloc(atlas->hash_table_size, sizeof(atlas->hash_table[0]));
+		for (uint32_t i = 0; i < old_size; i++) {
+			if (old_table[i].font != NULL)
+				atlas->hash_table[glyph_atlas_find(atlas, old_table[i].font, old_table[i].font_scale, old_table[i].glyph_index)] = old_table[i];
+		}
+		free(old_table);
+	}
+	
+	uint32_t slot = glyph_atlas_find(atlas, item.font, item.font_scale, item.glyph_index);
+	atlas->hash_table[slot] = item;
+	atlas->slots_used++;
+	return &atlas->hash_table[slot];
+}
+
+/**
+ * Returns the atlas item for the glyph. If the glyph isn't in the atlas yet it's rasterized and uploaded into the
+ * atlas texture first.
+ */
+glyph_atlas_item_t* glyph_atlas_get(glyph_atlas_t* atlas, const font_t* font, float font_scale, int glyph_index) {
+	uint32_t slot = glyph_atlas_find(atlas, font, font_scale, glyph_index);
+	if (atlas->hash_table[slot].font != NULL) {
+		// The atlas item for this glyph is already filled, so we already rasterized the glyph, put it in the atlas texture and stored
+		// the relevant data in an atlas item. Everything is already done, so just use the atlas item.
+		return &atlas->hash_table[slot];
+	}
+	
+	// The glyph is not yet in the atlas, meaning the glyph hasn't been rasterized yet. So we do that now and put it into the glyph atlas.
+	glyph_atlas_item_t glyph_atlas_item = { .font = font, .font_scale = font_scale, .glyph_index = glyph_index };
+	
+	// Get glyph dimensions, see stbtt_GetGlyphBitmapBox() and stbtt_GetCodepointBitmapBox() for details. The glyph box
+	// in font units is cached in the font, so only scale it here.
+	const glyph_info_t* glyph_info = font_glyph_info(font, glyph_index);
+	int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+	stbtt_GetBitmapBoxForGlyphBox(glyph_info->x0, glyph_info->y0, glyph_info->x1, glyph_info->y1, font_scale, font_scale, 0, 0, &x0, &y0, &x1, &y1);
+	int glyph_width_px = x1 - x0, glyph_height_px = y1 - y0;
+	int distance_from_baseline_to_top_px = -y0;  // y0 from stbtt_GetGlyphBitmapBox() is negative (e.g. -11), that's why we flip it here.
+	
+	// Only render glyphs that actually have some visual representation (skip spaces, etc.)
+	if (glyph_width_px > 0 && glyph_height_px > 0) {
+		int padded_glyph_width_px  = subpixel_positioning_left_padding + horizontal_filter_padding + glyph_width_px + horizontal_filter_padding;
+		int padded_glyph_height_px = glyph_height_px;
+		
+		// Here you would usually ask the glyph atlas to allocate a region with the size of padded_glyph_width_px and padded_glyph_height_px size.
+		// If the atlas is already full you would render all the rectangles already in the buffer because they expect that their glyphs are in the
+		// texture atlas. After that is done we can clear out old glyphs to make room for our new glyph here and continue on rendering the text.
+		
+		// Instead we just use our mockup atlas allocator. Every region in there is 32x32 in size and we assume that the padded glyph fits inside.
+		// The regions are handed out left to right and top to bottom.
+		// AGAIN: Don't use this for anything other than demonstration purposes. It's horribly limited and inefficient!
+		int atlas_item_width = GLYPH_ATLAS_ITEM_SIZE, atlas_item_height = GLYPH_ATLAS_ITEM_SIZE;
+		int atlas_items_per_row = atlas->width / atlas_item_width;
+		int atlas_item_x = (atlas->items_used % atlas_items_per_row) * atlas_item_width;
+		int atlas_item_y = (atlas->items_used / atlas_items_per_row) * atlas_item_height;
+		assert(atlas_item_y + atlas_item_height <= (int)atlas->height);
+		assert(padded_glyph_width_px <= atlas_item_width && padded_glyph_height_px <= atlas_item_height);
+		atlas->items_used++;
+		
+		// Create an RGB bitmap with the size of the atlas item and rasterize the glyph into it.
+		// This is larger than need be, but avoids coordinate transformation and range checks when applying the FreeType LCD filter below. Also
+		// initialize it to zeor for the same reason. We rasterize the glyph as an grayscale image with 3x the horizontal resolution so we have
+		// one coverage (grayscale) value for each subpixel.
+		// Note: You probably don't want to allocate and free a bitmap each time we render a glyph. You can create a permanent scratch buffer
+		// with the maximum glyph size or resize it on demand. We alloc and free here just for demonstration purposes.
+		int horizontal_resolution = 3;
+		int bitmap_stride     = atlas_item_width * horizontal_resolution;
+		int bitmap_size       = bitmap_stride * atlas_item_height;
+		uint8_t* glyph_bitmap = calloc(1, bitmap_size);
+		// Position of the rasterized glyph within the atlas item when padding is taken into account
+		int glyph_offset_x = (subpixel_positioning_left_padding + horizontal_filter_padding) * horizontal_resolution;
+		// Rasterize the glyph into glyph_bitmap. Same as stbtt_MakeGlyphBitmap() but with the glyph box we already have.
+		stbtt_MakeGlyphBitmapSubpixelWithBox(&font->info,
+			glyph_bitmap + glyph_offset_x,
+			atlas_item_width * horizontal_resolution, atlas_item_height, bitmap_stride,
+			font_scale * horizontal_resolution, font_scale, 0, 0,
+			glyph_info->x0, glyph_info->y0, glyph_info->x1, glyph_info->y1,
+			glyph_index
+		);
+		
+		// Allocate an RGB bitmap with the size of the atlas item and clear it out to black. That way we overwrite the entire atlas item with black,
+		// even if the padded glyph is smaller. Not really necessary but keeps the atlas clean.
+		// We then apply the FreeType LCD filter by reading from the glyph bitmap, filtering and writing to the atlas item bitmap.
+		// Note: As above you probably don't want to allocate a new bitmap for each glyph. Just create another permanent scratch bitmap for this step.
+		uint8_t* atlas_item_bitmap = calloc(1, bitmap_size);
+		
+		// Apply the FreeType LCD filter to avoid subpixel anti-aliasing color fringes,
+		// taken from FT_LCD_FILTER_DEFAULT in https://freetype.org/freetype2/docs/reference/ft2-lcd_rendering.html
+		// Just iterate over all the subpixels the filter can reach, no need to filter the entire bitmap when the results would just be 0.
+		uint8_t filter_weights[5] = { 0x08, 0x4D, 0x56, 0x4D, 0x08 };
+		for (int y = 0; y < padded_glyph_height_px; y++) {
+			// We don't need to filter the first 4 and last 1 subpixels. The filter kernel is only 5 wide and it can only distribute data
+			// at most 2 subpixels in each direction.
+			// The first 6 subpixels are just padding (subpixel_positioning_left_padding and horizontal_filter_padding) so the first 4
+			// subpixels in atlas_item_bitmap can't collect any data from the first subpixel in glyph_bitmap. Hence we start at 4 instead of 0.
+			// The last subpixel is padding again (horizontal_filter_padding) and only the 3rd and 2nd subpixel from the right can collect
+			// data from the last subpixel of the glyph_bitmap. So we skip the last subpixel as well.
+			int x_end = padded_glyph_width_px * horizontal_resolution - 1;
+			for (int x = 4; x < x_end; x++) {
+				// Apply the kernel aka filter taps while reading from glyph_bitmap. kernel_x_end makes sure we don't read over the end of the bitmap.
+				int sum = 0, filter_weight_index = 0, kernel_x_end = (x == x_end - 1) ? x + 1 : x + 2;
+				for (int kernel_x = x - 2; kernel_x <= kernel_x_end; kernel_x++) {
+					assert(kernel_x >= 0 && kernel_x < x_end + 1);  // There is 1 more subpixel after the last processed one, so we can access that one just fine.
+					assert(y        >= 0 && y        < padded_glyph_height_px);
+					int offset = kernel_x + y*bitmap_stride;
+					assert(offset >= 0 && offset < bitmap_size);
+					sum += glyph_bitmap[offset] * filter_weights[filter_weight_index++];
+				}
+				
+				// Do the division once at the end instead of for each filter weight and make sure we handle overflows.
+				// Rounding causes some pixels to accumulate a +1 which overflows from 255 to 0 and causes one subpixel artifacts.
+				// Put the result into atlas_item_bitmap.
+				sum = sum / 255;
+				atlas_item_bitmap[x + y*bitmap_stride] = (sum > 255) ? 255 : sum;
+			}
+		}
+		free(glyph_bitmap);
+		
+		// Upload the filtered atlas item bitmap into the glyph atlas texture
+		glTextureSubImage2D(atlas->texture, 0, atlas_item_x, atlas_item_y, atlas_item_width, atlas_item_height, GL_RGB, GL_UNSIGNED_BYTE, atlas_item_bitmap);
+		free(atlas_item_bitmap);
+		atlas->uploads_pending = true;
+		
+		glyph_atlas_item.tex_coords.left   = atlas_item_x;
+		glyph_atlas_item.tex_coords.top    = atlas_item_y;
+		glyph_atlas_item.tex_coords.right  = atlas_item_x + padded_glyph_width_px;
+		glyph_atlas_item.tex_coords.bottom = atlas_item_y + padded_glyph_height_px;
+	} else {
+		// The glyph has no visual representation (e.g. space). Just set the glyph atlas entry to some
+		// value we can check for later on to see if the glyph has no visual representation.
+		glyph_atlas_item.tex_coords.left   = -1;
+		glyph_atlas_item.tex_coords.top    = -1;
+		glyph_atlas_item.tex_coords.right  = -1;
+		glyph_atlas_item.tex_coords.bottom = -1;
+	}
+	
+	// Finish up the glyph atlas item and put it into the hash table. The left side bearing is stored along with it so
+	// glyph_run_emit() doesn't have to look into the font at all.
+	glyph_atlas_item.distance_from_baseline_to_top_px = distance_from_baseline_to_top_px;
+	glyph_atlas_item.left_side_bearing_px             = glyph_info->left_side_bearing * font_scale;
+	
+	return glyph_atlas_insert(atlas, glyph_atlas_item);
+}
+
+/**
+ * Puts a whole set of glyphs into the atlas at once, e.g. all glyphs of a page before drawing it. Glyphs that are
+ * already in the atlas are skipped. The result is exactly the same as calling glyph_atlas_get() for each glyph, but
+ * all glyphs are rasterized and LCD filtered by one stbtt_MakeGlyphBitmapBatch() call into one staging image that
+ * covers the atlas rows of the new items. So stb_truetype sets up its buffers once instead of once per glyph and
+ * there are at most 3 texture uploads instead of one per glyph. Returns the number of glyphs added to the atlas.
+ */
+int glyph_atlas_prewarm(glyph_atlas_t* atlas, const font_t* font, float font_scale, const int* glyph_indices, int glyph_count) {
+	int atlas_item_size = GLYPH_ATLAS_ITEM_SIZE, horizontal_resolution = 3;
+	int atlas_items_per_row = atlas->width / atlas_item_size;
+	int first_new_item = atlas->items_used, glyphs_added = 0;
+	stbtt_glyph_request* requests = malloc(glyph_count * sizeof(requests[0]));
+	int request_count = 0;
+	
+	// Allocate the atlas items and put them into the hash table right away. That way duplicates in glyph_indices are
+	// found like any other glyph that is already in the atlas. The texture is filled in below.
+	for (int i = 0; i < glyph_count; i++) {
+		int glyph_index = glyph_indices[i];
+		uint32_t slot = glyph_atlas_find(atlas, font, font_scale, glyph_index);
+		if (atlas->hash_table[slot].font != NULL)
+			continue;
+		
+		glyph_atlas_item_t glyph_atlas_item = { .font = font, .font_scale = font_scale, .glyph_index = glyph_index,
+			.tex_coords = (int16_rect_t){ -1, -1, -1, -1 } };
+		const glyph_info_t* glyph_info = font_glyph_info(font, glyph_index);
+		int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+		stbtt_GetBitmapBoxForGlyphBox(glyph_info->x0, glyph_info->y0, glyph_info->x1, glyph_info->y1, font_scale, font_scale, 0, 0, &x0, &y0, &x1, &y1);
+		int glyph_width_px = x1 - x0, glyph_height_px = y1 - y0;
+		if (glyph_width_px > 0 && glyph_height_px > 0) {
+			// Same padding and mockup allocator as in glyph_atlas_get()
+			int padded_glyph_width_px  = subpixel_positioning_left_padding + horizontal_filter_padding + glyph_width_px + horizontal_filter_padding;
+			int padded_glyph_height_px = glyph_height_px;
+			int atlas_item_x = (atlas->items_used % atlas_items_per_row) * atlas_item_size;
+			int atlas_item_y = (atlas->items_used / atlas_items_per_row) * atlas_item_size;
+			assert(atlas_item_y + atlas_item_size <= (int)atlas->height);
+			assert(padded_glyph_width_px <= atlas_item_size && padded_glyph_height_px <= atlas_item_size);
+			atlas->items_used++;
+			
+			// The request rect is in subpixels (bytes of the RGB staging image) and its y is made relative to the
+			// first row of the staging image once we know where that is.
+			requests[request_count++] = (stbtt_glyph_request){
+				.glyph   = glyph_index,
+				.scale_x = font_scale * horizontal_resolution, .scale_y = font_scale,
+				.x       = atlas_item_x * horizontal_resolution, .y = atlas_item_y,
+				.w       = padded_glyph_width_px * horizontal_resolution, .h = padded_glyph_height_px,
+				.glyph_x = (subpixel_positioning_left_padding + horizontal_filter_padding) * horizontal_resolution,
+				.has_box = true,
+				.box     = { glyph_info->x0, glyph_info->y0, glyph_info->x1, glyph_info->y1 }
+			};
+			glyph_atlas_item.tex_coords = (int16_rect_t){ atlas_item_x, atlas_item_y, atlas_item_x + padded_glyph_width_px, atlas_item_y + padded_glyph_height_px };
+		}
+		
+		glyph_atlas_item.distance_from_baseline_to_top_px = -y0;
+		glyph_atlas_item.left_side_bearing_px             = glyph_info->left_side_bearing * font_scale;
+		glyph_atlas_insert(atlas, glyph_atlas_item);
+		glyphs_added++;
+	}
+	
+	if (request_count > 0) {
+		// One staging image for all atlas rows that got new items. It's cleared to black so the unused parts of
+		// the items end up black in the texture, just like glyph_atlas_get() does it.
+		int first_row = first_new_item / atlas_items_per_row, end_row = (atlas->items_used - 1) / atlas_items_per_row + 1;
+		int staging_stride = atlas->width * horizontal_resolution, staging_top = first_row * atlas_item_size;
+		uint8_t* staging = calloc(1, staging_stride * (end_row - first_row) * atlas_item_size);
+		for (int i = 0; i < request_count; i++)
+			requests[i].y -= staging_top;
+		stbtt_MakeGlyphBitmapBatch(&font->info, staging, staging_stride, requests, request_count, STBTT_BATCH_LCD_FILTER);
+		
+		// Upload the new items: The rest of the first row, then all complete rows at once and then the start of
+		// the last row. GL_UNPACK_ROW_LENGTH lets us upload parts of the staging image.
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, atlas->width);
+		for (int item = first_new_item; item < atlas->items_used; ) {
+			int column = item % atlas_items_per_row, row = item / atlas_items_per_row;
+			int columns = atlas_items_per_row - column, rows = 1;
+			if (column == 0 && atlas->items_used - item >= atlas_items_per_row)
+				rows = (atlas->items_used - item) / atlas_items_per_row;
+			else if (columns > atlas->items_used - item)
+				columns = atlas->items_used - item;
+			
+			int x = column * atlas_item_size, y = row * atlas_item_size;
+			glTextureSubImage2D(atlas->texture, 0, x, y, columns * atlas_item_size, rows * atlas_item_size, GL_RGB, GL_UNSIGNED_BYTE,
+				staging + (y - staging_top) * staging_stride + x * horizontal_resolution);
+			item += rows * columns;
+		}
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		free(staging);
+		atlas->uploads_pending = true;
+	}
+	
+	free(requests);
+	return glyphs_added;
+}
+
+// One glyph of a glyph run. The glyph is drawn at the current pen position plus the offset and then the pen is moved
+// to the right by x_advance. All values are in pixels. Pre-positioned glyphs just use an x_advance of 0 and put their
+// position (relative to the run origin) into the offsets.
+typedef struct {
+	int   glyph_index;
+	float x_advance;
+	float x_offset, y_offset;
+} glyph_t;
+
+/**
+ * Converts UTF-8 text into a glyph run of pre-positioned glyphs (relative to the baseline of the first line). Applies
+ * kerning and handles line breaks ('\n'). Do this once for strings that are drawn over and over again and then draw
+ * them with glyph_run_emit(). That skips UTF-8 decoding, the cmap lookup and kerning for every frame.
+ *
+ * Returns the number of glyphs put into `glyphs`. Stops when `glyphs_capacity` is reached. `text` doesn't have to be
+ * zero terminated, e.g. it can be a line of a log file (see log_file_read_line()).
+ */
+int glyph_run_from_utf8(const font_t* font, float font_size_pt, const char* text, size_t text_length, glyph_t* glyphs, int glyphs_capacity) {
+	float font_scale  = font_scale_for_size(font, font_size_pt);
+	float line_height = (font->ascent - font->descent + font->line_gap) * font_scale;  // Based on the docs of stbtt_GetFontVMetrics()
+	
+	// Keep track of the current position in font units while we process glyph after glyph. That way the glyph
+	// positions are exactly the same as the widths calculated by text_measure().
+	int pen_x = 0;
+	float pen_y = 0;
+	int glyphs_filled = 0;
+	
+	// Iterate over the UTF-8 text codepoint by codepoint. A codepoint is basically the 32 bit ID of a character
+	// as defined by Unicode.
+	int prev_glyph_index = -1;
+	for(utf8_iterator_t it = utf8_first_n(text, text_length); it.codepoint != 0 && glyphs_filled < glyphs_capacity; it = utf8_next(it)) {
+		uint32_t codepoint = it.codepoint;
+		
+		if (codepoint == '\n') {
+			// Handle line breaks
+			pen_x = 0;
+			pen_y += round(line_height);
+			prev_glyph_index = -1;
+			continue;
+		}
+		
+		// Find the glyph index first for faster lookup in the following functions. Otherwise stb_truetype has to search through a translation
+		// table from codepoint to index at each call.
+		int glyph_index = (codepoint < 128) ? font->ascii_glyph_indices[codepoint] : stbtt_FindGlyphIndex(&font->info, codepoint);
+		
+		// Apply kerning
+		if (prev_glyph_index != -1)
+			pen_x += stbtt_GetGlyphKernAdvance(&font->info, prev_glyph_index, glyph_index);
+		prev_glyph_index = glyph_index;
+		
+		glyphs[glyphs_filled++] = (glyph_t){ .glyph_index = glyph_index, .x_advance = 0, .x_offset = pen_x * font_scale, .y_offset = pen_y };
+		
+		int glyph_advance_width = 0;
+		stbtt_GetGlyphHMetrics(&font->info, glyph_index, &glyph_advance_width, NULL);
+		pen_x += glyph_advance_width;
+	}
+	
+	return glyphs_filled;
+}
+
+// Same as glyph_run_from_utf8() for zero terminated text
+int glyph_run_from_text(const font_t* font, float font_size_pt, const char* text, glyph_t* glyphs, int glyphs_capacity) {
+	return glyph_run_from_utf8(font, font_size_pt, text, strlen(text), glyphs, glyphs_capacity);
+}
+
+/**
+ * Puts one rect_instance_t for every visible glyph of the glyph run into `rects`. x and y are the top left corner of
+ * the first line. Glyphs missing from the atlas are rasterized on the fly, everything else comes straight out of the
+ * atlas items. Returns the number of rects put into the buffer. Stops when `rects_capacity` is reached.
+ */
+int glyph_run_emit(glyph_atlas_t* atlas, const font_t* font, float font_size_pt, const glyph_t* glyphs, int glyph_count, float x, float y, color_t color, rect_instance_t* rects, int rects_capacity) {
+	float font_scale = font_scale_for_size(font, font_size_pt);
+	float baseline = round(font->ascent * font_scale);
+	int rects_filled = 0;
+	
+	float pen_x = x, pen_y = y + baseline;
+	for (int i = 0; i < glyph_count && rects_filled < rects_capacity; i++) {
+		const glyph_t* glyph = &glyphs[i];
+		const glyph_atlas_item_t* glyph_atlas_item = glyph_atlas_get(atlas, font, font_scale, glyph->glyph_index);
+		
+		// Only render glyphs that actually have some visual representation (skip spaces, etc.)
+		if (glyph_atlas_item->tex_coords.left != -1) {
+			float glyph_pos_x = (pen_x + glyph->x_offset) + glyph_atlas_item->left_side_bearing_px;
+			float glyph_pos_x_px = 0;
+			float glyph_pos_x_subpixel_shift = modff(glyph_pos_x, &glyph_pos_x_px);
+			float glyph_pos_y_px = round(pen_y + glyph->y_offset) - glyph_atlas_item->distance_from_baseline_to_top_px;
+			int glyph_width_with_horiz_filter_padding = glyph_atlas_item->tex_coords.right  - glyph_atlas_item->tex_coords.left;
+			int glyph_height                          = glyph_atlas_item->tex_coords.bottom - glyph_atlas_item->tex_coords.top;
+			
+			rects[rects_filled++] = (rect_instance_t){
+				.pos.left   = glyph_pos_x_px - (subpixel_positioning_left_padding + horizontal_filter_padding),
+				.pos.right  = glyph_pos_x_px - (subpixel_positioning_left_padding + horizontal_filter_padding) + glyph_width_with_horiz_filter_padding,
+				.pos.top    = glyph_pos_y_px,
+				.pos.bottom = glyph_pos_y_px + glyph_height,
+				.subpixel_shift = glyph_pos_x_subpixel_shift,
+				.tex_coords     = glyph_atlas_item->tex_coords,
+				.color          = color,
+				.kind           = RECT_GLYPH
+			};
+		}
+		
+		pen_x += glyph->x_advance;
+	}
+	
+	return rects_filled;
+}
+
+// Number of glyphs at the start of the run that surely fit into the atlas: Each glyph that isn't in the atlas yet
+// takes one of the free items (see glyph_atlas_free_items()). Glyphs that appear more than once or have no visual
+// representation are counted too, good enough to know where to split the run. Emit that many glyphs, then draw
+// everything and clear the atlas before emitting the rest.
+int glyph_run_fitting_glyphs(const glyph_atlas_t* atlas, const font_t* font, float font_size_pt, const glyph_t* glyphs, int glyph_count) {
+	float font_scale = font_scale_for_size(font, font_size_pt);
+	int free_items = glyph_atlas_free_items(atlas);
+	for (int i = 0; i < glyph_count; i++) {
+		if (atlas->hash_table[glyph_atlas_find(atlas, font, font_scale, glyphs[i].glyph_index)].font == NULL && free_items-- == 0)
+			return i;
+	}
+	return glyph_count;
+}
+
+
+rect_instance_t solid_rect(float left, float top, float right, float bottom, color_t color) {
+	return (rect_instance_t){
+		.pos   = (int16_rect_t){ .left = round(left), .top = round(top), .right = round(right), .bottom = round(bottom) },
+		.color = color,
+		.kind  = RECT_SOLID
+	};
+}
+
+// Solid rects for a line through the first line of text at x, y (top left corner, same as for glyph_run_emit()).
+// position is the top of the line relative to the baseline in font units, see font_t.
+rect_instance_t text_line_rect(const font_t* font, float font_size_pt, float x, float y, float width, int position, int thickness, color_t color) {
+	float font_scale = font_scale_for_size(font, font_size_pt);
+	float baseline_y = y + round(font->ascent * font_scale);
+	float top = baseline_y - round(position * font_scale);
+	float thickness_px = fmaxf(1, round(thickness * font_scale));
+	return solid_rect(x, top, x + width, top + thickness_px, color);
+}
+
+rect_instance_t text_underline_rect(const font_t* font, float font_size_pt, float x, float y, float width, color_t color) {
+	return text_line_rect(font, font_size_pt, x, y, width, font->underline_position, font->underline_thickness, color);
+}
+
+rect_instance_t text_strikethrough_rect(const font_t* font, float font_size_pt, float x, float y, float width, color_t color) {
+	return text_line_rect(font, font_size_pt, x, y, width, font->strikethrough_position, font->strikethrough_thickness, color);
+}
+
+// Below this size (in pixels per em) text can't be read anyway, e.g. in minimaps or zoomed out overviews. Rasterizing
+// and filtering every glyph for it costs as much as for readable text, so it's "greeked" instead: Drawn as bars that
+// only show where the words are and how dark they are. See glyph_run_emit_greeked().
+#define GREEKING_MAX_SIZE_PX 4
+
+bool text_is_greeked(float font_size_pt) {
+	return font_size_pt * 1.333333 < GREEKING_MAX_SIZE_PX;  // same points to pixels conversion as font_scale_for_size()
+}
+
+// Word that glyph_run_emit_greeked() and text_emit_greeked() are currently putting together
+typedef struct {
+	bool    active;
+	float   left, right, baseline_y;  // in pixels
+	int64_t ink;                      // sum of the glyph box areas in font units times their average coverage (0..255)
+} greeked_word_t;
+
+// Ends the word and returns its bar. The bar gets an alpha that puts the same amount of ink on the screen as the glyphs.
+rect_instance_t greeked_word_end(greeked_word_t* word, float font_scale, float x_height_px, color_t color) {
+	word->active = false;
+	float left_px = round(word->left), right_px = fmaxf(round(word->right), left_px + 1);
+	float coverage = fminf(1, word->ink * font_scale * font_scale / 255 / ((right_px - left_px) * x_height_px));
+	color.a = round(color.a * coverage);
+	return solid_rect(left_px, word->baseline_y - x_height_px, right_px, word->baseline_y, color);
+}
+
+// Adds a glyph with its origin at x on the line with baseline_y (in pixels) to the current word. Glyphs without shape
+// (spaces) and glyphs on another line end the current word. Then the bar of that word is put into `ended_word_rect` and
+// true is returned.
+bool greeked_word_add_glyph(greeked_word_t* word, const font_t* font, float font_scale, float x_height_px, int glyph_index, float x, float baseline_y, color_t color, rect_instance_t* ended_word_rect) {
+	const glyph_info_t* glyph_info = &font->glyph_infos[glyph_index];
+	if (!glyph_info->coverage_measured)
+		font_glyph_coverage(font, glyph_index);
+	bool has_shape = (glyph_info->x1 > glyph_info->x0);
+	
+	bool word_ended = false;
+	if ( word->active && (!has_shape || baseline_y != word->baseline_y) ) {
+		*ended_word_rect = greeked_word_end(word, font_scale, x_height_px, color);
+		word_ended = true;
+	}
+	if (has_shape) {
+		if (!word->active)
+			*word = (greeked_word_t){ .active = true, .left = x + glyph_info->x0 * font_scale, .baseline_y = baseline_y };
+		word->right = x + glyph_info->x1 * font_scale;
+		word->ink += glyph_info->average_coverage * (glyph_info->x1 - glyph_info->x0) * (glyph_info->y1 - glyph_info->y0);
+	}
+	return word_ended;
+}
+
+/**
+ * Level of detail version of glyph_run_emit() for text below GREEKING_MAX_SIZE_PX. Puts one solid rect per word into
+ * `rects` instead of one rect per glyph: From the left of the first glyph box to the right of the last one and from the
+ * baseline up to the x-height. The alpha of each bar is the average coverage of its glyphs (font_glyph_coverage()) so
+ * dense words are darker than sparse ones. Doesn't touch the glyph atlas. Returns the number of rects put into the
+ * buffer. Stops when `rects_capacity` is reached.
+ */
+int glyph_run_emit_greeked(const font_t* font, float font_size_pt, const glyph_t* glyphs, int glyph_count, float x, float y, color_t color, rect_instance_t* rects, int rects_capacity) {
+	float font_scale = font_scale_for_size(font, font_size_pt);
+	float baseline = round(font->ascent * font_scale);
+	float x_height_px = fmaxf(1, round(font->x_height * font_scale));
+	int rects_filled = 0;
+	
+	float pen_x = x, pen_y = y + baseline;
+	greeked_word_t word = { .active = false };
+	for (int i = 0; i < glyph_count && rects_filled < rects_capacity; i++) {
+		const glyph_t* glyph = &glyphs[i];
+		if ( greeked_word_add_glyph(&word, font, font_scale, x_height_px, glyph->glyph_index, pen_x + glyph->x_offset, round(pen_y + glyph->y_offset), color, &rects[rects_filled]) )
+			rects_filled++;
+		pen_x += glyph->x_advance;
+	}
+	if (word.active && rects_filled < rects_capacity)
+		rects[rects_filled++] = greeked_word_end(&word, font_scale, x_height_px, color);
+	
+	return rects_filled;
+}
+
+/**
+ * Same as glyph_run_from_text() followed by glyph_run_emit_greeked(), but without the glyph run in between. Printable
+ * ASCII only needs the cached glyph indices, advances and kerning of font_t (like text_measure()), so there's no cmap
+ * or kern table lookup per character. x and y are the top left corner of the first line.
+ */
+int text_emit_greeked(const font_t* font, float font_size_pt, const char* text, float x, float y, color_t color, rect_instance_t* rects, int rects_capacity) {
+	float font_scale  = font_scale_for_size(font, font_size_pt);
+	float line_height = (font->ascent - font->descent + font->line_gap) * font_scale;
+	float baseline = round(font->ascent * font_scale);
+	float x_height_px = fmaxf(1, round(font->x_height * font_scale));
+	int rects_filled = 0;
+	
+	// Pen position in font units, like glyph_run_from_text(). prev is the previous ASCII char (0 at line start) or 128 +
+	// the previous glyph index for all other codepoints, like in text_measure().
+	int pen_x = 0, prev = 0;
+	float pen_y = 0;
+	greeked_word_t word = { .active = false };
+	const uint8_t* pos = (const uint8_t*)text;
+	const uint8_t* end = pos + strlen(text);
+	while (pos < end && rects_filled < rects_capacity) {
+		uint8_t c = *pos;
+		int glyph_index = 0, glyph_x = 0;
+		if (c == '\n') {
+			pen_x = 0;
+			pen_y += round(line_height);
+			prev = 0;
+			pos++;
+			continue;
+		} else if (c < 128 && prev < 128) {
+			// ascii_pair_advances is the kerning plus the advance, the glyph itself starts after the kerning
+			glyph_index = font->ascii_glyph_indices[c];
+			glyph_x = pen_x + font->ascii_pair_advances[prev][c] - font->ascii_advances[c];
+			pen_x += font->ascii_pair_advances[prev][c];
+			prev = c;
+			pos++;
+		} else {
+			utf8_iterator_t it = utf8_next((utf8_iterator_t){ .buffer = (const char*)pos, .end = (const char*)end });
+			glyph_index = (c < 128) ? font->ascii_glyph_indices[c] : stbtt_FindGlyphIndex(&font->info, it.codepoint);
+			int prev_glyph_index = (prev < 128) ? font->ascii_glyph_indices[prev] : prev - 128;
+			if (prev != 0)
+				pen_x += stbtt_GetGlyphKernAdvance(&font->info, prev_glyph_index, glyph_index);
+			glyph_x = pen_x;
+			
+			int advance = 0;
+			stbtt_GetGlyphHMetrics(&font->info, glyph_index, &advance, NULL);
+			pen_x += advance;
+			prev = (c < 128) ? c : 128 + glyph_index;
+			pos = (const uint8_t*)it.buffer;
+		}
+		
+		if ( greeked_word_add_glyph(&word, font, font_scale, x_height_px, glyph_index, x + glyph_x * font_scale, round(y + baseline + pen_y), color, &rects[rects_filled]) )
+			rects_filled++;
+	}
+	if (word.active && rects_filled < rects_capacity)
+		rects[rects_filled++] = greeked_word_end(&word, font_scale, x_height_px, color);
+	
+	return rects_filled;
+}
+
+
+//
+// GPU text layout with a compute shader
+//
+
+// For large static documents the CPU layout in glyph_run_from_text() and glyph_run_emit() and uploading the
+// rect instances every frame become the bottleneck. Instead the glyph indices (with the kerning to the previous
+// glyph) and a per-glyph table with advances and atlas positions are uploaded once. A compute shader then walks
+// each line, sums up the advances (one invocation per line, in font units like glyph_run_from_text()) and writes the
+// rect instances directly into a buffer that is drawn with glDrawArraysIndirect(). The upload already knows which
+// glyphs are visible, so it also stores where the instances of each line start. Every invocation then writes its
+// line into its own block and the instances end up in line order, no atomics needed.
+// The shader does exactly the same float operations as glyph_run_emit() (marked as precise so the compiler can't
+// fuse or reorder them). The rect instances are therefore the same as on the CPU, in the same order.
+typedef struct {
+	GLuint program;
+	GLuint glyphs_buffer;        // per glyph: glyph index (low 16 bits) and kerning to the previous glyph in font units (high 16 bits)
+	GLuint lines_buffer;         // per line: index of the first glyph, glyph count, index of the first instance and padding
+	GLuint glyph_table_buffer;   // gpu_glyph_info_t for each glyph index of the font
+	GLuint instances_buffer;     // rect_instance_t output of the compute shader
+	GLuint draw_command_buffer;  // the indirect draw command, see glDrawArraysIndirect()
+	int glyph_count, line_count, instance_count;
+	float font_size_pt;
+	const font_t* font;
+} gpu_text_layout_t;
+
+typedef struct {
+	int32_t  advance;                           // in font units
+	int32_t  distance_from_baseline_to_top_px;
+	float    left_side_bearing_px;
+	uint32_t tex_coords_left_top, tex_coords_right_bottom;  // two int16 each, 0xFFFFFFFF for glyphs without visual representation
+} gpu_glyph_info_t;
+
+bool gpu_text_layout_init(gpu_text_layout_t* layout) {
+	memset(layout, 0, sizeof(*layout));
+	layout->program = gl_load_compute_shader_program(
+		"#version 450 core\n"
+		RECT_KIND_SHADER_DEFINES
+		"\n"
+		"layout(local_size_x = 64) in;\n"
+		"\n"
+		"layout(location = 0) uniform float pos_x;\n"
+		"layout(location = 1) uniform float baseline_y;        // top of the text plus the rounded baseline\n"
+		"layout(location = 2) uniform float font_scale;\n"
+		"layout(location = 3) uniform float line_height;       // already rounded\n"
+		"layout(location = 4) uniform uint  color;             // RGBA8, same memory layout as color_t\n"
+		"layout(location = 5) uniform uint  line_count;\n"
+		"layout(location = 6) uniform int   padding_left;      // subpixel_positioning_left_padding + horizontal_filter_padding\n"
+		"\n"
+		"struct glyph_info_t {\n"
+		"	int   advance;\n"
+		"	int   distance_from_baseline_to_top_px;\n"
+		"	float left_side_bearing_px;\n"
+		"	uint  tex_coords_left_top, tex_coords_right_bottom;\n"
+		"};\n"
+		"\n"
+		"layout(std430, binding = 0) readonly  buffer glyphs_buffer      { uint glyphs[]; };\n"
+		"layout(std430, binding = 1) readonly  buffer lines_buffer       { uvec4 lines[]; };  // first glyph, glyph count, first instance\n"
+		"layout(std430, binding = 2) readonly  buffer glyph_table_buffer { glyph_info_t glyph_table[]; };\n"
+		"layout(std430, binding = 3) writeonly buffer instances_buffer   { uint instances[]; };  // 7 uints per rect_instance_t\n"
+		"\n"
+		"void main() {\n"
+		"	uint line = gl_GlobalInvocationID.x;\n"
+		"	if (line >= line_count)\n"
+		"		return;\n"
+		"	\n"
+		"	uint first_glyph = lines[line].x, glyph_count = lines[line].y, instance = lines[line].z;\n"
+		"	precise float line_baseline_y = baseline_y + float(line) * line_height;\n"
+		"	int glyph_pos_y = int(round(line_baseline_y));\n"
+		"	\n"
+		"	// Prefix sum of the advances and kerning along the line, in font units\n"
+		"	int pen_x = 0;\n"
+		"	for (uint i = first_glyph; i < first_glyph + glyph_count; i++) {\n"
+		"		uint glyph_index = glyphs[i] & 0xFFFFu;\n"
+		"		pen_x += int(glyphs[i]) >> 16;  // kerning, the arithmetic shift keeps the sign\n"
+		"		glyph_info_t info = glyph_table[glyph_index];\n"
+		"		\n"
+		"		// Only render glyphs that actually have some visual representation (skip spaces, etc.)\n"
+		"		if (info.tex_coords_left_top != 0xFFFFFFFFu) {\n"
+		"			// Same calculations as in glyph_run_emit()\n"
+		"			precise float x_offset = float(pen_x) * font_scale;\n"
+		"			precise float glyph_pos_x = (pos_x + x_offset) + info.left_side_bearing_px;\n"
+		"			float glyph_pos_x_px = 0;\n"
+		"			float glyph_pos_x_subpixel_shift = modf(glyph_pos_x, glyph_pos_x_px);\n"
+		"			int left = int(glyph_pos_x_px) - padding_left;\n"
+		"			int top  = glyph_pos_y - info.distance_from_baseline_to_top_px;\n"
+		"			ivec2 tex_left_top     = ivec2(bitfieldExtract(int(info.tex_coords_left_top), 0, 16),     bitfieldExtract(int(info.tex_coords_left_top), 16, 16));\n"
+		"			ivec2 tex_right_bottom = ivec2(bitfieldExtract(int(info.tex_coords_right_bottom), 0, 16), bitfieldExtract(int(info.tex_coords_right_bottom), 16, 16));\n"
+		"			ivec2 size = tex_right_bottom - tex_left_top;\n"
+		"			\n"
+		"			uint offset = instance++ * 7;\n"
+		"			instances[offset + 0] = (uint(left)          & 0xFFFFu) | (uint(top)          << 16);\n"
+		"			instances[offset + 1] = (uint(left + size.x) & 0xFFFFu) | (uint(top + size.y) << 16);\n"
+		"			instances[offset + 2] = info.tex_coords_left_top;\n"
+		"			instances[offset + 3] = info.tex_coords_right_bottom;\n"
+		"			instances[offset + 4] = color;\n"
+		"			instances[offset + 5] = floatBitsToUint(glyph_pos_x_subpixel_shift);\n"
+		"			instances[offset + 6] = RECT_GLYPH;  // kind in the low 16 bits, clip_index 0 in the high ones\n"
+		"		}\n"
+		"		\n"
+		"		pen_x += info.advance;\n"
+		"	}\n"
+		"}\n"
+	);
+	if (!layout->program)
+		return false;
+	
+	// The shader writes rect_instance_t as 7 uints
+	assert(sizeof(rect_instance_t) == 7 * sizeof(uint32_t));
+	glCreateBuffers(1, &layout->glyphs_buffer);
+	glCreateBuffers(1, &layout->lines_buffer);
+	glCreateBuffers(1, &layout->glyph_table_buffer);
+	glCreateBuffers(1, &layout->instances_buffer);
+	glCreateBuffers(1, &layout->draw_command_buffer);
+	glNamedBufferStorage(layout->draw_command_buffer, 4 * sizeof(uint32_t), NULL, GL_DYNAMIC_STORAGE_BIT);
+	return true;
+}
+
+void gpu_text_layout_destroy(gpu_text_layout_t* layout) {
+	GLuint buffers[] = { layout->glyphs_buffer, layout->lines_buffer, layout->glyph_table_buffer, layout->instances_buffer, layout->draw_command_buffer };
+	glDeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers);
+	glDeleteProgram(layout->program);
+}
+
+/**
+ * Decodes the UTF-8 text into glyph indices and kerning, puts all glyphs into the atlas and uploads everything
+ * the compute shader needs. Only has to be done once for a document.
+ */
+void gpu_text_layout_upload(gpu_text_layout_t* layout, glyph_atlas_t* atlas, const font_t* font, float font_size_pt, const char* text) {
+	float font_scale = font_scale_for_size(font, font_size_pt);
+	
+	size_t text_length = strlen(text);
+	// One extra zeroed glyph so an empty text still uploads one glyph, shader storage buffers can't be empty
+	uint32_t* glyphs = calloc(text_length + 1, sizeof(glyphs[0]));
+	uint32_t* lines  = calloc((text_length + 1) * 4, sizeof(lines[0]));
+	gpu_glyph_info_t* glyph_table = calloc(font->info.numGlyphs, sizeof(glyph_table[0]));
+	bool* glyph_table_filled = calloc(font->info.numGlyphs, sizeof(glyph_table_filled[0]));
+	
+	int glyph_count = 0, line_count = 0, line_start = 0;
+	int prev_glyph_index = -1;
+	for(utf8_iterator_t it = utf8_first(text); it.codepoint != 0; it = utf8_next(it)) {
+		uint32_t codepoint = it.codepoint;
+		if (codepoint == '\n') {
+			lines[line_count*4 + 0] = line_start;
+			lines[line_count*4 + 1] = glyph_count - line_start;
+			line_count++;
+			line_start = glyph_count;
+			prev_glyph_index = -1;
+			continue;
+		}
+		
+		int glyph_index = (codepoint < 128) ? font->ascii_glyph_indices[codepoint] : stbtt_FindGlyphIndex(&font->info, codepoint);
+		int kerning = (prev_glyph_index != -1) ? stbtt_GetGlyphKernAdvance(&font->info, prev_glyph_index, glyph_index) : 0;
+		prev_glyph_index = glyph_index;
+		glyphs[glyph_count++] = (uint32_t)glyph_index | (uint32_t)kerning << 16;
+		
+		// Make sure the glyph is in the atlas and in the glyph table
+		if (!glyph_table_filled[glyph_index]) {
+			const glyph_atlas_item_t* item = glyph_atlas_get(atlas, font, font_scale, glyph_index);
+			gpu_glyph_info_t* info = &glyph_table[glyph_index];
+			stbtt_GetGlyphHMetrics(&font->info, glyph_index, &info->advance, NULL);
+			info->distance_from_baseline_to_top_px = item->distance_from_baseline_to_top_px;
+			info->left_side_bearing_px             = item->left_side_bearing_px;
+			info->tex_coords_left_top              = (uint16_t)item->tex_coords.left  | (uint32_t)(uint16_t)item->tex_coords.top    << 16;
+			info->tex_coords_right_bottom          = (uint16_t)item->tex_coords.right | (uint32_t)(uint16_t)item->tex_coords.bottom << 16;
+			glyph_table_filled[glyph_index] = true;
+		}
+	}
+	lines[line_count*4 + 0] = line_start;
+	lines[line_count*4 + 1] = glyph_count - line_start;
+	line_count++;
+	
+	// Now that the glyph table is complete count the visible glyphs of each line, the compute shader writes the
+	// instances of a line starting at this index
+	int instance_count = 0;
+	for (int line = 0; line < line_count; line++) {
+		lines[line*4 + 2] = instance_count;
+		for (uint32_t i = lines[line*4 + 0]; i < lines[line*4 + 0] + lines[line*4 + 1]; i++) {
+			if (glyph_table[glyphs[i] & 0xFFFF].tex_coords_left_top != 0xFFFFFFFF)
+				instance_count++;
+		}
+	}
+	
+	// Allocate new storage for all buffers. Also reserve the worst case for the instances (every glyph visible). The
+	// glyphs and instances get at least one entry each for empty texts.
+	glNamedBufferData(layout->glyphs_buffer,      (glyph_count ? glyph_count : 1) * sizeof(glyphs[0]), glyphs,      GL_STATIC_DRAW);
+	glNamedBufferData(layout->lines_buffer,       line_count * 4 * sizeof(lines[0]),                   lines,       GL_STATIC_DRAW);
+	glNamedBufferData(layout->glyph_table_buffer, font->info.numGlyphs * sizeof(glyph_table[0]),       glyph_table, GL_STATIC_DRAW);
+	glNamedBufferData(layout->instances_buffer,   (glyph_count + 1) * sizeof(rect_instance_t),         NULL,        GL_STATIC_DRAW);
+	layout->glyph_count  = glyph_count;
+	layout->line_count     = line_count;
+	layout->instance_count = instance_count;
+	layout->font           = font;
+	layout->font_size_pt = font_size_pt;
+	
+	free(glyphs);
+	free(lines);
+	free(glyph_table);
+	free(glyph_table_filled);
+}
+
+/**
+ * Runs the compute shader to put the rect instances of the document at x, y (top left corner) into
+ * `layout->instances_buffer`. Draw them with `glDrawArraysIndirect()` and `layout->draw_command_buffer`.
+ */
+void gpu_text_layout_run(gpu_text_layout_t* layout, float x, float y, color_t color) {
+	float font_scale  = font_scale_for_size(layout->font, layout->font_size_pt);
+	float line_height = (layout->font->ascent - layout->font->descent + layout->font->line_gap) * font_scale;
+	float baseline_y  = y + round(layout->font->ascent * font_scale);
+	uint32_t packed_color = 0;
+	memcpy(&packed_color, &color, sizeof(packed_color));
+	
+	// The instance count is known since the upload, the compute shader only writes the instances
+	uint32_t draw_command[4] = { 6, layout->instance_count, 0, 0 };
+	glNamedBufferSubData(layout->draw_command_buffer, 0, sizeof(draw_command), draw_command);
+	
+	glProgramUniform1f(layout->program, 0, x);
+	glProgramUniform1f(layout->program, 1, baseline_y);
+	glProgramUniform1f(layout->program, 2, font_scale);
+	glProgramUniform1f(layout->program, 3, round(line_height));
+	glProgramUniform1ui(layout->program, 4, packed_color);
+	glProgramUniform1ui(layout->program, 5, layout->line_count);
+	glProgramUniform1i(layout->program, 6, subpixel_positioning_left_padding + horizontal_filter_padding);
+	
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, layout->glyphs_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, layout->lines_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, layout->glyph_table_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, layout->instances_buffer);
+	glUseProgram(layout->program);
+		glDispatchCompute((layout->line_count + 63) / 64, 1, 1);
+	glUseProgram(0);
+	
+	// Make the written instances visible to the vertex fetch and buffer reads
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+
+//
+// Glyph run templates (two-level instancing)
+//
+
+// Tables and logs repeat the same words thousands of times ("INFO", column headers, timestamp prefixes). With
+// glyph_run_emit() each occurrence becomes one rect_instance_t per glyph. Instead each distinct word is stored once
+// as a template (its glyphs positioned relative to the first one) in a GPU buffer and each occurrence is just one
+// glyph_run_instance_t: a template, an origin and a color. The vertex shader then expands every run instance into
+// its glyphs (see expand_run_templates in main()). So the instance stream shrinks by the average word length.
+// Positions are kept in font units like in glyph_run_from_text() and the shader does the same float operations as
+// glyph_run_emit(), so the result is the same as drawing the text with glyph_run_emit().
+#define GLYPH_RUN_TEMPLATE_MAX_LENGTH      23  // in bytes, longer words are split into several templates
+#define GLYPH_RUN_TEMPLATE_CAPACITY        4096
+#define GLYPH_RUN_TEMPLATE_GLYPH_CAPACITY  32768
+#define GLYPH_RUN_TEMPLATE_HASH_TABLE_SIZE 8192
+#define GLYPH_RUN_INSTANCE_CAPACITY        16384
+
+// GPU formats, see the run_template_glyph_t, run_template_t and run_instance_t structs in the vertex shader
+typedef struct {
+	int32_t      pen_x;  // in font units, relative to the first glyph of the template
+	float        left_side_bearing_px;
+	int32_t      distance_from_baseline_to_top_px;
+	int16_rect_t tex_coords;
+} glyph_run_template_glyph_t;
+
+typedef struct {
+	uint32_t first_glyph, glyph_count;  // only glyphs with a visual representation, e.g. no spaces
+	float    font_scale, baseline;      // baseline is the already rounded distance from the top of the text to the baseline
+} glyph_run_template_t;
+
+typedef struct {
+	float    x, y;            // top left corner of the text (same as for glyph_run_emit())
+	int32_t  pen_x;           // position of the first glyph of the template in font units, relative to x
+	uint32_t template_index;
+	color_t  color;
+} glyph_run_instance_t;
+
+// Key of a template in the hash table
+typedef struct {
+	const font_t* font;
+	float         font_scale;
+	uint8_t       length;
+	char          text[GLYPH_RUN_TEMPLATE_MAX_LENGTH + 1];  // zero terminated
+} glyph_run_template_key_t;
+
+typedef struct {
+	GLuint vao;  // empty, the shader only reads the buffers below. Belongs to the context glyph_run_templates_init() was called in.
+	GLuint template_glyphs_buffer, templates_buffer, instances_buffer;
+	
+	glyph_run_template_glyph_t* template_glyphs;
+	glyph_run_template_t*       templates;
+	glyph_run_template_key_t*   template_keys;
+	glyph_run_instance_t*       instances;
+	int template_glyph_count, template_count, instance_count;
+	int uploaded_template_glyph_count, uploaded_template_count;
+	int max_template_glyph_count;  // each run instance is drawn with 6 vertices for that many glyphs
+	int16_t hash_table[GLYPH_RUN_TEMPLATE_HASH_TABLE_SIZE];  // template index + 1, 0 for empty slots
+} glyph_run_templates_t;
+
+void glyph_run_templates_clear(glyph_run_templates_t* t) {
+	t->template_glyph_count = t->template_count = t->instance_count = 0;
+	t->uploaded_template_glyph_count = t->uploaded_template_count = 0;
+	t->max_template_glyph_count = 0;
+	memset(t->hash_table, 0, sizeof(t->hash_table));
+}
+
+void glyph_run_templates_init(glyph_run_templates_t* t) {
+	memset(t, 0, sizeof(*t));
+	t->template_glyphs = malloc(GLYPH_RUN_TEMPLATE_GLYPH_CAPACITY * sizeof(t->template_glyphs[0]));
+	t->templates       = malloc(GLYPH_RUN_TEMPLATE_CAPACITY * sizeof(t->templates[0]));
+	t->template_keys   = malloc(GLYPH_RUN_TEMPLATE_CAPACITY * sizeof(t->template_keys[0]));
+	t->instances       = malloc(GLYPH_RUN_INSTANCE_CAPACITY * sizeof(t->instances[0]));
+	
+	glCreateVertexArrays(1, &t->vao);
+	glCreateBuffers(1, &t->template_glyphs_buffer);
+	glCreateBuffers(1, &t->templates_buffer);
+	glCreateBuffers(1, &t->instances_buffer);
+	// Templates are only appended, so allocate their storage once and just upload the new ones
+	glNamedBufferStorage(t->template_glyphs_buffer, GLYPH_RUN_TEMPLATE_GLYPH_CAPACITY * sizeof(t->template_glyphs[0]), NULL, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(t->templates_buffer,       GLYPH_RUN_TEMPLATE_CAPACITY * sizeof(t->templates[0]),             NULL, GL_DYNAMIC_STORAGE_BIT);
+	glyph_run_templates_clear(t);
+}
+
+void glyph_run_templates_destroy(glyph_run_templates_t* t) {
+	GLuint buffers[] = { t->template_glyphs_buffer, t->templates_buffer, t->instances_buffer };
+	glDeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers);
+	glDeleteVertexArrays(1, &t->vao);
+	free(t->template_glyphs);
+	free(t->templates);
+	free(t->template_keys);
+	free(t->instances);
+}
+
+/**
+ * Returns the index of the template for the `length` bytes of UTF-8 at `text` (a word without spaces). Creates the
+ * template (and puts its glyphs into the atlas) if it doesn't exist yet. Returns -1 if there is no more space for
+ * the template or its glyphs don't fit into the atlas anymore.
+ */
+int glyph_run_template_get(glyph_run_templates_t* t, glyph_atlas_t* atlas, const font_t* font, float font_scale, const char* text, int length) {
+	// FNV-1a hash of the text, the font and the size. Then linear probing, like in glyph_atlas_get().
+	uint32_t hash = 2166136261u ^ (uint32_t)(uintptr_t)font ^ (uint32_t)(font_scale * 1000);
+	for (int i = 0; i < length; i++)
+		hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+	
+	size_t slot = hash % GLYPH_RUN_TEMPLATE_HASH_TABLE_SIZE;
+	while (t->hash_table[slot] != 0) {
+		const glyph_run_template_key_t* key = &t->template_keys[t->hash_table[slot] - 1];
+		if (key->font == font && key->font_scale == font_scale && key->length == length && memcmp(key->text, text, length) == 0)
+			return t->hash_table[slot] - 1;
+		slot = (slot + 1) % GLYPH_RUN_TEMPLATE_HASH_TABLE_SIZE;
+	}
+	
+	// Not found, create a new template. Keep the hash table at most half full so the probing stays short.
+	if (t->template_count >= GLYPH_RUN_TEMPLATE_CAPACITY || t->template_glyph_count + length > GLYPH_RUN_TEMPLATE_GLYPH_CAPACITY)
+		return -1;
+	// All glyphs of the template have to be in the atlas at the same time. Count the missing ones like
+	// glyph_run_fitting_glyphs() does.
+	int missing_glyphs = 0;
+	for (utf8_iterator_t it = utf8_first_n(text, length); it.codepoint != 0; it = utf8_next(it)) {
+		int glyph_index = (it.codepoint < 128) ? font->ascii_glyph_indices[it.codepoint] : stbtt_FindGlyphIndex(&font->info, it.codepoint);
+		if (atlas->hash_table[glyph_atlas_find(atlas, font, font_scale, glyph_index)].font == NULL)
+			missing_glyphs++;
+	}
+	if (missing_glyphs > glyph_atlas_free_items(atlas))
+		return -1;
+	int template_index = t->template_count++;
+	glyph_run_template_key_t* key = &t->template_keys[template_index];
+	*key = (glyph_run_template_key_t){ .font = font, .font_scale = font_scale, .length = length };
+	memcpy(key->text, text, length);
+	t->hash_table[slot] = template_index + 1;
+	
+	glyph_run_template_t* run_template = &t->templates[template_index];
+	*run_template = (glyph_run_template_t){ .first_glyph = t->template_glyph_count, .font_scale = font_scale, .baseline = round(font->ascent * font_scale) };
+	
+	// Same walk through the text as glyph_run_from_text()
+	int pen_x = 0, prev_glyph_index = -1;
+	for(utf8_iterator_t it = utf8_first(key->text); it.codepoint != 0; it = utf8_next(it)) {
+		uint32_t codepoint = it.codepoint;
+		int glyph_index = (codepoint < 128) ? font->ascii_glyph_indices[codepoint] : stbtt_FindGlyphIndex(&font->info, codepoint);
+		if (prev_glyph_index != -1)
+			pen_x += stbtt_GetGlyphKernAdvance(&font->info, prev_glyph_index, glyph_index);
+		prev_glyph_index = glyph_index;
+		
+		const glyph_atlas_item_t* item = glyph_atlas_get(atlas, font, font_scale, glyph_index);
+		if (item->tex_coords.left != -1) {
+			t->template_glyphs[t->template_glyph_count++] = (glyph_run_template_glyph_t){
+				.pen_x                            = pen_x,
+				.left_side_bearing_px             = item->left_side_bearing_px,
+				.distance_from_baseline_to_top_px = item->distance_from_baseline_to_top_px,
+				.tex_coords                       = item->tex_coords
+			};
+			run_template->glyph_count++;
+		}
+		
+		int glyph_advance_width = 0;
+		stbtt_GetGlyphHMetrics(&font->info, glyph_index, &glyph_advance_width, NULL);
+		pen_x += glyph_advance_width;
+	}
+	
+	if ((int)run_template->glyph_count > t->max_template_glyph_count)
+		t->max_template_glyph_count = run_template->glyph_count;
+	return template_index;
+}
+
+/**
+ * Adds run instances for one line of UTF-8 text at x, y (top left corner, the same as for glyph_run_emit()). The
+ * text is split into words at spaces and each word is drawn with its template. Stops at the end of the line ('\n').
+ * Words that start before `*words_done` bytes into the line are skipped, start each line with 0.
+ *
+ * Returns false if there is no more space for templates or instances or the glyphs of the next word don't fit into
+ * the atlas anymore. The words before that one are added and `*words_done` is moved past them. Draw the instances
+ * added so far, call glyph_run_templates_clear() (and glyph_atlas_clear() when the atlas is full) and add the line
+ * again with the same `*words_done` to continue with the word that didn't fit.
+ */
+bool glyph_run_templates_add_text(glyph_run_templates_t* t, glyph_atlas_t* atlas, const font_t* font, float font_size_pt, const char* text, float x, float y, color_t color, size_t* words_done) {
+	float font_scale = font_scale_for_size(font, font_size_pt);
+	
+	// Walk the line in font units like glyph_run_from_text(). The kerning between the space and the first glyph of a
+	// word goes into pen_x of the run instance, everything after that is part of the template.
+	int pen_x = 0, prev_glyph_index = -1;
+	const char* word_start = NULL, *codepoint_start = text;
+	int word_pen_x = 0;
+	for(utf8_iterator_t it = utf8_first(text); ; codepoint_start = it.buffer, it = utf8_next(it)) {
+		uint32_t codepoint = it.codepoint;
+		bool end_of_line = (codepoint == 0 || codepoint == '\n');
+		
+		// Finish the current word at spaces, the end of the line or when it gets too long for a template. it.buffer
+		// already points after the current codepoint.
+		if ( word_start && (end_of_line || codepoint == ' ' || it.buffer - word_start > GLYPH_RUN_TEMPLATE_MAX_LENGTH) ) {
+			if ((size_t)(word_start - text) >= *words_done) {
+				int template_index = glyph_run_template_get(t, atlas, font, font_scale, word_start, codepoint_start - word_start);
+				if (template_index == -1 || t->instance_count >= GLYPH_RUN_INSTANCE_CAPACITY) {
+					*words_done = word_start - text;
+					return false;
+				}
+				if (t->templates[template_index].glyph_count > 0)
+					t->instances[t->instance_count++] = (glyph_run_instance_t){ .x = x, .y = y, .pen_x = word_pen_x, .template_index = template_index, .color = color };
+			}
+			word_start = NULL;
+		}
+		if (end_of_line)
+			break;
+		
+		int glyph_index = (codepoint < 128) ? font->ascii_glyph_indices[codepoint] : stbtt_FindGlyphIndex(&font->info, codepoint);
+		if (prev_glyph_index != -1)
+			pen_x += stbtt_GetGlyphKernAdvance(&font->info, prev_glyph_index, glyph_index);
+		prev_glyph_index = glyph_index;
+		
+		if (!word_start && codepoint != ' ') {
+			word_start = codepoint_start;
+			word_pen_x = pen_x;
+		}
+		
+		int glyph_advance_width = 0;
+		stbtt_GetGlyphHMetrics(&font->info, glyph_index, &glyph_advance_width, NULL);
+		pen_x += glyph_advance_width;
+	}
+	
+	return true;
+}
+
+/**
+ * Uploads new templates and all run instances to instances_buffer. Draw them afterwards with the run template mode of
+ * the rect shader and then reset instance_count to 0 (see draw_run_instances() in main()). With a frame pacer
+ * draw_run_instances() streams the instances itself and only uses this for the templates (`include_instances` false).
+ */
+void glyph_run_templates_upload(glyph_run_templates_t* t, bool include_instances) {
+	if (t->uploaded_template_glyph_count < t->template_glyph_count) {
+		glNamedBufferSubData(t->template_glyphs_buffer, t->uploaded_template_glyph_count * sizeof(t->template_glyphs[0]),
+			(t->template_glyph_count - t->uploaded_template_glyph_count) * sizeof(t->template_glyphs[0]), t->template_glyphs + t->uploaded_template_glyph_count);
+		t->uploaded_template_glyph_count = t->template_glyph_count;
+	}
+	if (t->uploaded_template_count < t->template_count) {
+		glNamedBufferSubData(t->templates_buffer, t->uploaded_template_count * sizeof(t->templates[0]),
+			(t->template_count - t->uploaded_template_count) * sizeof(t->templates[0]), t->templates + t->uploaded_template_count);
+		t->uploaded_template_count = t->template_count;
+	}
+	
+	// Let the driver allocate new storage for the instances each time, like text_renderer_draw_rects() does
+	if (include_instances)
+		glNamedBufferData(t->instances_buffer, t->instance_count * sizeof(t->instances[0]), t->instances, GL_STREAM_DRAW);
+}
+
+/**
+ * Expands the run instances into rect instances on the CPU, exactly like the vertex shader does. Only used to check
+ * the templates against glyph_run_emit(). Returns the number of rects put into `rects`.
+ */
+int glyph_run_templates_expand(const glyph_run_templates_t* t, rect_instance_t* rects, int rects_capacity) {
+	int rects_filled = 0;
+	for (int i = 0; i < t->instance_count; i++) {
+		const glyph_run_instance_t* instance = &t->instances[i];
+		const glyph_run_template_t* run_template = &t->templates[instance->template_index];
+		for (uint32_t j = 0; j < run_template->glyph_count && rects_filled < rects_capacity; j++) {
+			const glyph_run_template_glyph_t* glyph = &t->template_glyphs[run_template->first_glyph + j];
+			float x_offset = (float)(instance->pen_x + glyph->pen_x) * run_template->font_scale;
+			float glyph_pos_x = (instance->x + x_offset) + glyph->left_side_bearing_px;
+			float glyph_pos_x_px = 0;
+			float glyph_pos_x_subpixel_shift = modff(glyph_pos_x, &glyph_pos_x_px);
+			float glyph_pos_y_px = round(instance->y + run_template->baseline) - glyph->distance_from_baseline_to_top_px;
+			int16_t left = glyph_pos_x_px - (subpixel_positioning_left_padding + horizontal_filter_padding), top = glyph_pos_y_px;
+			
+			rects[rects_filled++] = (rect_instance_t){
+				.pos.left   = left,
+				.pos.right  = left + (glyph->tex_coords.right  - glyph->tex_coords.left),
+				.pos.top    = top,
+				.pos.bottom = top  + (glyph->tex_coords.bottom - glyph->tex_coords.top),
+				.subpixel_shift = glyph_pos_x_subpixel_shift,
+				.tex_coords     = glyph->tex_coords,
+				.color          = instance->color,
+				.kind           = RECT_GLYPH
+			};
+		}
+	}
+	return rects_filled;
+}
+
+
+//
+// Cached text layers for panels with an opaque background
+//
+
+// Subpixel text can't be rendered once into a transparent texture and blended later. The dual-source blending needs
+// the background to blend each subpixel individually. But for panels with a known opaque background we can render
+// the text onto that background into an offscreen texture once. Each frame then just copies the texture into the
+// window instead of drawing all the glyphs again. Invalidate the layer when the panels text changes and it's
+// rendered again on the next frame.
+// Compositing uses glBlitNamedFramebuffer() since the layer is copied 1:1 to the window. That's the same as drawing
+// one textured quad per panel, just without the shader and vertex setup.
+typedef struct {
+	int x, y, width, height;  // position and size in the window (top-down y axis like all other coordinates)
+	color_t background_color;
+	GLuint texture, framebuffer;
+	bool valid;
+} text_layer_t;
+
+void text_layer_init(text_layer_t* layer, int x, int y, int width, int height, color_t background_color) {
+	*layer = (text_layer_t){ .x = x, .y = y, .width = width, .height = height, .background_color = background_color, .valid = false };
+	glCreateTextures(GL_TEXTURE_2D, 1, &layer->texture);
+	glTextureStorage2D(layer->texture, 1, GL_RGBA8, width, height);
+	glCreateFramebuffers(1, &layer->framebuffer);
+	glNamedFramebufferTexture(layer->framebuffer, GL_COLOR_ATTACHMENT0, layer->texture, 0);
+}
+
+void text_layer_destroy(text_layer_t* layer) {
+	glDeleteFramebuffers(1, &layer->framebuffer);
+	glDeleteTextures(1, &layer->texture);
+}
+
+void text_layer_invalidate(text_layer_t* layer) {
+	layer->valid = false;
+}
+
+/**
+ * Starts rendering into the layer: Binds its framebuffer and fills it with the background color. Draw the panel
+ * contents afterwards with coordinates relative to the top left corner of the layer, then call text_layer_end().
+ */
+void text_layer_begin(text_layer_t* layer) {
+	glBindFramebuffer(GL_FRAMEBUFFER, layer->framebuffer);
+	glViewport(0, 0, layer->width, layer->height);
+	color_t c = layer->background_color;
+	glClearColor(c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, 1.0);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void text_layer_end(text_layer_t* layer, int window_width, int window_height) {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, window_width, window_height);
+	layer->valid = true;
+}
+
+// Copies the layer into the window framebuffer. OpenGL framebuffers are bottom-up, so flip y.
+void text_layer_composite(const text_layer_t* layer, int window_height) {
+	int bottom = window_height - (layer->y + layer->height);
+	glBlitNamedFramebuffer(layer->framebuffer, 0,
+		0, 0, layer->width, layer->height,
+		layer->x, bottom, layer->x + layer->width, bottom + layer->height,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+
+//
+// Scroll cache: Reuse the last frame when scrolling and only draw the newly exposed lines
+//
+
+// Keeps the last frame of a scrolling view in an offscreen color buffer. When the view scrolls by an integer number
+// of pixels the old content is copied into a second buffer, shifted by the scroll delta, and only the newly exposed
+// strip has to be drawn. Two buffers because glBlitNamedFramebuffer() and glCopyImageSubData() don't allow overlapping
+// copies within the same image.
+typedef struct {
+	int width, height;
+	GLuint textures[2], framebuffers[2];
+	int current;  // index of the buffer that contains the last frame
+	bool valid;   // false if the whole view has to be redrawn (after a resize or when everything is damaged)
+} scroll_cache_t;
+
+void scroll_cache_destroy(scroll_cache_t* cache) {
+	glDeleteFramebuffers(2, cache->framebuffers);
+	glDeleteTextures(2, cache->textures);
+}
+
+void scroll_cache_resize(scroll_cache_t* cache, int width, int height) {
+	if (cache->textures[0])
+		scroll_cache_destroy(cache);
+	*cache = (scroll_cache_t){ .width = width, .height = height, .current = 0, .valid = false };
+	glCreateTextures(GL_TEXTURE_2D, 2, cache->textures);
+	glCreateFramebuffers(2, cache->framebuffers);
+	for (int i = 0; i < 2; i++) {
+		glTextureStorage2D(cache->textures[i], 1, GL_RGBA8, width, height);
+		glNamedFramebufferTexture(cache->framebuffers[i], GL_COLOR_ATTACHMENT0, cache->textures[i], 0);
+	}
+}
+
+void scroll_cache_invalidate(scroll_cache_t* cache) {
+	cache->valid = false;
+}
+
+/**
+ * Moves the content of the last frame up by `scroll_delta_px` (down for negative values) and returns the strip of the
+ * view that has to be drawn again in `damaged_top` and `damaged_bottom` (top-down y coordinates, bottom exclusive).
+ * Afterwards draw the damaged strip into `cache->framebuffers[cache->current]` and present it with scroll_cache_present().
+ */
+void scroll_cache_scroll(scroll_cache_t* cache, int scroll_delta_px, int* damaged_top, int* damaged_bottom) {
+	int h = cache->height;
+	if (!cache->valid || abs(scroll_delta_px) >= h) {
+		// Nothing to reuse, redraw everything
+		*damaged_top = 0;
+		*damaged_bottom = h;
+		cache->valid = true;
+		return;
+	} else if (scroll_delta_px == 0) {
+		*damaged_top = 0;
+		*damaged_bottom = 0;
+		return;
+	}
+	
+	// Copy the part that stays visible into the other buffer. In top-down coordinates scrolling down by delta (content
+	// moves up) copies source rows [delta, h) to [0, h - delta). OpenGL framebuffers are bottom-up so the rows are flipped.
+	int kept_height = h - abs(scroll_delta_px);
+	int src_top = (scroll_delta_px > 0) ? scroll_delta_px : 0;
+	int dst_top = (scroll_delta_px > 0) ? 0 : -scroll_delta_px;
+	int next = 1 - cache->current;
+	glBlitNamedFramebuffer(cache->framebuffers[cache->current], cache->framebuffers[next],
+		0, h - (src_top + kept_height), cache->width, h - src_top,
+		0, h - (dst_top + kept_height), cache->width, h - dst_top,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	cache->current = next;
+	
+	*damaged_top    = (scroll_delta_px > 0) ? kept_height : 0;
+	*damaged_bottom = (scroll_delta_px > 0) ? h : -scroll_delta_px;
+}
+
+// Copies the current frame into the window framebuffer
+void scroll_cache_present(const scroll_cache_t* cache) {
+	glBlitNamedFramebuffer(cache->framebuffers[cache->current], 0,
+		0, 0, cache->width, cache->height,
+		0, 0, cache->width, cache->height,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+//
+// Frame scheduler: Decides when the main window draws its next frame
+//
+
+// Everything that changes what's on screen calls frame_scheduler_invalidate() and everything that moves calls
+// frame_scheduler_animate() once for each frame it wants to move in. Both only mark the next frame as needed, so any
+// number of them before that frame result in just one frame. Frames are at least frame_interval apart (the refresh
+// period of the display) and without invalidations or animations no frame is needed at all, so the main loop can block
+// in SDL_WaitEvent().
+typedef struct {
+	double   frame_interval;       // in seconds
+	uint64_t last_frame_counter;   // performance counter at the start of the last frame, 0 before the first one
+	bool     invalidated, animating;
+	int      invalidations, frames, animation_frames;  // statistics
+} frame_scheduler_t;
+
+void frame_scheduler_invalidate(frame_scheduler_t* scheduler) {
+	scheduler->invalidated = true;
+	scheduler->invalidations++;
+}
+
+void frame_scheduler_animate(frame_scheduler_t* scheduler) {
+	scheduler->animating = true;
+}
+
+// Returns how many milliseconds to wait for events until the next frame is due. 0 if it's due now and -1 if no frame
+// is needed (wait until the next event).
+int frame_scheduler_timeout_ms(const frame_scheduler_t* scheduler) {
+	if (!scheduler->invalidated && !scheduler->animating)
+		return -1;
+	if (scheduler->last_frame_counter == 0)
+		return 0;
+	
+	double since_last_frame = (SDL_GetPerformanceCounter() - scheduler->last_frame_counter) / (double)SDL_GetPerformanceFrequency();
+	double remaining = scheduler->frame_interval - since_last_frame;
+	return (remaining > 0) ? ceil(remaining * 1000) : 0;
+}
+
+// Returns true if a frame is due now and starts it. Invalidations and animation requests made afterwards go into the
+// next frame.
+bool frame_scheduler_begin_frame(frame_scheduler_t* scheduler) {
+	if (frame_scheduler_timeout_ms(scheduler) != 0)
+		return false;
+	
+	scheduler->last_frame_counter = SDL_GetPerformanceCounter();
+	scheduler->frames++;
+	if (!scheduler->invalidated)
+		scheduler->animation_frames++;
+	scheduler->invalidated = false;
+	scheduler->animating = false;
+	return true;
+}
+
+
+//
+// Frame pacing: Bound how many frames the GPU may lag behind the CPU
+//
+
+// Each frame gets one of frames_in_flight slots in turn. At the end of a frame a fence is put into the command stream
+// for its slot and before the CPU starts a frame in that slot again it waits for that fence with glClientWaitSync().
+// So the CPU is never more than frames_in_flight frames ahead of the GPU, no matter how much the driver would buffer.
+//
+// The slots also own a region of a persistently mapped stream buffer each. Instance data is written there instead of
+// orphaning a buffer with glNamedBufferData() for each draw. The fence guarantees the GPU is done with the region
+// before it's overwritten, so there are no implicit stalls and no driver side copies.
+//
+// For tuning the pacer measures how long the CPU waited for fences and, with timestamp queries at the start and end of
+// each frame, how long the GPU was idle between frames. Too few frames in flight show up as GPU idle time (the CPU
+// couldn't deliver the next frame in time), too many as CPU wait time plus latency.
+#define FRAME_PACER_MAX_FRAMES 4
+
+typedef struct {
+	int      frames_in_flight;
+	int      current;              // slot of the frame the CPU is working on
+	bool     in_frame;             // true between frame_pacer_begin_frame() and frame_pacer_end_frame()
+	GLsync   fences[FRAME_PACER_MAX_FRAMES];
+	GLuint   timestamp_queries[FRAME_PACER_MAX_FRAMES][2];  // GPU time at the start and end of each slot's last frame
+	bool     queries_pending[FRAME_PACER_MAX_FRAMES];
+	uint64_t last_gpu_frame_end_ns;
+	
+	GLuint   stream_buffer;
+	uint8_t* stream_mapping;
+	size_t   region_size, region_filled;
+	
+	// Statistics
+	int      frames, gpu_frames_timed, stream_overflows;
+	double   cpu_wait_seconds, gpu_idle_seconds, gpu_busy_seconds;
+} frame_pacer_t;
+
+void frame_pacer_init(frame_pacer_t* pacer, int frames_in_flight, size_t region_size) {
+	*pacer = (frame_pacer_t){ .frames_in_flight = frames_in_flight, .region_size = region_size };
+	glGenQueries(FRAME_PACER_MAX_FRAMES * 2, pacer->timestamp_queries[0]);
+	
+	// GL_MAP_COHERENT_BIT so writes through the mapping are visible to the GPU without flushing them
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &pacer->stream_buffer);
+	glNamedBufferStorage(pacer->stream_buffer, frames_in_flight * region_size, NULL, flags);
+	pacer->stream_mapping = glMapNamedBufferRange(pacer->stream_buffer, 0, frames_in_flight * region_size, flags);
+}
+
+void frame_pacer_destroy(frame_pacer_t* pacer) {
+	for (int i = 0; i < FRAME_PACER_MAX_FRAMES; i++) {
+		if (pacer->fences[i])
+			glDeleteSync(pacer->fences[i]);
+	}
+	glDeleteQueries(FRAME_PACER_MAX_FRAMES * 2, pacer->timestamp_queries[0]);
+	glUnmapNamedBuffer(pacer->stream_buffer);
+	glDeleteBuffers(1, &pacer->stream_buffer);
+}
+
+// Waits until the GPU is done with the last frame of the current slot and starts a new frame in it
+void frame_pacer_begin_frame(frame_pacer_t* pacer) {
+	int slot = pacer->current;
+	if (pacer->fences[slot]) {
+		uint64_t wait_start = SDL_GetPerformanceCounter();
+		// The first wait flushes the command stream in case the fence hasn't been submitted yet
+		GLenum result = glClientWaitSync(pacer->fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(pacer->fences[slot], 0, 1000000000);
+		pacer->cpu_wait_seconds += (SDL_GetPerformanceCounter() - wait_start) / (double)SDL_GetPerformanceFrequency();
+		glDeleteSync(pacer->fences[slot]);
+		pacer->fences[slot] = NULL;
+	}
+	
+	// The fence signaled, so the timestamps of the slot's last frame are available without stalling. Slots are used in
+	// order, so this is also the order of the frames on the GPU.
+	if (pacer->queries_pending[slot]) {
+		uint64_t start_ns = 0, end_ns = 0;
+		glGetQueryObjectui64v(pacer->timestamp_queries[slot][0], GL_QUERY_RESULT, &start_ns);
+		glGetQueryObjectui64v(pacer->timestamp_queries[slot][1], GL_QUERY_RESULT, &end_ns);
+		if (pacer->last_gpu_frame_end_ns != 0 && start_ns > pacer->last_gpu_frame_end_ns)
+			pacer->gpu_idle_seconds += (start_ns - pacer->last_gpu_frame_end_ns) / 1e9;
+		pacer->gpu_busy_seconds += (end_ns - start_ns) / 1e9;
+		pacer->last_gpu_frame_end_ns = end_ns;
+		pacer->gpu_frames_timed++;
+		pacer->queries_pending[slot] = false;
+	}
+	
+	glQueryCounter(pacer->timestamp_queries[slot][0], GL_TIMESTAMP);
+	pacer->region_filled = 0;
+	pacer->in_frame = true;
+}
+
+/**
+ * Copies `size` bytes into the current slot's region of the stream buffer and returns their offset in stream_buffer.
+ * Returns -1 outside of a frame or if the region is full, use another way to get the data to the GPU then.
+ */
+ptrdiff_t frame_pacer_stream(frame_pacer_t* pacer, const void* data, size_t size) {
+	if (!pacer->in_frame || pacer->region_filled + size > pacer->region_size) {
+		pacer->stream_overflows += pacer->in_frame;
+		return -1;
+	}
+	
+	size_t offset = pacer->current * pacer->region_size + pacer->region_filled;
+	memcpy(pacer->stream_mapping + offset, data, size);
+	// Keep each upload aligned for the next one (vertex buffer offsets should be a multiple of the attribute size)
+	pacer->region_filled += (size + 255) & ~(size_t)255;
+	return offset;
+}
+
+// Call after the last command of a frame (e.g. after the swap)
+void frame_pacer_end_frame(frame_pacer_t* pacer) {
+	int slot = pacer->current;
+	glQueryCounter(pacer->timestamp_queries[slot][1], GL_TIMESTAMP);
+	pacer->queries_pending[slot] = true;
+	pacer->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pacer->current = (slot + 1) % pacer->frames_in_flight;
+	pacer->in_frame = false;
+	pacer->frames++;
+}
+
+
+//
+// Text traces: Record the immediate mode text calls of each frame and replay them (--record and --replay)
+//
+
+// A trace is a compact binary log of everything drawn with text_draw(), text_draw_run(), text_draw_rect() and the
+// clip rects, with the frame boundaries in between. Replaying it draws exactly the same frames again, as fast as
+// possible and without the application that recorded it. So a slow workload from production can be reproduced and
+// benchmarked with real text instead of "The quick brown fox".
+//
+// The file starts with TEXT_TRACE_MAGIC and the version as uint32_t, then come the records. Each record is one type
+// byte followed by its fields. Values are stored in the byte order of the recording machine (a byte swapped version
+// doesn't match, so those traces are rejected):
+//
+//   TEXT_TRACE_FONT         uint8 font id, uint16 path length, path (without zero terminator)
+//   TEXT_TRACE_FRAME_BEGIN  uint16 viewport width, uint16 viewport height
+//   TEXT_TRACE_FRAME_END    -
+//   TEXT_TRACE_TEXT         uint8 font id, float size in pt, float x, float y, color_t, uint32 length, UTF-8 text and zero terminator
+//   TEXT_TRACE_RUN          uint8 font id, float size in pt, float x, float y, color_t, uint32 glyph count, per glyph:
+//                           uint16 glyph index, float x_advance, float x_offset, float y_offset
+//   TEXT_TRACE_RECT         rect_instance_t (the clip_index is ignored)
+//   TEXT_TRACE_CLIP_BEGIN   float left, top, right, bottom
+//   TEXT_TRACE_CLIP_END     -
+//
+// Fonts are referenced by the path they were loaded from. A TEXT_TRACE_FONT record comes before the first record that
+// uses the font and replay loads the font from that path (relative to the current directory).
+#define TEXT_TRACE_MAGIC "TXTTRACE"
+#define TEXT_TRACE_VERSION 1
+#define TEXT_TRACE_HEADER_SIZE 12
+#define TEXT_TRACE_GLYPH_SIZE 14  // bytes per glyph of a TEXT_TRACE_RUN record
+#define TEXT_TRACE_MAX_FONTS 16
+
+enum {
+	TEXT_TRACE_FONT = 1, TEXT_TRACE_FRAME_BEGIN, TEXT_TRACE_FRAME_END, TEXT_TRACE_TEXT, TEXT_TRACE_RUN, TEXT_TRACE_RECT,
+	TEXT_TRACE_CLIP_BEGIN, TEXT_TRACE_CLIP_END
+};
+
+typedef struct {
+	FILE*         file;  // NULL when not recording
+	const font_t* fonts[TEXT_TRACE_MAX_FONTS];  // the index is the font id in the trace
+	int           font_count;
+	
+	// Statistics
+	int     frames, skipped_records;
+	int64_t records;
+} text_trace_writer_t;
+
+bool text_trace_writer_open(text_trace_writer_t* writer, const char* path) {
+	memset(writer, 0, sizeof(*writer));
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL)
+		return false;
+	// Records are small, so give stdio a buffer that holds a few frames
+	setvbuf(writer->file, NULL, _IOFBF, 256 * 1024);
+	uint32_t version = TEXT_TRACE_VERSION;
+	fwrite(TEXT_TRACE_MAGIC, 1, 8, writer->file);
+	fwrite(&version, sizeof(version), 1, writer->file);
+	return true;
+}
+
+// Returns false if writing failed somewhere along the way (e.g. the disk is full)
+bool text_trace_writer_close(text_trace_writer_t* writer) {
+	bool failed = ferror(writer->file);
+	if (fclose(writer->file) != 0)
+		failed = true;
+	writer->file = NULL;
+	return !failed;
+}
+
+void text_trace_put(text_trace_writer_t* writer, const void* data, size_t size) {
+	fwrite(data, 1, size, writer->file);
+}
+
+void text_trace_put_type(text_trace_writer_t* writer, uint8_t type) {
+	text_trace_put(writer, &type, sizeof(type));
+	writer->records++;
+}
+
+// Fonts have to be added with the path they were loaded from before anything is drawn with them
+void text_trace_add_font(text_trace_writer_t* writer, const font_t* font, const char* path) {
+	assert(writer->font_count < TEXT_TRACE_MAX_FONTS);
+	uint8_t font_id = writer->font_count;
+	uint16_t path_length = strlen(path);
+	writer->fonts[writer->font_count++] = font;
+	text_trace_put_type(writer, TEXT_TRACE_FONT);
+	text_trace_put(writer, &font_id, sizeof(font_id));
+	text_trace_put(writer, &path_length, sizeof(path_length));
+	text_trace_put(writer, path, path_length);
+}
+
+// Writes the fields both text and glyph runs start with. Returns false (and the record is skipped) for fonts that
+// weren't added to the trace.
+bool text_trace_put_text_header(text_trace_writer_t* writer, uint8_t type, const font_t* font, float font_size_pt, float x, float y, color_t color, uint32_t length) {
+	int font_id = 0;
+	while (font_id < writer->font_count && writer->fonts[font_id] != font)
+		font_id++;
+	if (font_id == writer->font_count) {
+		writer->skipped_records++;
+		return false;
+	}
+	
+	uint8_t font_id_u8 = font_id;
+	text_trace_put_type(writer, type);
+	text_trace_put(writer, &font_id_u8, sizeof(font_id_u8));
+	text_trace_put(writer, &font_size_pt, sizeof(font_size_pt));
+	text_trace_put(writer, &x, sizeof(x));
+	text_trace_put(writer, &y, sizeof(y));
+	text_trace_put(writer, &color, sizeof(color));
+	text_trace_put(writer, &length, sizeof(length));
+	return true;
+}
+
+void text_trace_frame_begin(text_trace_writer_t* writer, int viewport_width, int viewport_height) {
+	uint16_t size[2] = { viewport_width, viewport_height };
+	text_trace_put_type(writer, TEXT_TRACE_FRAME_BEGIN);
+	text_trace_put(writer, size, sizeof(size));
+}
+
+void text_trace_frame_end(text_trace_writer_t* writer) {
+	text_trace_put_type(writer, TEXT_TRACE_FRAME_END);
+	writer->frames++;
+}
+
+void text_trace_text(text_trace_writer_t* writer, const font_t* font, float font_size_pt, float x, float y, color_t color, const char* utf8, uint32_t length) {
+	if ( text_trace_put_text_header(writer, TEXT_TRACE_TEXT, font, font_size_pt, x, y, color, length) )
+		text_trace_put(writer, utf8, length + 1);
+}
+
+void text_trace_run(text_trace_writer_t* writer, const font_t* font, float font_size_pt, const glyph_t* glyphs, int glyph_count, float x, float y, color_t color) {
+	if ( !text_trace_put_text_header(writer, TEXT_TRACE_RUN, font, font_size_pt, x, y, color, glyph_count) )
+		return;
+	for (int i = 0; i < glyph_count; i++) {
+		uint16_t glyph_index = glyphs[i].glyph_index;
+		float values[3] = { glyphs[i].x_advance, glyphs[i].x_offset, glyphs[i].y_offset };
+		text_trace_put(writer, &glyph_index, sizeof(glyph_index));
+		text_trace_put(writer, values, sizeof(values));
+	}
+}
+
+void text_trace_rect(text_trace_writer_t* writer, rect_instance_t rect) {
+	text_trace_put_type(writer, TEXT_TRACE_RECT);
+	text_trace_put(writer, &rect, sizeof(rect));
+}
+
+void text_trace_clip_begin(text_trace_writer_t* writer, float left, float top, float right, float bottom) {
+	float clip[4] = { left, top, right, bottom };
+	text_trace_put_type(writer, TEXT_TRACE_CLIP_BEGIN);
+	text_trace_put(writer, clip, sizeof(clip));
+}
+
+void text_trace_clip_end(text_trace_writer_t* writer) {
+	text_trace_put_type(writer, TEXT_TRACE_CLIP_END);
+}
+
+// One decoded record. Only the fields of its type are set.
+typedef struct {
+	int             type;
+	const font_t*   font;
+	float           font_size_pt, x, y;
+	color_t         color;
+	const char*     text;         // TEXT_TRACE_TEXT: zero terminated, points into the trace
+	uint32_t        length;       // bytes of text or glyphs of the run
+	const glyph_t*  glyphs;       // TEXT_TRACE_RUN: decoded into a scratch buffer that the next record overwrites
+	rect_instance_t rect;
+	float           clip[4];
+	int             viewport_width, viewport_height;
+} text_trace_record_t;
+
+// A trace loaded for replay. text_trace_load() checks all records once, so text_trace_next() can't fail after that.
+typedef struct {
+	uint8_t* data;
+	size_t   size, pos;
+	
+	font_t fonts[TEXT_TRACE_MAX_FONTS];
+	void*  font_data[TEXT_TRACE_MAX_FONTS];
+	bool   font_loaded[TEXT_TRACE_MAX_FONTS];
+	
+	glyph_t* glyphs;
+	uint32_t glyph_capacity;
+	
+	// Filled by text_trace_load()
+	int     frame_count, max_viewport_width, max_viewport_height;
+	int64_t text_bytes, run_glyphs, rects;
+} text_trace_t;
+
+// Returns the next size bytes of the trace or NULL if the trace ends before that
+const uint8_t* text_trace_take(text_trace_t* trace, size_t size) {
+	if (size > trace->size - trace->pos)
+		return NULL;
+	const uint8_t* data = trace->data + trace->pos;
+	trace->pos += size;
+	return data;
+}
+
+// Copies the next size bytes of the trace into value, the trace data isn't aligned
+bool text_trace_get(text_trace_t* trace, void* value, size_t size) {
+	const uint8_t* data = text_trace_take(trace, size);
+	if (data)
+		memcpy(value, data, size);
+	return data != NULL;
+}
+
+// Decodes the next record. Returns false at the end of the trace or for a broken record (only while loading). Font
+// records are handled here, so the caller never sees them.
+bool text_trace_next(text_trace_t* trace, text_trace_record_t* record) {
+	while (true) {
+		uint8_t type = 0, font_id = 0;
+		if ( !text_trace_get(trace, &type, sizeof(type)) )
+			return false;
+		memset(record, 0, sizeof(*record));
+		record->type = type;
+		
+		switch (type) {
+			case TEXT_TRACE_FONT: {
+				uint16_t path_length = 0;
+				if ( !text_trace_get(trace, &font_id, sizeof(font_id)) || !text_trace_get(trace, &path_length, sizeof(path_length)) || font_id >= TEXT_TRACE_MAX_FONTS )
+					return false;
+				const uint8_t* path_data = text_trace_take(trace, path_length);
+				if (path_data == NULL)
+					return false;
+				if (trace->font_loaded[font_id])
+					continue;
+				
+				char path[path_length + 1];
+				memcpy(path, path_data, path_length);
+				path[path_length] = '\0';
+				trace->font_data[font_id] = fload(path, NULL);
+				if ( trace->font_data[font_id] == NULL || !font_init(&trace->fonts[font_id], trace->font_data[font_id]) ) {
+					fprintf(stderr, "Failed to load the font %s of the trace\n", path);
+					free(trace->font_data[font_id]);
+					trace->font_data[font_id] = NULL;
+					return false;
+				}
+				trace->font_loaded[font_id] = true;
+				continue;
+			}
+			case TEXT_TRACE_FRAME_BEGIN: {
+				uint16_t size[2] = { 0, 0 };
+				if ( !text_trace_get(trace, size, sizeof(size)) )
+					return false;
+				record->viewport_width = size[0];
+				record->viewport_height = size[1];
+				return true;
+			}
+			case TEXT_TRACE_FRAME_END:
+			case TEXT_TRACE_CLIP_END:
+				return true;
+			case TEXT_TRACE_TEXT:
+			case TEXT_TRACE_RUN: {
+				// Font id, size, x, y, color and length
+				const uint8_t* fields = text_trace_take(trace, 1 + 3 * sizeof(float) + sizeof(color_t) + sizeof(uint32_t));
+				if (fields == NULL)
+					return false;
+				font_id = fields[0];
+				memcpy(&record->font_size_pt, fields + 1,  sizeof(float));
+				memcpy(&record->x,            fields + 5,  sizeof(float));
+				memcpy(&record->y,            fields + 9,  sizeof(float));
+				memcpy(&record->color,        fields + 13, sizeof(color_t));
+				memcpy(&record->length,       fields + 17, sizeof(uint32_t));
+				if (font_id >= TEXT_TRACE_MAX_FONTS || !trace->font_loaded[font_id])
+					return false;
+				record->font = &trace->fonts[font_id];
+				
+				if (type == TEXT_TRACE_TEXT) {
+					record->text = (const char*)text_trace_take(trace, record->length + (size_t)1);
+					return record->text != NULL && record->text[record->length] == '\0';
+				}
+				
+				if (record->length > (trace->size - trace->pos) / TEXT_TRACE_GLYPH_SIZE)
+					return false;
+				if (record->length > trace->glyph_capacity) {
+					trace->glyph_capacity = record->length;
+					trace->glyphs = realloc(trace->glyphs, trace->glyph_capacity * sizeof(trace->glyphs[0]));
+				}
+				for (uint32_t i = 0; i < record->length; i++) {
+					uint16_t glyph_index = 0;
+					float values[3];
+					text_trace_get(trace, &glyph_index, sizeof(glyph_index));
+					text_trace_get(trace, values, sizeof(values));
+					trace->glyphs[i] = (glyph_t){ glyph_index, values[0], values[1], values[2] };
+				}
+				record->glyphs = trace->glyphs;
+				return true;
+			}
+			case TEXT_TRACE_RECT:
+				return text_trace_get(trace, &record->rect, sizeof(record->rect));
+			case TEXT_TRACE_CLIP_BEGIN:
+				return text_trace_get(trace, record->clip, sizeof(record->clip));
+			default:
+				return false;
+		}
+	}
+}
+
+void text_trace_rewind(text_trace_t* trace) {
+	trace->pos = TEXT_TRACE_HEADER_SIZE;
+}
+
+void text_trace_destroy(text_trace_t* trace) {
+	for (int i = 0; i < TEXT_TRACE_MAX_FONTS; i++) {
+		if (trace->font_loaded[i])
+			font_destroy(&trace->fonts[i]);
+		free(trace->font_data[i]);
+	}
+	free(trace->glyphs);
+	free(trace->data);
+	memset(trace, 0, sizeof(*trace));
+}
+
+// Loads the trace and its fonts and checks that all records are complete and all frames are closed. Prints what's
+// wrong and returns false otherwise.
+bool text_trace_load(text_trace_t* trace, const char* path) {
+	memset(trace, 0, sizeof(*trace));
+	trace->data = fload(path, &trace->size);
+	if (trace->data == NULL) {
+		fprintf(stderr, "Failed to read the trace %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	uint32_t version = 0;
+	if (trace->size >= TEXT_TRACE_HEADER_SIZE)
+		memcpy(&version, trace->data + 8, sizeof(version));
+	if ( trace->size < TEXT_TRACE_HEADER_SIZE || memcmp(trace->data, TEXT_TRACE_MAGIC, 8) != 0 || version != TEXT_TRACE_VERSION ) {
+		fprintf(stderr, "%s is not a version %d text trace of this byte order\n", path, TEXT_TRACE_VERSION);
+		text_trace_destroy(trace);
+		return false;
+	}
+	
+	text_trace_rewind(trace);
+	text_trace_record_t record;
+	size_t frames_end = trace->pos;
+	int64_t frame_text_bytes = 0, frame_run_glyphs = 0, frame_rects = 0;
+	bool in_frame = false, valid = true;
+	while (valid && trace->pos < trace->size) {
+		size_t record_start = trace->pos;
+		valid = text_trace_next(trace, &record);
+		if (!valid) {
+			trace->pos = record_start;
+			break;
+		}
+		// Everything but the frame boundaries belongs into a frame
+		if (record.type == TEXT_TRACE_FRAME_BEGIN) {
+			valid = !in_frame;
+			in_frame = true;
+			trace->max_viewport_width = (record.viewport_width > trace->max_viewport_width) ? record.viewport_width : trace->max_viewport_width;
+			trace->max_viewport_height = (record.viewport_height > trace->max_viewport_height) ? record.viewport_height : trace->max_viewport_height;
+		} else if (record.type == TEXT_TRACE_FRAME_END) {
+			valid = in_frame;
+			in_frame = false;
+			trace->frame_count++;
+			trace->text_bytes += frame_text_bytes;
+			trace->run_glyphs += frame_run_glyphs;
+			trace->rects += frame_rects;
+			frame_text_bytes = frame_run_glyphs = frame_rects = 0;
+			frames_end = trace->pos;
+		} else {
+			valid = in_frame;
+			frame_text_bytes += (record.type == TEXT_TRACE_TEXT) ? record.length : 0;
+			frame_run_glyphs += (record.type == TEXT_TRACE_RUN) ? record.length : 0;
+			frame_rects += (record.type == TEXT_TRACE_RECT);
+		}
+	}
+	// A trace cut off in the middle of a frame (e.g. the recording crashed) still replays all the complete frames
+	if (trace->frame_count == 0) {
+		fprintf(stderr, "%s: no complete frame, broken or incomplete record at offset %zu\n", path, trace->pos);
+		text_trace_destroy(trace);
+		return false;
+	} else if (!valid || in_frame) {
+		fprintf(stderr, "%s: broken or incomplete record at offset %zu, only the %d complete frames before it are replayed\n", path, trace->pos, trace->frame_count);
+	}
+	trace->size = frames_end;
+	text_trace_rewind(trace);
+	return true;
+}
+
+int compare_doubles(const void* a, const void* b) {
+	double da = *(const double*)a, db = *(const double*)b;
+	return (da > db) - (da < db);
+}
+
+// Prints the distribution of the frame times of a replay. With a timings_path the time of each frame (in ms) is also
+// written into that file, one line per frame.
+void text_trace_report(const char* label, const double* frame_seconds, int frame_count, const char* timings_path) {
+	double* sorted = malloc(frame_count * sizeof(sorted[0]));
+	memcpy(sorted, frame_seconds, frame_count * sizeof(sorted[0]));
+	qsort(sorted, frame_count, sizeof(sorted[0]), compare_doubles);
+	double total = 0;
+	for (int i = 0; i < frame_count; i++)
+		total += sorted[i];
+	printf("replay %s: %d frames in %.3f ms, per frame %.3f ms mean, %.3f ms median, %.3f ms p95, %.3f ms p99, %.3f ms max\n",
+		label, frame_count, total * 1000, total * 1000 / frame_count, sorted[frame_count / 2] * 1000,
+		sorted[frame_count * 95 / 100] * 1000, sorted[frame_count * 99 / 100] * 1000, sorted[frame_count - 1] * 1000);
+	free(sorted);
+	
+	if (timings_path) {
+		FILE* f = fopen(timings_path, "w");
+		if (f == NULL) {
+			fprintf(stderr, "Failed to write %s: %s\n", timings_path, strerror(errno));
+			return;
+		}
+		for (int i = 0; i < frame_count; i++)
+			fprintf(f, "%.4f\n", frame_seconds[i] * 1000);
+		fclose(f);
+	}
+}
+
+// Replays the trace without OpenGL (--replay-mode=cpu). That's only the layout part: Text is converted into glyph
+// runs and greeked text into its bars. Rasterizing glyphs, the atlas and drawing need OpenGL, use the headless mode
+// for those.
+int text_trace_replay_cpu(text_trace_t* trace, const char* timings_path) {
+	double* frame_seconds = malloc(trace->frame_count * sizeof(frame_seconds[0]));
+	glyph_t* glyphs = NULL;
+	rect_instance_t* rects = NULL;
+	uint32_t capacity = 0;
+	int64_t glyph_count = 0, greeked_rect_count = 0;
+	
+	text_trace_record_t record;
+	int frame = 0;
+	uint64_t frame_start = 0;
+	while ( text_trace_next(trace, &record) ) {
+		if (record.type == TEXT_TRACE_FRAME_BEGIN) {
+			frame_start = SDL_GetPerformanceCounter();
+		} else if (record.type == TEXT_TRACE_FRAME_END) {
+			frame_seconds[frame++] = (SDL_GetPerformanceCounter() - frame_start) / (double)SDL_GetPerformanceFrequency();
+		} else if (record.type == TEXT_TRACE_TEXT || record.type == TEXT_TRACE_RUN) {
+			// There are at most as many glyphs (and greeked words) as bytes or glyphs
+			if (record.length > capacity) {
+				capacity = record.length;
+				glyphs = realloc(glyphs, capacity * sizeof(glyphs[0]));
+				rects = realloc(rects, capacity * sizeof(rects[0]));
+			}
+			if ( text_is_greeked(record.font_size_pt) ) {
+				if (record.type == TEXT_TRACE_TEXT)
+					greeked_rect_count += text_emit_greeked(record.font, record.font_size_pt, record.text, record.x, record.y, record.color, rects, record.length);
+				else
+					greeked_rect_count += glyph_run_emit_greeked(record.font, record.font_size_pt, record.glyphs, record.length, record.x, record.y, record.color, rects, record.length);
+			} else if (record.type == TEXT_TRACE_TEXT) {
+				glyph_count += glyph_run_from_utf8(record.font, record.font_size_pt, record.text, record.length, glyphs, capacity);
+			}
+		}
+	}
+	
+	printf("replay cpu: %d frames, %lld bytes of text laid out into %lld glyphs, %lld greeked rects\n", frame,
+		(long long)trace->text_bytes, (long long)glyph_count, (long long)greeked_rect_count);
+	text_trace_report("cpu, layout", frame_seconds, frame, timings_path);
+	free(frame_seconds);
+	free(glyphs);
+	free(rects);
+	return 0;
+}
+
+
+//
+// Immediate mode text rendering: Any number of text calls per frame, drawn with one draw call per glyph atlas page
+//
+
+// Widgets call text_draw() (or text_draw_run() and text_draw_rect()) as often as they like between text_begin_frame()
+// and text_end_frame(). Each call only appends its rects to one shared instance stream and text_end_frame() draws the
+// whole stream with one instanced draw call. All rects use the same state, so the only reason for another draw is the
+// glyph atlas running full: Then the stream so far is drawn, the atlas is cleared and the frame continues with the
+// empty atlas. So it's one draw call per atlas "page", no matter how many widgets draw text. The rects are blended in
+// call order.
+// Scrollable panels clip their content with text_clip_begin() and text_clip_end() instead of glScissor(). Each clip
+// rect gets an entry in the clip rect uniform buffer and the rects drawn in between reference it by their
+// clip_index, so clipped panels still end up in the same draw call.
+// With --record all calls also go into a text trace, so the frames can be replayed later with --replay.
+// The renderer only uses the rect shader, its buffers and the glyph atlas, main() creates and destroys them. VAOs
+// can't be shared between OpenGL contexts, so set `vao` to the one of the current context before drawing into
+// another window.
+typedef struct {
+	GLuint         program, vao, instances_buffer, clip_rects_ubo;
+	float          coverage_adjustment;
+	glyph_atlas_t* atlas;
+	frame_pacer_t* pacer;  // with --frames-in-flight the rects go into its stream buffer, NULL otherwise
+	
+	// The instance stream of the current frame
+	rect_instance_t* rects;
+	int              rect_count, rect_capacity;
+	glyph_t*         glyphs;  // scratch buffer for the glyph runs of text_draw()
+	int              glyph_capacity;
+	int              viewport_width, viewport_height;
+	float            clip_rects[CLIP_RECT_CAPACITY][4];
+	int              clip_rect_count, clip_index;
+	
+	text_trace_writer_t trace;  // trace.file is NULL when not recording
+	
+	// Statistics
+	int     frames, calls, draw_calls, atlas_clears;
+	int64_t rects_drawn;
+} text_renderer_t;
+
+void text_renderer_init(text_renderer_t* renderer, GLuint program, GLuint vao, GLuint instances_buffer, GLuint clip_rects_ubo, glyph_atlas_t* atlas, frame_pacer_t* pacer) {
+	*renderer = (text_renderer_t){ .program = program, .vao = vao, .instances_buffer = instances_buffer, .clip_rects_ubo = clip_rects_ubo,
+		.atlas = atlas, .pacer = pacer, .clip_rect_count = 1 };
+}
+
+void text_renderer_destroy(text_renderer_t* renderer) {
+	free(renderer->rects);
+	free(renderer->glyphs);
+}
+
+// Sets up the state to draw rects with the rect shader into the currently bound framebuffer. viewport_width and
+// viewport_height are its size.
+void text_renderer_bind(const text_renderer_t* renderer, int viewport_width, int viewport_height) {
+	// Setup pre-multiplied alpha blending (that's why the source factor is GL_ONE) with dual source blending so we can blend
+	// each subpixel individually for subpixel anti-aliased glyph rendering (that's what GL_ONE_MINUS_SRC1_COLOR does).
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC1_COLOR);
+	
+	glBindVertexArray(renderer->vao);
+	glUseProgram(renderer->program);
+	// layout(location = 0) uniform vec2 half_viewport_size
+	// Note: Do a float division on viewport_width and viewport_height to properly handle uneven window dimensions.
+	// An integer division causes 1px artifacts in the middle of windows due to a wrong transform.
+	glProgramUniform2f(renderer->program, 0, viewport_width / 2.0f, viewport_height / 2.0f);
+	// layout(location = 1) uniform float coverage_adjustment
+	glProgramUniform1f(renderer->program, 1, renderer->coverage_adjustment);
+	
+	glyph_atlas_sync(renderer->atlas);
+	glBindTextureUnit(0, renderer->atlas->texture);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, renderer->clip_rects_ubo);
+}
+
+void text_renderer_unbind(const text_renderer_t* renderer) {
+	glUseProgram(0);
+	glBindVertexArray(0);
+}
+
+// Draws rects with one instanced draw call
+void text_renderer_draw_rects(text_renderer_t* renderer, const rect_instance_t* rects, int rect_count, int viewport_width, int viewport_height) {
+	// Upload the rects to the GPU.
+	// With --frames-in-flight put it into the stream buffer of the frame pacer, its fences make sure the GPU is done
+	// with that part of the buffer. Otherwise (or if it doesn't fit) allow the GPU driver to create a new buffer
+	// storage for each draw command. That way it doesn't have to wait for the previous draw command to finish to
+	// reuse the same buffer storage.
+	ptrdiff_t stream_offset = (renderer->pacer) ? frame_pacer_stream(renderer->pacer, rects, rect_count * sizeof(rects[0])) : -1;
+	if (stream_offset >= 0)
+		glVertexArrayVertexBuffer(renderer->vao, 1, renderer->pacer->stream_buffer, stream_offset, sizeof(rect_instance_t));
+	else
+		glNamedBufferData(renderer->instances_buffer, rect_count * sizeof(rects[0]), rects, GL_DYNAMIC_DRAW);
+	
+	text_renderer_bind(renderer, viewport_width, viewport_height);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, rect_count);
+	text_renderer_unbind(renderer);
+	
+	// We don't need the contents of the GPU buffer anymore
+	if (stream_offset >= 0)
+		glVertexArrayVertexBuffer(renderer->vao, 1, renderer->instances_buffer, 0, sizeof(rect_instance_t));
+	else
+		glInvalidateBufferData(renderer->instances_buffer);
+}
+
+void text_begin_frame(text_renderer_t* renderer, int viewport_width, int viewport_height) {
+	if (renderer->trace.file)
+		text_trace_frame_begin(&renderer->trace, viewport_width, viewport_height);
+	renderer->viewport_width = viewport_width;
+	renderer->viewport_height = viewport_height;
+	renderer->rect_count = 0;
+	renderer->clip_rect_count = 1;
+	renderer->clip_index = 0;
+}
+
+// Returns space for count more rects at the end of the stream, they're counted as soon as they're written
+rect_instance_t* text_frame_reserve(text_renderer_t* renderer, int count) {
+	if (renderer->rect_count + count > renderer->rect_capacity) {
+		while (renderer->rect_count + count > renderer->rect_capacity)
+			renderer->rect_capacity = (renderer->rect_capacity == 0) ? 1024 : renderer->rect_capacity * 2;
+		renderer->rects = realloc(renderer->rects, renderer->rect_capacity * sizeof(renderer->rects[0]));
+	}
+	return renderer->rects + renderer->rect_count;
+}
+
+void text_frame_flush(text_renderer_t* renderer) {
+	if (renderer->rect_count == 0)
+		return;
+	if (renderer->clip_rect_count > 1)
+		glNamedBufferSubData(renderer->clip_rects_ubo, 0, renderer->clip_rect_count * sizeof(renderer->clip_rects[0]), renderer->clip_rects);
+	text_renderer_draw_rects(renderer, renderer->rects, renderer->rect_count, renderer->viewport_width, renderer->viewport_height);
+	renderer->rects_drawn += renderer->rect_count;
+	renderer->rect_count = 0;
+	renderer->draw_calls++;
+}
+
+// Clips everything drawn until text_clip_end() to the rect (in pixels, rounded to whole pixels). Clip rects don't
+// nest, a new one replaces the current one.
+void text_clip_begin(text_renderer_t* renderer, float left, float top, float right, float bottom) {
+	if (renderer->trace.file)
+		text_trace_clip_begin(&renderer->trace, left, top, right, bottom);
+	if (renderer->clip_rect_count == CLIP_RECT_CAPACITY) {
+		// All clip rects used up: Draw everything so far and start over with the clip rects
+		text_frame_flush(renderer);
+		renderer->clip_rect_count = 1;
+	}
+	float* clip = renderer->clip_rects[renderer->clip_rect_count];
+	clip[0] = round(left);
+	clip[1] = round(top);
+	clip[2] = round(right);
+	clip[3] = round(bottom);
+	renderer->clip_index = renderer->clip_rect_count++;
+}
+
+void text_clip_end(text_renderer_t* renderer) {
+	if (renderer->trace.file)
+		text_trace_clip_end(&renderer->trace);
+	renderer->clip_index = 0;
+}
+
+void text_draw_rect(text_renderer_t* renderer, rect_instance_t rect) {
+	if (renderer->trace.file)
+		text_trace_rect(&renderer->trace, rect);
+	rect.clip_index = renderer->clip_index;
+	*text_frame_reserve(renderer, 1) = rect;
+	renderer->rect_count++;
+	renderer->calls++;
+}
+
+// Appends the rects of a glyph run, the part of text_draw_run() and text_draw() that isn't recorded
+void text_frame_add_run(text_renderer_t* renderer, const font_t* font, float font_size_pt, const glyph_t* glyphs, int glyph_count, float x, float y, color_t color) {
+	// Text too small to read is drawn as one bar per word and doesn't need the glyph atlas at all
+	if (text_is_greeked(font_size_pt)) {
+		rect_instance_t* rects = text_frame_reserve(renderer, glyph_count);
+		int rect_count = glyph_run_emit_greeked(font, font_size_pt, glyphs, glyph_count, x, y, color, rects, glyph_count);
+		for (int i = 0; i < rect_count; i++)
+			rects[i].clip_index = renderer->clip_index;
+		renderer->rect_count += rect_count;
+		renderer->calls++;
+		return;
+	}
+	
+	// Emit as many glyphs as fit into the current atlas page. When it's full draw everything so far, start a new page
+	// and continue with the rest of the run. So a run with more distinct glyphs than a page is spread over several.
+	// The pen position is carried over in the same order as in glyph_run_emit(), so the split doesn't move anything.
+	float pen_x = x;
+	while (glyph_count > 0) {
+		int fitting = glyph_run_fitting_glyphs(renderer->atlas, font, font_size_pt, glyphs, glyph_count);
+		if (fitting == 0) {
+			text_frame_flush(renderer);
+			glyph_atlas_clear(renderer->atlas);
+			renderer->atlas_clears++;
+			continue;
+		}
+		
+		rect_instance_t* rects = text_frame_reserve(renderer, fitting);
+		int rect_count = glyph_run_emit(renderer->atlas, font, font_size_pt, glyphs, fitting, pen_x, y, color, rects, fitting);
+		for (int i = 0; i < rect_count; i++)
+			rects[i].clip_index = renderer->clip_index;
+		renderer->rect_count += rect_count;
+		
+		for (int i = 0; i < fitting; i++)
+			pen_x += glyphs[i].x_advance;
+		glyphs += fitting;
+		glyph_count -= fitting;
+	}
+	renderer->calls++;
+}
+
+// Draws a glyph run from glyph_run_from_text(), x and y are the top left corner of the first line
+void text_draw_run(text_renderer_t* renderer, const font_t* font, float font_size_pt, const glyph_t* glyphs, int glyph_count, float x, float y, color_t color) {
+	if (renderer->trace.file)
+		text_trace_run(&renderer->trace, font, font_size_pt, glyphs, glyph_count, x, y, color);
+	text_frame_add_run(renderer, font, font_size_pt, glyphs, glyph_count, x, y, color);
+}
+
+// Lays out and draws UTF-8 text, x and y are the top left corner of the first line
+void text_draw(text_renderer_t* renderer, const font_t* font, float font_size_pt, float x, float y, color_t color, const char* utf8) {
+	// There are at most as many glyphs (and greeked words) as bytes
+	int text_length = strlen(utf8);
+	if (renderer->trace.file)
+		text_trace_text(&renderer->trace, font, font_size_pt, x, y, color, utf8, text_length);
+	if (text_is_greeked(font_size_pt)) {
+		rect_instance_t* rects = text_frame_reserve(renderer, text_length);
+		int rect_count = text_emit_greeked(font, font_size_pt, utf8, x, y, color, rects, text_length);
+		for (int i = 0; i < rect_count; i++)
+			rects[i].clip_index = renderer->clip_index;
+		renderer->rect_count += rect_count;
+		renderer->calls++;
+		return;
+	}
+	
+	if (text_length > renderer->glyph_capacity) {
+		renderer->glyph_capacity = text_length;
+		renderer->glyphs = realloc(renderer->glyphs, renderer->glyph_capacity * sizeof(renderer->glyphs[0]));
+	}
+	int glyph_count = glyph_run_from_text(font, font_size_pt, utf8, renderer->glyphs, renderer->glyph_capacity);
+	text_frame_add_run(renderer, font, font_size_pt, renderer->glyphs, glyph_count, x, y, color);
+}
+
+void text_end_frame(text_renderer_t* renderer) {
+	text_frame_flush(renderer);
+	renderer->frames++;
+	if (renderer->trace.file)
+		text_trace_frame_end(&renderer->trace);
+}
+
+
+//
+// Log file source: A growing log file that is indexed line by line (--tail)
+//
+
+// The line index holds the offset where each line starts. Appended bytes are read in chunks of LOG_FILE_CHUNK_SIZE
+// into a buffer, scanned for newlines (16 bytes at a time with SSE2) and only extend the index. A watcher thread waits
+// for changes of the file with inotify (or checks its size every few ms where inotify isn't available) and pushes an
+// SDL event. The main thread then calls log_file_update() to index the appended bytes. There is only one such event
+// pending at a time, writes in the meantime are picked up by that update anyway.
+// Nothing is memory mapped on purpose: The file can shrink at any time (e.g. logrotate with copytruncate), even
+// between the fstat() of an update and the scan of the new bytes. Reading mapped pages beyond the new end of the file
+// is a SIGBUS, read() just returns less. Only the main thread reads from the file descriptor, the watcher thread just
+// calls fstat() on it, so seeking is fine.
+// Not available on Windows, log_file_open() fails there.
+#define LOG_FILE_CHUNK_SIZE (256 * 1024)
+
+typedef struct {
+	int    fd;
+	size_t size;    // number of bytes indexed so far
+	char*  chunk;   // LOG_FILE_CHUNK_SIZE bytes to read the file into
+	
+	// line_starts[i] is the offset of line i. If the file ends with a newline the last entry is `size` (an empty line
+	// that doesn't count, see log_file_line_count()).
+	size_t* line_starts;
+	int     line_start_count, line_start_capacity;
+	
+	Uint32       update_event_type;  // SDL event pushed by the watcher thread when the file changed
+	SDL_Thread*  watch_thread;
+	SDL_atomic_t update_pending, stop_watching;
+	int          inotify_fd;         // -1 when polling the file size instead
+	int          poll_interval_ms;
+	
+	// Statistics
+	int     updates;
+	int64_t bytes_indexed;
+	double  index_seconds;
+} log_file_t;
+
+void log_file_add_line_start(log_file_t* file, size_t offset) {
+	if (file->line_start_count == file->line_start_capacity) {
+		file->line_start_capacity = (file->line_start_capacity == 0) ? 4096 : file->line_start_capacity * 2;
+		file->line_starts = realloc(file->line_starts, file->line_start_capacity * sizeof(file->line_starts[0]));
+	}
+	file->line_starts[file->line_start_count++] = offset;
+}
+
+// Adds the lines that start after each '\n' in data[0, length) to the line index, one byte at a time (memchr()). The
+// data starts at `offset` in the file.
+void log_file_scan_scalar(log_file_t* file, const char* data, size_t length, size_t offset) {
+	const char* pos = data, *end = data + length;
+	while ( (pos = memchr(pos, '\n', end - pos)) != NULL ) {
+		pos++;
+		log_file_add_line_start(file, offset + (pos - data));
+	}
+}
+
+// Same as log_file_scan_scalar(), with SSE2 where available. Compares 64 bytes at a time with '\n' and turns the
+// results into one bit mask. Log lines are short, so there's a newline in most blocks and that's cheaper than a
+// memchr() call per line.
+void log_file_scan(log_file_t* file, const char* data, size_t length, size_t offset) {
+	size_t pos = 0;
+#ifdef LOG_FILE_SSE2
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; pos + 64 <= length; pos += 64) {
+		const __m128i* block = (const __m128i*)(data + pos);
+		uint64_t mask =
+			  (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(block + 0), newline))
+			| (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(block + 1), newline)) << 16
+			| (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(block + 2), newline)) << 32
+			| (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(block + 3), newline)) << 48;
+		while (mask != 0) {
+			log_file_add_line_start(file, offset + pos + __builtin_ctzll(mask) + 1);
+			mask &= mask - 1;
+		}
+	}
+#endif
+	log_file_scan_scalar(file, data + pos, length - pos, offset + pos);
+}
+
+// Reads the bytes [file->size, size) chunk by chunk and adds their lines to the index. Stops early if the file got
+// shorter in the meantime. Returns false in that case, file->size is then where reading stopped.
+bool log_file_index(log_file_t* file, size_t size) {
+#ifdef _WIN32
+	return false;
+#else
+	if ( lseek(file->fd, file->size, SEEK_SET) == -1 )
+		return false;
+	while (file->size < size) {
+		size_t length = (size - file->size < LOG_FILE_CHUNK_SIZE) ? size - file->size : LOG_FILE_CHUNK_SIZE;
+		ssize_t bytes_read = read(file->fd, file->chunk, length);
+		if (bytes_read <= 0)
+			return false;
+		log_file_scan(file, file->chunk, bytes_read, file->size);
+		file->size += bytes_read;
+		file->bytes_indexed += bytes_read;
+	}
+	return true;
+#endif
+}
+
+// Current size of the file, -1 on error
+int64_t log_file_current_size(const log_file_t* file) {
+#ifdef _WIN32
+	return -1;
+#else
+	struct stat file_stat;
+	return (fstat(file->fd, &file_stat) == 0) ? file_stat.st_size : -1;
+#endif
+}
+
+int log_file_watch(void* data) {
+#ifndef _WIN32
+	log_file_t* file = data;
+	int64_t last_size = log_file_current_size(file);
+	while ( !SDL_AtomicGet(&file->stop_watching) ) {
+		bool changed = false;
+		if (file->inotify_fd != -1) {
+			// Wake up every 100 ms to check if we should stop
+			struct pollfd poll_fd = { .fd = file->inotify_fd, .events = POLLIN };
+			if ( poll(&poll_fd, 1, 100) > 0 ) {
+				// Drain all queued notifications (non-blocking fd), one update handles all of them
+				char buffer[4096] __attribute__((aligned(8)));
+				while ( read(file->inotify_fd, buffer, sizeof(buffer)) > 0 ) { }
+				changed = true;
+			}
+		} else {
+			SDL_Delay(file->poll_interval_ms);
+			int64_t size = log_file_current_size(file);
+			changed = (size != last_size);
+			last_size = size;
+		}
+		
+		if ( changed && SDL_AtomicCAS(&file->update_pending, 0, 1) ) {
+			SDL_Event event = { .type = file->update_event_type };
+			SDL_PushEvent(&event);
+		}
+	}
+#endif
+	return 0;
+}
+
+/**
+ * Opens and indexes the file and starts watching it for changes. SDL events of `update_event_type` are pushed when
+ * it changed, call log_file_update() then. With a `poll_interval_ms` of 0 it's watched with inotify where possible,
+ * otherwise its size is checked in that interval.
+ *
+ * Returns false and sets errno on error.
+ */
+bool log_file_open(log_file_t* file, const char* path, Uint32 update_event_type, int poll_interval_ms) {
+	*file = (log_file_t){ .fd = -1, .update_event_type = update_event_type, .inotify_fd = -1 };
+#ifdef _WIN32
+	errno = ENOSYS;
+	return false;
+#else
+	file->fd = open(path, O_RDONLY);
+	if (file->fd == -1)
+		return false;
+	int64_t size = log_file_current_size(file);
+	if (size < 0) {
+		int error = errno;
+		close(file->fd);
+		errno = error;
+		return false;
+	}
+	
+	// A file that shrinks while it's indexed for the first time is just indexed as far as it could be read, the next
+	// update starts over
+	uint64_t start = SDL_GetPerformanceCounter();
+	file->chunk = malloc(LOG_FILE_CHUNK_SIZE);
+	log_file_add_line_start(file, 0);
+	log_file_index(file, size);
+	file->index_seconds += (SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+	
+#ifdef __linux__
+	if (poll_interval_ms == 0) {
+		file->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if ( file->inotify_fd != -1 && inotify_add_watch(file->inotify_fd, path, IN_MODIFY) == -1 ) {
+			close(file->inotify_fd);
+			file->inotify_fd = -1;
+		}
+	}
+#endif
+	file->poll_interval_ms = (poll_interval_ms > 0) ? poll_interval_ms : 10;
+	if (update_event_type != 0)
+		file->watch_thread = SDL_CreateThread(log_file_watch, "log file watcher", file);
+	return true;
+#endif
+}
+
+void log_file_close(log_file_t* file) {
+#ifndef _WIN32
+	if (file->watch_thread) {
+		SDL_AtomicSet(&file->stop_watching, 1);
+		SDL_WaitThread(file->watch_thread, NULL);
+	}
+	if (file->inotify_fd != -1)
+		close(file->inotify_fd);
+	if (file->fd != -1)
+		close(file->fd);
+#endif
+	free(file->chunk);
+	free(file->line_starts);
+}
+
+int log_file_line_count(const log_file_t* file) {
+	bool ends_with_newline = (file->line_starts[file->line_start_count - 1] == file->size);
+	return file->line_start_count - (ends_with_newline ? 1 : 0);
+}
+
+// Reads line `index` without its line break ("\n" or "\r\n") into `buffer` and returns its length in bytes. Only the
+// first `capacity` bytes of longer lines are read. The line isn't zero terminated, decode it with utf8_first_n() or
+// glyph_run_from_utf8().
+// If the file shrank since the last update the line comes back shorter (or empty) until the event of the watcher
+// thread reindexes the file.
+size_t log_file_read_line(const log_file_t* file, int index, char* buffer, size_t capacity) {
+#ifdef _WIN32
+	return 0;
+#else
+	size_t start = file->line_starts[index];
+	size_t end = (index + 1 < file->line_start_count) ? file->line_starts[index + 1] - 1 : file->size;
+	size_t length = (end - start < capacity) ? end - start : capacity;
+	if ( lseek(file->fd, start, SEEK_SET) == -1 )
+		return 0;
+	ssize_t bytes_read = read(file->fd, buffer, length);
+	if (bytes_read <= 0)
+		return 0;
+	if ((size_t)bytes_read == end - start && buffer[bytes_read - 1] == '\r')
+		bytes_read--;
+	return bytes_read;
+#endif
+}
+
+/**
+ * Indexes what was appended to the file since the last update. If the file got shorter (e.g. truncated by a log
+ * rotation), before or while the new bytes are read, it's indexed again from the start. Returns the first line that
+ * changed (the last line might have grown if it didn't end with a newline), all lines before it stayed the same.
+ * Returns -1 if nothing changed.
+ */
+int log_file_update(log_file_t* file) {
+	// Clear the flag before looking at the file, so changes from now on push a new event
+	SDL_AtomicSet(&file->update_pending, 0);
+	int64_t size = log_file_current_size(file);
+	if (size < 0 || (size_t)size == file->size)
+		return -1;
+	
+	uint64_t start = SDL_GetPerformanceCounter();
+	if ((size_t)size < file->size) {
+		file->line_start_count = 1;
+		file->size = 0;
+	}
+	int first_changed_line = file->line_start_count - 1;
+	if ( !log_file_index(file, size) ) {
+		// Truncated while we read it: Start over with what's there now. If that fails too keep what could be read, the
+		// watcher thread pushes another event for the writes that come after the truncation.
+		file->line_start_count = 1;
+		file->size = 0;
+		first_changed_line = 0;
+		size = log_file_current_size(file);
+		if (size > 0)
+			log_file_index(file, size);
+	}
+	file->index_seconds += (SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+	file->updates++;
+	return first_changed_line;
+}
+
+
+//
+// Benchmarks. They run without a window or OpenGL context, e.g. "./main --bench=measure".
+//
+
+double seconds_since(uint64_t start_counter) {
+	return (SDL_GetPerformanceCounter() - start_counter) / (double)SDL_GetPerformanceFrequency();
+}
+
+// One line of the example log for the log view and the benchmarks
+void log_line_text(int line, char* buffer, size_t buffer_size) {
+	snprintf(buffer, buffer_size, "2026-10-18 12:%02d:%02d.%03d [%s] request %d handled in %d ms", (line / 3600) % 60, (line / 60) % 60, (line * 37) % 1000,
+		(line % 17 == 0) ? "WARN" : "INFO", line, (line * 7919) % 500);
+}
+
+int bench_measure(font_t* font) {
+	// Build 64 MiB of ASCII text with lines of varying length
+	const char* words[] = { "The", "quick", "brown", "fox", "jumps", "over", "the", "lazy", "dog.", "Hello,", "World!", "{ int x = 42; }" };
+	size_t text_size = 64 * 1024 * 1024, text_filled = 0;
+	char* text = malloc(text_size + 1);
+	for (int i = 0; text_filled < text_size; i++) {
+		const char* word = words[(i * 7) % (sizeof(words) / sizeof(words[0]))];
+		size_t word_length = strlen(word);
+		if (text_filled + word_length + 1 > text_size)
+			break;
+		memcpy(text + text_filled, word, word_length);
+		text_filled += word_length;
+		text[text_filled++] = (i % 13 == 12) ? '\n' : ' ';
+	}
+	text[text_filled] = '\0';
+	
+	int iterations = 10;
+	text_extents_t extents = {};
+	uint64_t start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < iterations; i++)
+		extents = text_measure(font, 10, text, text_filled);
+	double elapsed = seconds_since(start);
+	
+	printf("measure: %zu bytes x %d in %.3f s, %.2f GB/s (width %.1f px, height %.1f px, %d lines)\n",
+		text_filled, iterations, elapsed, text_filled * (double)iterations / elapsed / 1e9,
+		extents.width, extents.height, extents.line_count);
+	
+	free(text);
+	return 0;
+}
+
+
+int compare_rect_instances(const void* a, const void* b) {
+	const rect_instance_t *ra = a, *rb = b;
+	int16_t ka[] = { ra->pos.top, ra->pos.left, ra->pos.right, ra->pos.bottom, ra->tex_coords.left, ra->tex_coords.top };
+	int16_t kb[] = { rb->pos.top, rb->pos.left, rb->pos.right, rb->pos.bottom, rb->tex_coords.left, rb->tex_coords.top };
+	for (size_t i = 0; i < sizeof(ka) / sizeof(ka[0]); i++) {
+		if (ka[i] != kb[i])
+			return ka[i] - kb[i];
+	}
+	return (ra->subpixel_shift > rb->subpixel_shift) - (ra->subpixel_shift < rb->subpixel_shift);
+}
+
+bool rect_instances_equal(const rect_instance_t* a, const rect_instance_t* b) {
+	return memcmp(&a->pos, &b->pos, sizeof(a->pos)) == 0 && memcmp(&a->tex_coords, &b->tex_coords, sizeof(a->tex_coords)) == 0
+		&& memcmp(&a->color, &b->color, sizeof(a->color)) == 0 && a->subpixel_shift == b->subpixel_shift && a->kind == b->kind
+		&& a->clip_index == b->clip_index;
+}
+
+// Flattens the outlines of all glyphs of the font with the recursive subdivision of stbtt_Rasterize() and with
+// stbtt_FlattenShape() at a few sizes. Uses the same tolerance as stbtt_MakeGlyphBitmap() (0.35 pixels).
+int bench_flatten(font_t* font) {
+	int glyph_count = font->info.numGlyphs;
+	stbtt_vertex** shapes = malloc(glyph_count * sizeof(shapes[0]));
+	int* shape_vertex_counts = malloc(glyph_count * sizeof(shape_vertex_counts[0]));
+	for (int i = 0; i < glyph_count; i++)
+		shape_vertex_counts[i] = stbtt_GetGlyphShape(&font->info, i, &shapes[i]);
+	
+	float sizes_pt[] = { 10, 32, 128 };
+	int iterations = 20;
+	stbtt_flattened_shape flattened = {};
+	for (size_t s = 0; s < sizeof(sizes_pt) / sizeof(sizes_pt[0]); s++) {
+		float objspace_flatness = 0.35f / font_scale_for_size(font, sizes_pt[s]);
+		
+		int64_t recursive_points = 0, analytic_points = 0;
+		uint64_t start = SDL_GetPerformanceCounter();
+		for (int n = 0; n < iterations; n++) {
+			for (int i = 0; i < glyph_count; i++) {
+				int* contour_lengths = NULL;
+				int contour_count = 0;
+				stbtt__point* points = stbtt_FlattenCurves(shapes[i], shape_vertex_counts[i], objspace_flatness, &contour_lengths, &contour_count, NULL);
+				for (int c = 0; c < contour_count; c++)
+					recursive_points += contour_lengths[c];
+				STBTT_free(points, NULL);
+				STBTT_free(contour_lengths, NULL);
+			}
+		}
+		double recursive_time = seconds_since(start);
+		
+		start = SDL_GetPerformanceCounter();
+		for (int n = 0; n < iterations; n++) {
+			for (int i = 0; i < glyph_count; i++) {
+				stbtt_FlattenShape(&flattened, shapes[i], shape_vertex_counts[i], objspace_flatness, NULL);
+				analytic_points += flattened.num_points;
+			}
+		}
+		double analytic_time = seconds_since(start);
+		
+		int64_t glyphs_flattened = (int64_t)glyph_count * iterations;
+		printf("flatten: %5.1f pt, %d glyphs: recursive %6.0f ns/glyph (%5.1f points/glyph), analytic %6.0f ns/glyph (%5.1f points/glyph), %.2fx faster\n",
+			sizes_pt[s], glyph_count, recursive_time * 1e9 / glyphs_flattened, recursive_points / (double)glyphs_flattened,
+			analytic_time * 1e9 / glyphs_flattened, analytic_points / (double)glyphs_flattened, recursive_time / analytic_time);
+	}
+	
+	stbtt_FreeFlattenedShape(&flattened, NULL);
+	for (int i = 0; i < glyph_count; i++)
+		stbtt_FreeShape(&font->info, shapes[i]);
+	free(shapes);
+	free(shape_vertex_counts);
+	return 0;
+}
+
+// Compares the linked list and the array version of the active edge table of stb_truetype's rasterizer on the
+// glyphs with the most edges at 3x horizontal oversampling (like the glyph atlas). Use --font=... to run it on a
+// CJK font, their glyphs have a lot more edges.
+int bench_active_edges(font_t* font) {
+	// Find the 64 glyphs with the most vertices
+	int glyph_count = font->info.numGlyphs, heavy_count = 0;
+	int heavy_glyphs[64], heavy_vertex_counts[64];
+	for (int i = 0; i < glyph_count; i++) {
+		stbtt_vertex* vertices = NULL;
+		int vertex_count = stbtt_GetGlyphShape(&font->info, i, &vertices);
+		stbtt_FreeShape(&font->info, vertices);
+		
+		// Insertion sort into the list, most vertices first
+		int j = (heavy_count < 64) ? heavy_count++ : 64;
+		for (; j > 0 && heavy_vertex_counts[j - 1] < vertex_count; j--) {
+			if (j < 64) {
+				heavy_glyphs[j] = heavy_glyphs[j - 1];
+				heavy_vertex_counts[j] = heavy_vertex_counts[j - 1];
+			}
+		}
+		if (j < 64) {
+			heavy_glyphs[j] = i;
+			heavy_vertex_counts[j] = vertex_count;
+		}
+	}
+	
+	float sizes_pt[] = { 10, 16, 32, 64 };
+	int iterations = 50;
+	bool all_match = true;
+	for (size_t s = 0; s < sizeof(sizes_pt) / sizeof(sizes_pt[0]); s++) {
+		float scale_y = font_scale_for_size(font, sizes_pt[s]), scale_x = scale_y * 3;
+		double times[2] = {};
+		int64_t pixels = 0, mismatches = 0;
+		
+		for (int g = 0; g < heavy_count; g++) {
+			stbtt_vertex* vertices = NULL;
+			int vertex_count = stbtt_GetGlyphShape(&font->info, heavy_glyphs[g], &vertices);
+			int x0, y0, x1, y1;
+			stbtt_GetGlyphBitmapBox(&font->info, heavy_glyphs[g], scale_x, scale_y, &x0, &y0, &x1, &y1);
+			int w = x1 - x0, h = y1 - y0;
+			uint8_t* bitmaps[2] = { calloc(w * h + 1, 1), calloc(w * h + 1, 1) };
+			
+			int rasterizers[2] = { STBTT_RASTERIZER_DEFAULT, STBTT_RASTERIZER_EDGE_ARRAYS };
+			for (int r = 0; r < 2; r++) {
+				stbtt__bitmap bitmap = { .w = w, .h = h, .stride = w, .pixels = bitmaps[r] };
+				uint64_t start = SDL_GetPerformanceCounter();
+				for (int n = 0; n < iterations; n++)
+					stbtt_RasterizeEx(&bitmap, 0.35f, vertices, vertex_count, scale_x, scale_y, 0, 0, x0, y0, 1, rasterizers[r], NULL);
+				times[r] += seconds_since(start);
+			}
+			
+			pixels += w * h;
+			for (int i = 0; i < w * h; i++)
+				mismatches += (bitmaps[0][i] != bitmaps[1][i]);
+			
+			free(bitmaps[0]);
+			free(bitmaps[1]);
+			stbtt_FreeShape(&font->info, vertices);
+		}
+		all_match = all_match && (mismatches == 0);
+		
+		int64_t glyphs_rasterized = (int64_t)heavy_count * iterations;
+		printf("active-edges: %4.0f pt x3, %d glyphs with %d to %d vertices: list %7.2f us/glyph, arrays %7.2f us/glyph, %.2fx faster, %s (%lld of %lld pixels differ)\n",
+			sizes_pt[s], heavy_count, heavy_vertex_counts[heavy_count - 1], heavy_vertex_counts[0], times[0] * 1e6 / glyphs_rasterized, times[1] * 1e6 / glyphs_rasterized,
+			times[0] / times[1], (mismatches == 0) ? "identical" : "MISMATCH", (long long)mismatches, (long long)pixels);
+	}
+	
+	return all_match ? 0 : 1;
+}
+
+// Compares stb_truetype's version 2 rasterizer with the accumulation buffer rasterizer (STBTT_RASTERIZER_ACCUMULATE)
+// on the printable ASCII glyphs at 3x horizontal oversampling (like the glyph atlas) for a range of sizes. Checks that
+// both produce the same coverage (at most 1/255 apart) and shows the size where the accumulation buffer stops being
+// faster.
+int bench_rasterizers(font_t* font) {
+	float sizes_pt[] = { 6, 8, 10, 12, 14, 16, 20, 24, 32, 48, 64, 96, 128 };
+	int iterations = 20, max_allowed_difference = 1;
+	float crossover_pt = 0;
+	bool all_equivalent = true;
+	for (size_t s = 0; s < sizeof(sizes_pt) / sizeof(sizes_pt[0]); s++) {
+		float scale_y = font_scale_for_size(font, sizes_pt[s]), scale_x = scale_y * 3;
+		double times[2] = {};
+		int64_t pixels = 0, difference_sum = 0;
+		int glyph_count = 0, max_difference = 0;
+		
+		for (int codepoint = 33; codepoint < 127; codepoint++) {
+			int glyph_index = font->ascii_glyph_indices[codepoint];
+			stbtt_vertex* vertices = NULL;
+			int vertex_count = stbtt_GetGlyphShape(&font->info, glyph_index, &vertices);
+			int x0, y0, x1, y1;
+			stbtt_GetGlyphBitmapBox(&font->info, glyph_index, scale_x, scale_y, &x0, &y0, &x1, &y1);
+			int w = x1 - x0, h = y1 - y0;
+			uint8_t* bitmaps[2] = { calloc(w * h + 1, 1), calloc(w * h + 1, 1) };
+			
+			int rasterizers[2] = { STBTT_RASTERIZER_DEFAULT, STBTT_RASTERIZER_ACCUMULATE };
+			for (int r = 0; r < 2; r++) {
+				stbtt__bitmap bitmap = { .w = w, .h = h, .stride = w, .pixels = bitmaps[r] };
+				uint64_t start = SDL_GetPerformanceCounter();
+				for (int n = 0; n < iterations; n++)
+					stbtt_RasterizeEx(&bitmap, 0.35f, vertices, vertex_count, scale_x, scale_y, 0, 0, x0, y0, 1, rasterizers[r], NULL);
+				times[r] += seconds_since(start);
+			}
+			
+			for (int i = 0; i < w * h; i++) {
+				int difference = abs(bitmaps[0][i] - bitmaps[1][i]);
+				difference_sum += difference;
+				if (difference > max_difference)
+					max_difference = difference;
+			}
+			pixels += w * h;
+			glyph_count++;
+			
+			free(bitmaps[0]);
+			free(bitmaps[1]);
+			stbtt_FreeShape(&font->info, vertices);
+		}
+		
+		bool equivalent = (max_difference <= max_allowed_difference);
+		all_equivalent = all_equivalent && equivalent;
+		if (crossover_pt == 0 && times[1] >= times[0])
+			crossover_pt = sizes_pt[s];
+		
+		int64_t glyphs_rasterized = (int64_t)glyph_count * iterations;
+		printf("rasterizers: %5.0f pt x3: v2 %7.2f us/glyph, accumulate %7.2f us/glyph, %.2fx faster, max difference %d, mean %.4f, %s\n",
+			sizes_pt[s], times[0] * 1e6 / glyphs_rasterized, times[1] * 1e6 / glyphs_rasterized, times[0] / times[1],
+			max_difference, difference_sum / (double)(pixels ? pixels : 1), equivalent ? "equivalent" : "DIFFERENT");
+	}
+	
+	if (crossover_pt)
+		printf("rasterizers: the accumulation buffer is faster below %.0f pt\n", crossover_pt);
+	else
+		printf("rasterizers: the accumulation buffer is faster at all sizes\n");
+	return all_equivalent ? 0 : 1;
+}
+
+// Packs printable ASCII and Latin-1 into an atlas with stbtt_PackFontRanges() at several oversampling rates, once with
+// the SSE2 prefilters and once with the scalar ones. Both have to produce the same atlas.
+int bench_pack(font_t* font) {
+	int oversampling[][2] = { {2, 1}, {3, 1}, {2, 2}, {4, 4}, {8, 8} };
+	float font_size_px = 16;
+	int width = 2048, height = 2048, iterations = 10;
+	uint8_t* pixels[2] = { malloc(width * height), malloc(width * height) };
+	stbtt_packedchar chars[2][2][256] = {};
+	bool all_match = true;
+	
+	for (size_t o = 0; o < sizeof(oversampling) / sizeof(oversampling[0]); o++) {
+		double times[2] = {};
+		for (int simd = 0; simd < 2; simd++) {
+			for (int i = 0; i < iterations; i++) {
+				stbtt_pack_range ranges[2] = {
+					{ .font_size = font_size_px, .first_unicode_codepoint_in_range = 32,  .num_chars = 95, .chardata_for_range = chars[simd][0] },
+					{ .font_size = font_size_px, .first_unicode_codepoint_in_range = 160, .num_chars = 96, .chardata_for_range = chars[simd][1] },
+				};
+				stbtt_pack_context context;
+				stbtt_PackBegin(&context, pixels[simd], width, height, 0, 1, NULL);
+				stbtt_PackSetOversampling(&context, oversampling[o][0], oversampling[o][1]);
+				stbtt_PackSetSimdPrefilter(&context, simd);
+				uint64_t start = SDL_GetPerformanceCounter();
+				stbtt_PackFontRanges(&context, (uint8_t*)font->info.data, 0, ranges, 2);
+				times[simd] += seconds_since(start);
+				stbtt_PackEnd(&context);
+			}
+		}
+		
+		bool match = memcmp(pixels[0], pixels[1], width * height) == 0 && memcmp(chars[0], chars[1], sizeof(chars[0])) == 0;
+		all_match = all_match && match;
+		printf("pack: %.0f px, oversampling %dx%d: scalar prefilters %7.3f ms, sse2 prefilters %7.3f ms, %.2fx, %s\n",
+			font_size_px, oversampling[o][0], oversampling[o][1], times[0] * 1000 / iterations, times[1] * 1000 / iterations,
+			times[0] / times[1], match ? "match" : "MISMATCH");
+	}
+	
+	free(pixels[0]);
+	free(pixels[1]);
+	return all_match ? 0 : 1;
+}
+
+// Pre-warms every glyph of the font at 10 pt like glyph_atlas_prewarm() does, but into a CPU staging image only: Once
+// with the glyph boxes and left side bearings looked up in the font for each glyph (and the box again while
+// rasterizing), once with an empty glyph info cache and once with a filled one. The modes take turns and the fastest
+// of all iterations counts, the difference is small compared to the noise of the rasterization.
+int bench_glyph_info(font_t* font) {
+	float font_scale = font_scale_for_size(font, 10);
+	int glyph_count = font->info.numGlyphs, horizontal_resolution = 3, padding_px = subpixel_positioning_left_padding + 2 * horizontal_filter_padding;
+	int staging_width = 1024, row_height = 32, iterations = 30;
+	stbtt_glyph_request* requests = malloc(glyph_count * sizeof(requests[0]));
+	float* left_side_bearings = malloc(glyph_count * sizeof(left_side_bearings[0]));
+	size_t staging_size = (size_t)staging_width * horizontal_resolution * row_height * (glyph_count / 16 + 1);
+	uint8_t* staging[3] = { calloc(1, staging_size), calloc(1, staging_size), calloc(1, staging_size) };
+	const char* names[3] = { "uncached", "cold cache", "warm cache" };
+	double info_times[3] = { INFINITY, INFINITY, INFINITY }, raster_times[3] = { INFINITY, INFINITY, INFINITY };
+	bool all_match = true;
+	
+	for (int i = 0; i < iterations; i++) {
+		for (int mode = 0; mode < 3; mode++) {
+			// Uncached doesn't use the cache at all, cold starts with an empty one and warm with a full one
+			memset(font->glyph_infos, 0, glyph_count * sizeof(font->glyph_infos[0]));
+			if (mode == 2) {
+				for (int g = 0; g < glyph_count; g++)
+					font_glyph_info(font, g);
+			}
+			
+			// Bitmap boxes and left side bearings of all glyphs and the requests for them, packed into rows
+			uint64_t start = SDL_GetPerformanceCounter();
+			int request_count = 0, pen_x = 0, pen_y = 0;
+			for (int g = 0; g < glyph_count; g++) {
+				int x0 = 0, y0 = 0, x1 = 0, y1 = 0, left_side_bearing = 0;
+				const glyph_info_t* glyph_info = NULL;
+				if (mode == 0) {
+					stbtt_GetGlyphBitmapBox(&font->info, g, font_scale, font_scale, &x0, &y0, &x1, &y1);
+					stbtt_GetGlyphHMetrics(&font->info, g, NULL, &left_side_bearing);
+				} else {
+					glyph_info = font_glyph_info(font, g);
+					stbtt_GetBitmapBoxForGlyphBox(glyph_info->x0, glyph_info->y0, glyph_info->x1, glyph_info->y1, font_scale, font_scale, 0, 0, &x0, &y0, &x1, &y1);
+					left_side_bearing = glyph_info->left_side_bearing;
+				}
+				left_side_bearings[g] = left_side_bearing * font_scale;
+				int w = x1 - x0 + padding_px, h = y1 - y0;
+				if (x1 - x0 <= 0 || h <= 0 || h > row_height)
+					continue;
+				if (pen_x + w > staging_width) {
+					pen_x = 0;
+					pen_y += row_height;
+				}
+				requests[request_count++] = (stbtt_glyph_request){
+					.glyph   = g,
+					.scale_x = font_scale * horizontal_resolution, .scale_y = font_scale,
+					.x       = pen_x * horizontal_resolution, .y = pen_y,
+					.w       = w * horizontal_resolution, .h = h,
+					.glyph_x = (subpixel_positioning_left_padding + horizontal_filter_padding) * horizontal_resolution,
+					.has_box = (glyph_info != NULL),
+					.box     = { glyph_info ? glyph_info->x0 : 0, glyph_info ? glyph_info->y0 : 0, glyph_info ? glyph_info->x1 : 0, glyph_info ? glyph_info->y1 : 0 }
+				};
+				pen_x += w;
+			}
+			info_times[mode] = fmin(info_times[mode], seconds_since(start));
+			
+			start = SDL_GetPerformanceCounter();
+			stbtt_MakeGlyphBitmapBatch(&font->info, staging[mode], staging_width * horizontal_resolution, requests, request_count, STBTT_BATCH_LCD_FILTER);
+			raster_times[mode] = fmin(raster_times[mode], seconds_since(start));
+		}
+	}
+	
+	for (int mode = 0; mode < 3; mode++) {
+		bool match = memcmp(staging[0], staging[mode], staging_size) == 0;
+		all_match = all_match && match;
+		printf("glyph-info: %d glyphs at 10 pt, %-10s: boxes and requests %7.3f ms, rasterize and filter %7.3f ms, total %7.3f ms, %s\n",
+			glyph_count, names[mode], info_times[mode] * 1000, raster_times[mode] * 1000, (info_times[mode] + raster_times[mode]) * 1000,
+			match ? "match" : "MISMATCH");
+	}
+	
+	double uncached = info_times[0] + raster_times[0];
+	printf("glyph-info: full font pre-warm saves %.3f ms (%.1f%%) with a cold cache, %.3f ms (%.1f%%) with a warm cache\n",
+		(uncached - info_times[1] - raster_times[1]) * 1000, 100 * (1 - (info_times[1] + raster_times[1]) / uncached),
+		(uncached - info_times[2] - raster_times[2]) * 1000, 100 * (1 - (info_times[2] + raster_times[2]) / uncached));
+	
+	for (int mode = 0; mode < 3; mode++)
+		free(staging[mode]);
+	free(left_side_bearings);
+	free(requests);
+	return all_match ? 0 : 1;
+}
+
+// Writes a 128 MiB log file, scans it for line starts with memchr() and with the SSE2 scan of log_file_scan() and
+// checks that both find the same lines as log_file_open(). Then appends 10 MiB in chunks of 100 KiB and indexes each
+// chunk with log_file_update() like --tail does, to see how much of a core following a log that grows by 10 MiB/s
+// takes.
+int bench_tail() {
+	const char* path = "bench-tail.log";
+	size_t file_size = 128 * 1024 * 1024, append_size = 10 * 1024 * 1024, chunk_size = 100 * 1024;
+	FILE* f = fopen(path, "wb");
+	if (f == NULL) {
+		perror("fopen");
+		return 1;
+	}
+	char line_text[128];
+	int line = 0;
+	for (size_t written = 0; written < file_size; line++) {
+		log_line_text(line, line_text, sizeof(line_text));
+		written += fprintf(f, "%s\n", line_text);
+	}
+	fflush(f);
+	
+	log_file_t file;
+	if ( !log_file_open(&file, path, 0, 0) ) {
+		perror("log_file_open");
+		fclose(f);
+		remove(path);
+		return 1;
+	}
+	
+	// Scan the whole file again with both scans. From memory, so only the scans are timed and not read().
+	int iterations = 5, line_starts_size = file.line_start_count;
+	size_t* line_starts = malloc(line_starts_size * sizeof(line_starts[0]));
+	memcpy(line_starts, file.line_starts, line_starts_size * sizeof(line_starts[0]));
+	char* data = malloc(file.size);
+	FILE* r = fopen(path, "rb");
+	size_t data_size = r ? fread(data, 1, file.size, r) : 0;
+	if (r)
+		fclose(r);
+	double times[2] = { 0, 0 };
+	int mismatches = (data_size == file.size) ? 0 : 1;
+	for (int i = 0; i < iterations; i++) {
+		for (int method = 0; method < 2; method++) {
+			file.line_start_count = 1;
+			uint64_t start = SDL_GetPerformanceCounter();
+			if (method == 0)
+				log_file_scan_scalar(&file, data, data_size, 0);
+			else
+				log_file_scan(&file, data, data_size, 0);
+			times[method] += seconds_since(start);
+			
+			mismatches += abs(file.line_start_count - line_starts_size);
+			for (int l = 0; l < file.line_start_count && l < line_starts_size; l++)
+				mismatches += (file.line_starts[l] != line_starts[l]);
+		}
+	}
+	double mib = file.size / (1024.0 * 1024.0);
+	printf("tail: %.0f MiB, %d lines: memchr() %.3f ms (%.2f GiB/s), SSE2 scan %.3f ms (%.2f GiB/s), %.2fx, %s (%d mismatches)\n",
+		mib, log_file_line_count(&file), times[0] * 1000 / iterations, mib / 1024 / (times[0] / iterations),
+		times[1] * 1000 / iterations, mib / 1024 / (times[1] / iterations), times[0] / times[1],
+		(mismatches == 0) ? "match" : "MISMATCH", mismatches);
+	
+	// Append in chunks and only index what was appended
+	int lines_before = log_file_line_count(&file);
+	double update_seconds = 0, max_update_seconds = 0;
+	size_t appended = 0;
+	while (appended < append_size) {
+		for (size_t chunk = 0; chunk < chunk_size; line++) {
+			log_line_text(line, line_text, sizeof(line_text));
+			chunk += fprintf(f, "%s\n", line_text);
+		}
+		fflush(f);
+		
+		size_t size_before = file.size;
+		uint64_t start = SDL_GetPerformanceCounter();
+		log_file_update(&file);
+		double seconds = seconds_since(start);
+		update_seconds += seconds;
+		max_update_seconds = (seconds > max_update_seconds) ? seconds : max_update_seconds;
+		appended += file.size - size_before;
+	}
+	int updates = file.updates;
+	printf("tail: appended %.1f MiB (%d lines) in %d updates: %.3f ms per update, %.3f ms max, %.2f%% of a core at 10 MiB/s, %s\n",
+		appended / (1024.0 * 1024.0), log_file_line_count(&file) - lines_before, updates, update_seconds * 1000 / updates,
+		max_update_seconds * 1000, update_seconds / (appended / (10.0 * 1024 * 1024)) * 100,
+		(log_file_line_count(&file) == line) ? "all lines indexed" : "LINES MISSING");
+	bool all_indexed = (log_file_line_count(&file) == line);
+	
+	log_file_close(&file);
+	fclose(f);
+	remove(path);
+	free(data);
+	free(line_starts);
+	return (mismatches == 0 && all_indexed) ? 0 : 1;
+}
+
+// Needs an OpenGL context. Works headless with e.g. "SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./main --bench=gpu-layout".
+int bench_gpu_layout(font_t* font, glyph_atlas_t* atlas) {
+	gpu_text_layout_t layout;
+	if ( !gpu_text_layout_init(&layout) )
+		return 1;
+	GLuint cpu_instances_buffer = 0;
+	glCreateBuffers(1, &cpu_instances_buffer);
+	
+	const char* words[] = { "The", "quick", "brown", "fox", "jumps", "over", "the", "lazy", "dog.", "Größe", "AVATAR", "{ int x = 42; }", "-" };
+	float font_size_pt = 10, pos_x = 10.3, pos_y = 10;
+	color_t color = (color_t){218, 218, 218, 255};
+	int line_counts[] = { 100, 1000, 10000, 100000 };
+	bool all_match = true;
+	
+	for (size_t n = 0; n < sizeof(line_counts) / sizeof(line_counts[0]); n++) {
+		// Build a document with line_counts[n] lines of about 80 bytes each
+		int line_count = line_counts[n];
+		size_t text_size = line_count * 96 + 1, text_filled = 0;
+		char* text = malloc(text_size);
+		for (int line = 0, i = 0; line < line_count; line++) {
+			while (text_filled < (size_t)(line + 1) * 80) {
+				const char* word = words[(i++ * 7) % (sizeof(words) / sizeof(words[0]))];
+				text_filled += sprintf(text + text_filled, "%s ", word);
+			}
+			text[text_filled++] = (line == line_count - 1) ? '\0' : '\n';
+		}
+		
+		// GPU path: Upload the document once (also puts all glyphs into the atlas) and then run the layout
+		uint64_t start = SDL_GetPerformanceCounter();
+		gpu_text_layout_upload(&layout, atlas, font, font_size_pt, text);
+		glFinish();
+		double gpu_upload_time = seconds_since(start);
+		
+		int iterations = 5;
+		start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < iterations; i++)
+			gpu_text_layout_run(&layout, pos_x, pos_y, color);
+		glFinish();
+		double gpu_layout_time = seconds_since(start) / iterations;
+		
+		// CPU path: Layout the text, emit the rect instances and upload them, like the demo does for each frame
+		glyph_t* glyphs = malloc(text_filled * sizeof(glyphs[0]));
+		rect_instance_t* cpu_rects = malloc(text_filled * sizeof(cpu_rects[0]));
+		start = SDL_GetPerformanceCounter();
+		int glyph_count = glyph_run_from_text(font, font_size_pt, text, glyphs, text_filled);
+		int cpu_rect_count = glyph_run_emit(atlas, font, font_size_pt, glyphs, glyph_count, pos_x, pos_y, color, cpu_rects, text_filled);
+		glNamedBufferData(cpu_instances_buffer, cpu_rect_count * sizeof(cpu_rects[0]), cpu_rects, GL_STREAM_DRAW);
+		glFinish();
+		double cpu_time = seconds_since(start);
+		
+		// Read back the GPU results and compare them to the CPU results, both are in the same order
+		uint32_t draw_command[4] = {};
+		glGetNamedBufferSubData(layout.draw_command_buffer, 0, sizeof(draw_command), draw_command);
+		int gpu_rect_count = draw_command[1];
+		rect_instance_t* gpu_rects = malloc((gpu_rect_count + 1) * sizeof(gpu_rects[0]));
+		glGetNamedBufferSubData(layout.instances_buffer, 0, gpu_rect_count * sizeof(gpu_rects[0]), gpu_rects);
+		int mismatches = abs(gpu_rect_count - cpu_rect_count);
+		for (int i = 0; i < cpu_rect_count && i < gpu_rect_count; i++) {
+			if ( !rect_instances_equal(&cpu_rects[i], &gpu_rects[i]) )
+				mismatches++;
+		}
+		all_match = all_match && (mismatches == 0);
+		
+		printf("gpu-layout: %6d lines, %8d glyphs, %8d rects: cpu layout + upload %8.3f ms, gpu upload (once) %8.3f ms, gpu layout %8.3f ms, %s (%d mismatches)\n",
+			line_count, glyph_count, gpu_rect_count, cpu_time * 1000, gpu_upload_time * 1000, gpu_layout_time * 1000,
+			(mismatches == 0) ? "match" : "MISMATCH", mismatches);
+		
+		free(gpu_rects);
+		free(cpu_rects);
+		free(glyphs);
+		free(text);
+	}
+	
+	glDeleteBuffers(1, &cpu_instances_buffer);
+	gpu_text_layout_destroy(&layout);
+	return all_match ? 0 : 1;
+}
+
+// Needs an OpenGL context for the glyph atlas, e.g. "SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./main --bench=run-templates".
+int bench_run_templates(font_t* font, glyph_atlas_t* atlas) {
+	glyph_run_templates_t templates;
+	glyph_run_templates_init(&templates);
+	float font_size_pt = 10, pos_x = 10.3, line_height = 17;
+	color_t color = (color_t){218, 218, 218, 255};
+	int line_count = 100000, rect_capacity = 128 * 64;
+	rect_instance_t* rects          = malloc(rect_capacity * sizeof(rects[0]));
+	rect_instance_t* expanded_rects = malloc(rect_capacity * sizeof(expanded_rects[0]));
+	
+	// Lay out the log in chunks of 64 lines with both methods. Compare the rects the run instances expand into with
+	// the rects of glyph_run_emit() for each chunk.
+	double emit_time = 0, templates_time = 0;
+	int64_t rect_count = 0, run_instance_count = 0, mismatches = 0;
+	int template_clears = 0;
+	for (int chunk_start = 0; chunk_start < line_count; chunk_start += 64) {
+		int chunk_rect_count = 0;
+		uint64_t start = SDL_GetPerformanceCounter();
+		for (int line = chunk_start; line < chunk_start + 64 && line < line_count; line++) {
+			char line_text[128];
+			log_line_text(line, line_text, sizeof(line_text));
+			glyph_t glyphs[128];
+			int glyph_count = glyph_run_from_text(font, font_size_pt, line_text, glyphs, sizeof(glyphs) / sizeof(glyphs[0]));
+			chunk_rect_count += glyph_run_emit(atlas, font, font_size_pt, glyphs, glyph_count, pos_x, (line - chunk_start) * line_height, color, rects + chunk_rect_count, rect_capacity - chunk_rect_count);
+		}
+		emit_time += seconds_since(start);
+		
+		start = SDL_GetPerformanceCounter();
+		for (int line = chunk_start; line < chunk_start + 64 && line < line_count; line++) {
+			char line_text[128];
+			log_line_text(line, line_text, sizeof(line_text));
+			size_t words_done = 0;
+			if ( !glyph_run_templates_add_text(&templates, atlas, font, font_size_pt, line_text, pos_x, (line - chunk_start) * line_height, color, &words_done) ) {
+				// Templates full: In a real frame we would draw the instances so far here and then clear the templates.
+				// Just expand them instead and restart the chunk.
+				glyph_run_templates_clear(&templates);
+				template_clears++;
+				line = chunk_start - 1;
+			}
+		}
+		templates_time += seconds_since(start);
+		
+		int expanded_rect_count = glyph_run_templates_expand(&templates, expanded_rects, rect_capacity);
+		mismatches += abs(expanded_rect_count - chunk_rect_count);
+		qsort(rects, chunk_rect_count, sizeof(rects[0]), compare_rect_instances);
+		qsort(expanded_rects, expanded_rect_count, sizeof(expanded_rects[0]), compare_rect_instances);
+		for (int i = 0; i < chunk_rect_count && i < expanded_rect_count; i++) {
+			if ( !rect_instances_equal(&rects[i], &expanded_rects[i]) )
+				mismatches++;
+		}
+		
+		rect_count += chunk_rect_count;
+		run_instance_count += templates.instance_count;
+		templates.instance_count = 0;
+	}
+	
+	double rect_bytes = rect_count * sizeof(rect_instance_t), run_instance_bytes = run_instance_count * sizeof(glyph_run_instance_t);
+	printf("run-templates: %d lines, %lld glyph rects (%.1f MiB) vs %lld run instances (%.1f MiB), %.1f glyphs per run, instance stream %.1fx smaller\n",
+		line_count, (long long)rect_count, rect_bytes / (1024 * 1024), (long long)run_instance_count, run_instance_bytes / (1024 * 1024),
+		rect_count / (double)run_instance_count, rect_bytes / run_instance_bytes);
+	printf("run-templates: %d templates with %d glyphs (%d clears), longest template %d glyphs\n",
+		templates.template_count, templates.template_glyph_count, template_clears, templates.max_template_glyph_count);
+	printf("run-templates: layout with glyph_run_emit() %.3f ms, with templates %.3f ms, %s (%lld mismatches)\n",
+		emit_time * 1000, templates_time * 1000, (mismatches == 0) ? "match" : "MISMATCH", (long long)mismatches);
+	
+	free(rects);
+	free(expanded_rects);
+	glyph_run_templates_destroy(&templates);
+	return (mismatches == 0) ? 0 : 1;
+}
+
+// Fills an atlas with glyph_atlas_get() one glyph at a time and another one with glyph_atlas_prewarm(), then compares
+// the textures and items. Needs an OpenGL context, e.g. "SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./main --bench=batch-raster".
+int bench_batch_raster(font_t* font) {
+	// Printable ASCII and Latin-1, that's about what a page of western text needs
+	int glyph_indices[256], glyph_count = 0;
+	for (int codepoint = 33; codepoint < 256; codepoint++) {
+		if (codepoint >= 127 && codepoint < 161)
+			continue;
+		glyph_indices[glyph_count++] = stbtt_FindGlyphIndex(&font->info, codepoint);
+	}
+	float font_scale = font_scale_for_size(font, 10);
+	
+	int iterations = 20, width = 512, height = 512;
+	double single_time = 0, batch_time = 0;
+	uint8_t* single_pixels = malloc(width * height * 3);
+	uint8_t* batch_pixels  = malloc(width * height * 3);
+	glyph_atlas_t* single_atlas = malloc(sizeof(glyph_atlas_t));
+	glyph_atlas_t* batch_atlas  = malloc(sizeof(glyph_atlas_t));
+	int mismatches = 0;
+	for (int i = 0; i < iterations; i++) {
+		glyph_atlas_init(single_atlas, width, height);
+		glyph_atlas_init(batch_atlas, width, height);
+		glFinish();
+		
+		uint64_t start = SDL_GetPerformanceCounter();
+		for (int g = 0; g < glyph_count; g++)
+			glyph_atlas_get(single_atlas, font, font_scale, glyph_indices[g]);
+		glFinish();
+		single_time += seconds_since(start);
+		
+		start = SDL_GetPerformanceCounter();
+		glyph_atlas_prewarm(batch_atlas, font, font_scale, glyph_indices, glyph_count);
+		glFinish();
+		batch_time += seconds_since(start);
+		
+		if (i == iterations - 1) {
+			// Both have to end up with the same texture contents and the same items
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glGetTextureImage(single_atlas->texture, 0, GL_RGB, GL_UNSIGNED_BYTE, width * height * 3, single_pixels);
+			glGetTextureImage(batch_atlas->texture, 0, GL_RGB, GL_UNSIGNED_BYTE, width * height * 3, batch_pixels);
+			for (int p = 0; p < width * height * 3; p++)
+				mismatches += (single_pixels[p] != batch_pixels[p]);
+			for (int g = 0; g < glyph_count; g++) {
+				const glyph_atlas_item_t* a = glyph_atlas_get(single_atlas, font, font_scale, glyph_indices[g]);
+				const glyph_atlas_item_t* b = glyph_atlas_get(batch_atlas, font, font_scale, glyph_indices[g]);
+				if ( memcmp(&a->tex_coords, &b->tex_coords, sizeof(a->tex_coords)) != 0 || a->distance_from_baseline_to_top_px != b->distance_from_baseline_to_top_px
+					|| a->left_side_bearing_px != b->left_side_bearing_px )
+					mismatches++;
+			}
+		}
+		
+		glyph_atlas_destroy(single_atlas);
+		glyph_atlas_destroy(batch_atlas);
+	}
+	
+	printf("batch-raster: %d glyphs at 10 pt: one at a time %.3f ms, batched %.3f ms, %.2fx, %s (%d mismatches)\n",
+		glyph_count, single_time * 1000 / iterations, batch_time * 1000 / iterations, single_time / batch_time,
+		(mismatches == 0) ? "match" : "MISMATCH", mismatches);
+	
+	free(single_atlas);
+	free(batch_atlas);
+	free(single_pixels);
+	free(batch_pixels);
+	return (mismatches == 0) ? 0 : 1;
+}
+
+// Builds an LCD atlas of printable ASCII and Latin-1 with one stbtt_PackFontRanges() call and compares each glyph to
+// the one glyph_atlas_get() rasterizes. Needs an OpenGL context, e.g. "SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./main --bench=pack-lcd".
+int bench_pack_lcd(font_t* font) {
+	float font_size_pt = 10, font_scale = font_scale_for_size(font, font_size_pt);
+	int width = 512, height = 512, iterations = 20;
+	stbtt_packedchar chars[2][96] = {};
+	stbtt_pack_range ranges[2] = {
+		{ .font_size = STBTT_POINT_SIZE(font_size_pt * 1.333333), .first_unicode_codepoint_in_range = 32,  .num_chars = 95, .chardata_for_range = chars[0] },
+		{ .font_size = STBTT_POINT_SIZE(font_size_pt * 1.333333), .first_unicode_codepoint_in_range = 160, .num_chars = 96, .chardata_for_range = chars[1] },
+	};
+	
+	// One call for all glyphs, including the rasterization and the LCD filter
+	uint8_t* packed_pixels = malloc(width * height * 3);
+	double pack_time = 0;
+	int packed_width = 0, packed_height = 0;
+	for (int i = 0; i < iterations; i++) {
+		stbtt_pack_context context;
+		stbtt_PackBeginLcd(&context, packed_pixels, width, height, 0, 1, NULL);
+		uint64_t start = SDL_GetPerformanceCounter();
+		if ( !stbtt_PackFontRanges(&context, (uint8_t*)font->info.data, 0, ranges, 2) ) {
+			fprintf(stderr, "pack-lcd: the glyphs don't fit into %dx%d\n", width, height);
+			return 1;
+		}
+		pack_time += seconds_since(start);
+		stbtt_PackEnd(&context);
+	}
+	
+	// The same glyphs one at a time, read back from the atlas texture
+	glyph_atlas_t* atlas = malloc(sizeof(glyph_atlas_t));
+	uint8_t* atlas_pixels = malloc(width * height * 3);
+	double atlas_time = 0;
+	for (int i = 0; i < iterations; i++) {
+		glyph_atlas_init(atlas, width, height);
+		glFinish();
+		uint64_t start = SDL_GetPerformanceCounter();
+		for (int r = 0; r < 2; r++) {
+			for (int c = 0; c < ranges[r].num_chars; c++)
+				glyph_atlas_get(atlas, font, font_scale, stbtt_FindGlyphIndex(&font->info, ranges[r].first_unicode_codepoint_in_range + c));
+		}
+		glFinish();
+		atlas_time += seconds_since(start);
+		if (i < iterations - 1)
+			glyph_atlas_destroy(atlas);
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTextureImage(atlas->texture, 0, GL_RGB, GL_UNSIGNED_BYTE, width * height * 3, atlas_pixels);
+	
+	// Compare the padded glyph rects and the vertical metrics. The rects of glyphs without visual representation are
+	// empty in the atlas but still have their padding in the packed atlas.
+	int glyph_count = 0, mismatches = 0;
+	float max_xoff_difference = 0;
+	for (int r = 0; r < 2; r++) {
+		for (int c = 0; c < ranges[r].num_chars; c++) {
+			int glyph_index = stbtt_FindGlyphIndex(&font->info, ranges[r].first_unicode_codepoint_in_range + c);
+			const glyph_atlas_item_t* item = glyph_atlas_get(atlas, font, font_scale, glyph_index);
+			const stbtt_packedchar* packed = &chars[r][c];
+			if (packed->x1 > packed_width)
+				packed_width = packed->x1;
+			if (packed->y1 > packed_height)
+				packed_height = packed->y1;
+			if (item->tex_coords.left == -1)
+				continue;
+			
+			glyph_count++;
+			int w = item->tex_coords.right - item->tex_coords.left, h = item->tex_coords.bottom - item->tex_coords.top;
+			if (packed->x1 - packed->x0 != w || packed->y1 - packed->y0 != h || packed->yoff != -item->distance_from_baseline_to_top_px) {
+				mismatches++;
+				continue;
+			}
+			for (int y = 0; y < h; y++) {
+				const uint8_t* a = atlas_pixels  + ((item->tex_coords.top + y) * width + item->tex_coords.left) * 3;
+				const uint8_t* b = packed_pixels + ((packed->y0 + y) * width + packed->x0) * 3;
+				if (memcmp(a, b, w * 3) != 0) {
+					mismatches++;
+					break;
+				}
+			}
+			// glyph_run_emit() places the glyph by its left side bearing, the packed char by where it was rasterized
+			float xoff_difference = fabsf(packed->xoff + (subpixel_positioning_left_padding + horizontal_filter_padding) - item->left_side_bearing_px);
+			if (xoff_difference > max_xoff_difference)
+				max_xoff_difference = xoff_difference;
+		}
+	}
+	
+	printf("pack-lcd: %d glyphs at %.0f pt in %dx%d px: stbtt_PackFontRanges() %.3f ms, glyph_atlas_get() one at a time %.3f ms, %s (%d mismatches), xoff vs left side bearing max %.3f px\n",
+		glyph_count, font_size_pt, packed_width, packed_height, pack_time * 1000 / iterations, atlas_time * 1000 / iterations,
+		(mismatches == 0) ? "match" : "MISMATCH", mismatches, max_xoff_difference);
+	
+	glyph_atlas_destroy(atlas);
+	free(atlas);
+	free(atlas_pixels);
+	free(packed_pixels);
+	return (mismatches == 0) ? 0 : 1;
+}
+
+// Draws a grid of scrolled text panels into an offscreen framebuffer, once with one glScissor() and draw per panel and
+// once with all panels in one draw with clip rects (rect_instance_t.clip_index). Compares the resulting images. Needs
+// the rect shader, e.g. "SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./main --bench=clip".
+int bench_clip(font_t* font, glyph_atlas_t* atlas, GLuint shader_program, GLuint vao, GLuint instances_buffer, GLuint clip_rects_ubo) {
+	int width = 800, height = 600, columns = 10, rows = 10, iterations = 100;
+	int panel_width = width / columns, panel_height = height / rows, panel_count = columns * rows;
+	float font_size_pt = 10, line_height = 17;
+	color_t text_color = (color_t){218, 218, 218, 255};
+	
+	// Each panel has a background and 5 log lines that are wider than the panel. The lines are scrolled by a different
+	// amount in each panel so they're cut off at the top and bottom too.
+	int rect_capacity = panel_count * (1 + 5 * 128);
+	rect_instance_t* rects = malloc(rect_capacity * sizeof(rects[0]));
+	int* panel_first_rect = malloc((panel_count + 1) * sizeof(panel_first_rect[0]));
+	float (*clip_rects)[4] = calloc(panel_count + 1, sizeof(clip_rects[0]));
+	int rect_count = 0;
+	for (int p = 0; p < panel_count; p++) {
+		float left = (p % columns) * panel_width, top = (p / columns) * panel_height;
+		float scroll = (p * 7) % (int)line_height;
+		panel_first_rect[p] = rect_count;
+		rects[rect_count++] = solid_rect(left + 2, top + 2, left + panel_width - 2, top + panel_height - 2, (color_t){ 32 + (p % 3) * 12, 40, 48, 255 });
+		for (int line = 0; line < 5; line++) {
+			char line_text[128];
+			log_line_text(p * 5 + line, line_text, sizeof(line_text));
+			glyph_t glyphs[128];
+			int glyph_count = glyph_run_from_text(font, font_size_pt, line_text, glyphs, sizeof(glyphs) / sizeof(glyphs[0]));
+			rect_count += glyph_run_emit(atlas, font, font_size_pt, glyphs, glyph_count, left + 4, top - scroll + line * line_height, text_color, rects + rect_count, rect_capacity - rect_count);
+		}
+		
+		float* clip = clip_rects[p + 1];
+		clip[0] = left + 2;
+		clip[1] = top + 2;
+		clip[2] = left + panel_width - 2;
+		clip[3] = top + panel_height - 2;
+	}
+	panel_first_rect[panel_count] = rect_count;
+	
+	GLuint texture = 0, framebuffer = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, 1, GL_RGBA8, width, height);
+	glCreateFramebuffers(1, &framebuffer);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, texture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+	
+	// Same state as text_renderer_bind()
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC1_COLOR);
+	glBindVertexArray(vao);
+	glUseProgram(shader_program);
+	glProgramUniform2f(shader_program, 0, width / 2.0f, height / 2.0f);
+	glProgramUniform1f(shader_program, 1, 0);
+	glyph_atlas_sync(atlas);
+	glBindTextureUnit(0, atlas->texture);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, clip_rects_ubo);
+	
+	uint8_t* images[2] = { malloc(width * height * 4), malloc(width * height * 4) };
+	double times[2] = { 0, 0 };
+	for (int i = 0; i < iterations; i++) {
+		for (int method = 0; method < 2; method++) {
+			glClearColor(0.25, 0.25, 0.25, 1.0);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glFinish();
+			
+			uint64_t start = SDL_GetPerformanceCounter();
+			if (method == 0) {
+				// One draw per panel, clipped with glScissor() (bottom-up coordinates)
+				glEnable(GL_SCISSOR_TEST);
+				for (int p = 0; p < panel_count; p++) {
+					const float* clip = clip_rects[p + 1];
+					glScissor(clip[0], height - clip[3], clip[2] - clip[0], clip[3] - clip[1]);
+					int count = panel_first_rect[p + 1] - panel_first_rect[p];
+					glNamedBufferData(instances_buffer, count * sizeof(rects[0]), rects + panel_first_rect[p], GL_DYNAMIC_DRAW);
+					glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+				}
+				glDisable(GL_SCISSOR_TEST);
+			} else {
+				// All panels in one draw, each rect clipped to the clip rect of its panel
+				for (int p = 0; p < panel_count; p++) {
+					for (int r = panel_first_rect[p]; r < panel_first_rect[p + 1]; r++)
+						rects[r].clip_index = p + 1;
+				}
+				glNamedBufferSubData(clip_rects_ubo, 0, (panel_count + 1) * sizeof(clip_rects[0]), clip_rects);
+				glNamedBufferData(instances_buffer, rect_count * sizeof(rects[0]), rects, GL_DYNAMIC_DRAW);
+				glDrawArraysInstanced(GL_TRIANGLES, 0, 6, rect_count);
+				for (int r = 0; r < rect_count; r++)
+					rects[r].clip_index = 0;
+			}
+			glFinish();
+			times[method] += seconds_since(start);
+			
+			if (i == iterations - 1) {
+				glPixelStorei(GL_PACK_ALIGNMENT, 1);
+				glGetTextureImage(texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, width * height * 4, images[method]);
+			}
+		}
+	}
+	
+	int mismatches = 0;
+	for (int i = 0; i < width * height * 4; i++)
+		mismatches += (images[0][i] != images[1][i]);
+	printf("clip: %d panels, %d rects: glScissor() and one draw per panel %.3f ms, clip rects and one draw %.3f ms, %.2fx, %s (%d mismatches)\n",
+		panel_count, rect_count, times[0] * 1000 / iterations, times[1] * 1000 / iterations, times[0] / times[1],
+		(mismatches == 0) ? "match" : "MISMATCH", mismatches);
+	
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(1, &texture);
+	free(images[0]);
+	free(images[1]);
+	free(clip_rects);
+	free(panel_first_rect);
+	free(rects);
+	return (mismatches == 0) ? 0 : 1;
+}
+
+// Lays out a minimap of 100k log lines at 1.5 pt (2 px per em) with glyph_run_emit() and greeked (glyph_run_emit_greeked()
+// and text_emit_greeked()) and draws one screen of it both ways into an offscreen framebuffer. The greeked bars can't match the glyphs pixel for
+// pixel, so it compares the images in 8x8 pixel blocks (roughly what the eye sees of a minimap) and the total ink
+// instead. Needs the rect shader, e.g. "SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./main --bench=greeking".
+int bench_greeking(font_t* font, glyph_atlas_t* atlas, GLuint shader_program, GLuint vao, GLuint instances_buffer) {
+	int width = 800, height = 600, line_count = 100000, iterations = 20;
+	float font_size_pt = 1.5, pos_x = 4;
+	float line_height = round((font->ascent - font->descent + font->line_gap) * font_scale_for_size(font, font_size_pt));
+	color_t color = (color_t){218, 218, 218, 255};
+	int rect_capacity = 128 * 64;
+	rect_instance_t* rects = malloc(rect_capacity * sizeof(rects[0]));
+	
+	// Lay out the whole log in chunks of 64 lines: with glyph_run_from_text() and glyph_run_emit(), with
+	// glyph_run_from_text() and glyph_run_emit_greeked() and with text_emit_greeked(). The last two have to produce
+	// exactly the same rects.
+	rect_instance_t* greeked_rects = malloc(rect_capacity * sizeof(greeked_rects[0]));
+	double times[3] = { 0, 0, 0 };
+	int64_t rect_counts[3] = { 0, 0, 0 }, mismatches = 0;
+	for (int chunk_start = 0; chunk_start < line_count; chunk_start += 64) {
+		int chunk_rect_counts[3] = { 0, 0, 0 };
+		for (int method = 0; method < 3; method++) {
+			rect_instance_t* chunk_rects = (method == 1) ? greeked_rects : rects;
+			uint64_t start = SDL_GetPerformanceCounter();
+			for (int line = chunk_start; line < chunk_start + 64 && line < line_count; line++) {
+				char line_text[128];
+				log_line_text(line, line_text, sizeof(line_text));
+				float line_y = (line - chunk_start) * line_height;
+				int* count = &chunk_rect_counts[method];
+				if (method == 2) {
+					*count += text_emit_greeked(font, font_size_pt, line_text, pos_x, line_y, color, chunk_rects + *count, rect_capacity - *count);
+					continue;
+				}
+				
+				glyph_t glyphs[128];
+				int glyph_count = glyph_run_from_text(font, font_size_pt, line_text, glyphs, sizeof(glyphs) / sizeof(glyphs[0]));
+				if (method == 0)
+					*count += glyph_run_emit(atlas, font, font_size_pt, glyphs, glyph_count, pos_x, line_y, color, chunk_rects + *count, rect_capacity - *count);
+				else
+					*count += glyph_run_emit_greeked(font, font_size_pt, glyphs, glyph_count, pos_x, line_y, color, chunk_rects + *count, rect_capacity - *count);
+			}
+			times[method] += seconds_since(start);
+			rect_counts[method] += chunk_rect_counts[method];
+		}
+		
+		mismatches += abs(chunk_rect_counts[1] - chunk_rect_counts[2]);
+		for (int i = 0; i < chunk_rect_counts[1] && i < chunk_rect_counts[2]; i++) {
+			if ( !rect_instances_equal(&greeked_rects[i], &rects[i]) )
+				mismatches++;
+		}
+	}
+	free(greeked_rects);
+	printf("greeking: %d lines at %.1f pt, glyph runs and glyph_run_emit() %lld rects (%.1f MiB) in %.3f ms, glyph runs and glyph_run_emit_greeked() %.3f ms, text_emit_greeked() %.3f ms, %.1fx faster, %.1fx fewer rects\n",
+		line_count, font_size_pt, (long long)rect_counts[0], rect_counts[0] * sizeof(rect_instance_t) / (1024.0 * 1024.0), times[0] * 1000,
+		times[1] * 1000, times[2] * 1000, times[0] / times[2], rect_counts[0] / (double)rect_counts[2]);
+	printf("greeking: %lld greeked rects (%.1f MiB), glyph runs and text %s (%lld mismatches)\n", (long long)rect_counts[2],
+		rect_counts[2] * sizeof(rect_instance_t) / (1024.0 * 1024.0), (mismatches == 0) ? "match" : "MISMATCH", (long long)mismatches);
+	
+	// One screen of the minimap with both methods
+	int screen_lines = height / line_height, screen_rect_counts[2] = { 0, 0 };
+	rect_instance_t* screen_rects[2] = { malloc(screen_lines * 128 * sizeof(rect_instance_t)), malloc(screen_lines * 128 * sizeof(rect_instance_t)) };
+	for (int line = 0; line < screen_lines; line++) {
+		char line_text[128];
+		log_line_text(line, line_text, sizeof(line_text));
+		glyph_t glyphs[128];
+		int glyph_count = glyph_run_from_text(font, font_size_pt, line_text, glyphs, sizeof(glyphs) / sizeof(glyphs[0]));
+		screen_rect_counts[0] += glyph_run_emit(atlas, font, font_size_pt, glyphs, glyph_count, pos_x, line * line_height, color, screen_rects[0] + screen_rect_counts[0], 128);
+		screen_rect_counts[1] += text_emit_greeked(font, font_size_pt, line_text, pos_x, line * line_height, color, screen_rects[1] + screen_rect_counts[1], 128);
+	}
+	
+	GLuint texture = 0, framebuffer = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, 1, GL_RGBA8, width, height);
+	glCreateFramebuffers(1, &framebuffer);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, texture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+	
+	// Same state as text_renderer_bind()
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC1_COLOR);
+	glBindVertexArray(vao);
+	glUseProgram(shader_program);
+	glProgramUniform2f(shader_program, 0, width / 2.0f, height / 2.0f);
+	glProgramUniform1f(shader_program, 1, 0);
+	glyph_atlas_sync(atlas);
+	glBindTextureUnit(0, atlas->texture);
+	
+	uint8_t* images[2] = { malloc(width * height * 4), malloc(width * height * 4) };
+	double draw_times[2] = { 0, 0 };
+	for (int i = 0; i < iterations; i++) {
+		for (int method = 0; method < 2; method++) {
+			glClearColor(0, 0, 0, 1);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glFinish();
+			
+			uint64_t start = SDL_GetPerformanceCounter();
+			glNamedBufferData(instances_buffer, screen_rect_counts[method] * sizeof(rect_instance_t), screen_rects[method], GL_DYNAMIC_DRAW);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 6, screen_rect_counts[method]);
+			glFinish();
+			draw_times[method] += seconds_since(start);
+			
+			if (i == iterations - 1) {
+				glPixelStorei(GL_PACK_ALIGNMENT, 1);
+				glGetTextureImage(texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, width * height * 4, images[method]);
+			}
+		}
+	}
+	
+	// Compare the mean brightness of 8x8 blocks and the total brightness (ink) of both images
+	double ink[2] = { 0, 0 }, block_difference_sum = 0;
+	int block_count = 0;
+	for (int block_y = 0; block_y < height; block_y += 8) {
+		for (int block_x = 0; block_x < width; block_x += 8) {
+			double block_ink[2] = { 0, 0 };
+			for (int method = 0; method < 2; method++) {
+				for (int y = block_y; y < block_y + 8; y++) {
+					for (int x = block_x; x < block_x + 8; x++) {
+						const uint8_t* pixel = images[method] + (y * width + x) * 4;
+						block_ink[method] += (pixel[0] + pixel[1] + pixel[2]) / 3.0;
+					}
+				}
+				ink[method] += block_ink[method];
+			}
+			block_difference_sum += fabs(block_ink[0] - block_ink[1]) / 64;
+			block_count++;
+		}
+	}
+	double ink_ratio = ink[1] / ink[0];
+	printf("greeking: %d lines on screen, %d vs %d rects, drawn in %.3f ms vs %.3f ms, greeked ink %.1f%% of the glyphs, mean difference of 8x8 blocks %.1f of 255, %s\n",
+		screen_lines, screen_rect_counts[0], screen_rect_counts[1], draw_times[0] * 1000 / iterations, draw_times[1] * 1000 / iterations,
+		ink_ratio * 100, block_difference_sum / block_count, (fabs(ink_ratio - 1) < 0.25) ? "similar" : "DIFFERENT");
+	
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(1, &texture);
+	free(images[0]);
+	free(images[1]);
+	free(screen_rects[0]);
+	free(screen_rects[1]);
+	free(rects);
+	return (mismatches == 0 && fabs(ink_ratio - 1) < 0.25) ? 0 : 1;
+}
+
+
+//
+// Main program. Only renders one string.
+//
+
+int main(int argc, char** argv) {
+	// Command line options
+	const char* bench = NULL;
+	const char* font_path = "Ubuntu-R.ttf";
+	const char* tail_path = NULL;
+	const char* record_path = NULL;
+	const char* replay_path = NULL;
+	const char* replay_mode = "window";
+	const char* replay_timings_path = NULL;
+	bool use_gpu_layout = false, dashboard = false, log_view = false, use_run_templates = false, late_latch = false, latency_report = false;
+	bool smooth_scroll = false;
+	int extra_window_count = 0, frames_in_flight = 0, tail_poll_ms = 0;
+	for (int i = 1; i < argc; i++) {
+		if ( strncmp(argv[i], "--bench=", 8) == 0 ) {
+			bench = argv[i] + 8;
+		} else if ( strcmp(argv[i], "--gpu-layout") == 0 ) {
+			use_gpu_layout = true;
+		} else if ( strcmp(argv[i], "--dashboard") == 0 ) {
+			dashboard = true;
+		} else if ( strcmp(argv[i], "--log-view") == 0 ) {
+			log_view = true;
+		} else if ( strcmp(argv[i], "--run-templates") == 0 ) {
+			use_run_templates = true;
+		} else if ( strcmp(argv[i], "--smooth-scroll") == 0 ) {
+			smooth_scroll = true;
+		} else if ( strcmp(argv[i], "--late-latch") == 0 ) {
+			late_latch = true;
+			latency_report = true;
+		} else if ( strcmp(argv[i], "--latency-report") == 0 ) {
+			latency_report = true;
+		} else if ( strncmp(argv[i], "--font=", 7) == 0 ) {
+			font_path = argv[i] + 7;
+		} else if ( strncmp(argv[i], "--tail=", 7) == 0 ) {
+			tail_path = argv[i] + 7;
+			log_view = true;
+		} else if ( strncmp(argv[i], "--tail-poll=", 12) == 0 ) {
+			tail_poll_ms = atoi(argv[i] + 12);
+			if (tail_poll_ms < 1) {
+				fprintf(stderr, "--tail-poll needs an interval of at least 1 ms\n");
+				return 1;
+			}
+		} else if ( strncmp(argv[i], "--record=", 9) == 0 ) {
+			record_path = argv[i] + 9;
+		} else if ( strncmp(argv[i], "--replay=", 9) == 0 ) {
+			replay_path = argv[i] + 9;
+		} else if ( strncmp(argv[i], "--replay-mode=", 14) == 0 ) {
+			replay_mode = argv[i] + 14;
+			if ( strcmp(replay_mode, "window") != 0 && strcmp(replay_mode, "headless") != 0 && strcmp(replay_mode, "cpu") != 0 ) {
+				fprintf(stderr, "--replay-mode has to be window, headless or cpu\n");
+				return 1;
+			}
+		} else if ( strncmp(argv[i], "--replay-timings=", 17) == 0 ) {
+			replay_timings_path = argv[i] + 17;
+		} else if ( strncmp(argv[i], "--frames-in-flight=", 19) == 0 ) {
+			frames_in_flight = atoi(argv[i] + 19);
+			if (frames_in_flight < 1 || frames_in_flight > FRAME_PACER_MAX_FRAMES) {
+				fprintf(stderr, "--frames-in-flight has to be between 1 and %d\n", FRAME_PACER_MAX_FRAMES);
+				return 1;
+			}
+		} else if ( strncmp(argv[i], "--gl-debug=", 11) == 0 ) {
+			const char* level = argv[i] + 11;
+			if ( strcmp(level, "off") == 0 ) {
+				gl_debug_level = GL_DEBUG_LEVEL_OFF;
+			} else if ( strcmp(level, "errors") == 0 ) {
+				gl_debug_level = GL_DEBUG_LEVEL_ERRORS;
+			} else if ( strcmp(level, "all") == 0 ) {
+				gl_debug_level = GL_DEBUG_LEVEL_ALL;
+			} else if ( strncmp(level, "perf", 4) == 0 && (level[4] == '\0' || level[4] == ':') ) {
+				gl_debug_level = GL_DEBUG_LEVEL_PERF;
+				if (level[4] == ':')
+					gl_debug_perf_report_interval = atoi(level + 5);
+				if (gl_debug_perf_report_interval < 1) {
+					fprintf(stderr, "--gl-debug=perf:N needs at least one frame per report\n");
+					return 1;
+				}
+			} else {
+				fprintf(stderr, "--gl-debug has to be off, errors, perf, perf:N or all\n");
+				return 1;
+			}
+		} else if ( strncmp(argv[i], "--windows=", 10) == 0 ) {
+			extra_window_count = atoi(argv[i] + 10) - 1;
+			if (extra_window_count < 0 || extra_window_count > 15) {
+				fprintf(stderr, "--windows has to be between 1 and 16\n");
+				return 1;
+			}
+		} else {
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	
+	// Load the example font
+	void* font_data = fload(font_path, NULL);
+	font_t font;
+	if ( font_data == NULL || !font_init(&font, font_data) ) {
+		fprintf(stderr, "Failed to load %s\n", font_path);
+		return 1;
+	}
+	
+	// Run benchmarks that don't need a window or OpenGL instead of the demo if requested
+	if (bench && strcmp(bench, "measure") == 0)
+		return bench_measure(&font);
+	if (bench && strcmp(bench, "flatten") == 0)
+		return bench_flatten(&font);
+	if (bench && strcmp(bench, "active-edges") == 0)
+		return bench_active_edges(&font);
+	if (bench && strcmp(bench, "rasterizers") == 0)
+		return bench_rasterizers(&font);
+	if (bench && strcmp(bench, "pack") == 0)
+		return bench_pack(&font);
+	if (bench && strcmp(bench, "glyph-info") == 0)
+		return bench_glyph_info(&font);
+	if (bench && strcmp(bench, "tail") == 0)
+		return bench_tail();
+	
+	// Load the trace to replay, the CPU only replay doesn't need a window or OpenGL either
+	text_trace_t replay_trace;
+	if (replay_path) {
+		if ( !text_trace_load(&replay_trace, replay_path) )
+			return 1;
+		if ( strcmp(replay_mode, "cpu") == 0 ) {
+			int result = text_trace_replay_cpu(&replay_trace, replay_timings_path);
+			text_trace_destroy(&replay_trace);
+			return result;
+		}
+	}
+	bool hidden_window = bench || (replay_path && strcmp(replay_mode, "headless") == 0);
+	
+	SDL_Init(SDL_INIT_VIDEO);
+	atexit(SDL_Quit);
+	
+	
+	// Init window and OpenGL context
+	int window_width = (dashboard || log_view) ? 800 : 400, window_height = (dashboard || log_view) ? 600 : 100;
+	SDL_Window* window = SDL_CreateWindow("Minimal subpixel font rendering", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | (hidden_window ? SDL_WINDOW_HIDDEN : 0));
+	
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	// Without a debug context drivers may not generate any debug messages at all. The attributes stay set, so the
+	// contexts of the extra windows are debug contexts as well.
+	if (gl_debug_level != GL_DEBUG_LEVEL_OFF)
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+	SDL_GLContext gl_ctx = SDL_GL_CreateContext(window);
+	SDL_GL_SetSwapInterval(1);
+	
+	gladLoadGL((GLADloadfunc)SDL_GL_GetProcAddress); // Expects a function that returns a function pointer, but SDL_GL_GetProcAddress() just returns a void pointer. Hence the cast.
+	gl_init_debug_log();
+	
+	
+	// Setup stuff to render rectangles with OpenGL.
+	// Use instancing to render the rects. One VBO that contains the data for a single rectangle instance, and another
+	// one with all the per-instance data (stuff that is unique for each rect).
+	// First setup the vertex and fragment shader, then setup the buffers and their formats and finally the vertex array
+	// object that reads the buffers and feeds that data into the vertex shader.
+	GLuint shader_program = gl_load_shader_program(
+		// Vertex shader
+			"#version 450 core\n"
+			RECT_KIND_SHADER_DEFINES
+			"\n"
+			"layout(location = 0) uniform vec2 half_viewport_size;\n"
+			"\n"
+			"layout(location = 0) in uvec2 ltrb_index;\n"
+			"layout(location = 1) in vec4  rect_ltrb;\n"
+			"layout(location = 2) in vec4  rect_tex_ltrb;\n"
+			"layout(location = 3) in vec4  rect_color;\n"
+			"layout(location = 4) in float rect_subpixel_shift;\n"
+			"layout(location = 5) in uint  rect_kind;\n"
+			"layout(location = 6) in uint  rect_clip_index;\n"
+			"\n"
+			"// Clip rects as left, top, right, bottom, see CLIP_RECT_CAPACITY\n"
+			"layout(std140, binding = 0) uniform clip_rects_block { vec4 clip_rects[1024]; };\n"
+			"\n"
+			"// Run template mode: Instead of the rect attributes above read glyph run instances and expand each one into the\n"
+			"// glyphs of its template, see glyph_run_templates_t. The draw has 6 vertices for each glyph of the longest template\n"
+			"// and one instance per run instance. Vertices of glyphs past the end of a shorter template are discarded.\n"
+			"layout(location = 2) uniform bool expand_run_templates;\n"
+			"layout(location = 3) uniform int  glyph_left_padding;  // subpixel_positioning_left_padding + horizontal_filter_padding\n"
+			"struct run_template_glyph_t { int pen_x; float left_side_bearing_px; int distance_from_baseline_to_top_px; uint tex_coords_left_top, tex_coords_right_bottom; };\n"
+			"struct run_template_t       { uint first_glyph, glyph_count; float font_scale, baseline; };\n"
+			"struct run_instance_t       { float x, y; int pen_x; uint template_index; uint color; };\n"
+			"layout(std430, binding = 0) readonly buffer run_template_glyphs_buffer { run_template_glyph_t run_template_glyphs[]; };\n"
+			"layout(std430, binding = 1) readonly buffer run_templates_buffer       { run_template_t       run_templates[]; };\n"
+			"layout(std430, binding = 2) readonly buffer run_instances_buffer       { run_instance_t       run_instances[]; };\n"
+			"const uvec2 run_ltrb_indices[6] = uvec2[6]( uvec2(0, 1), uvec2(0, 3), uvec2(2, 1), uvec2(0, 3), uvec2(2, 3), uvec2(2, 1) );\n"
+			"\n"
+			"out vec2  tex_coords;\n"
+			"out vec4  color;\n"
+			"out float subpixel_shift;\n"
+			"out uint  kind;\n"
+			"\n"
+			"void main() {\n"
+			"	vec4 ltrb = rect_ltrb, tex_ltrb = rect_tex_ltrb, rgba = rect_color;\n"
+			"	uvec2 index = ltrb_index;\n"
+			"	subpixel_shift = rect_subpixel_shift;\n"
+			"	kind = rect_kind;\n"
+			"	\n"
+			"	if (expand_run_templates) {\n"
+			"		run_instance_t instance = run_instances[gl_InstanceID];\n"
+			"		run_template_t run_template = run_templates[instance.template_index];\n"
+			"		uint glyph_in_run = uint(gl_VertexID) / 6;\n"
+			"		if (glyph_in_run >= run_template.glyph_count) {\n"
+			"			gl_Position = vec4(0, 0, 0, 1);  // all vertices of the glyph at the same point, nothing gets rasterized\n"
+			"			return;\n"
+			"		}\n"
+			"		run_template_glyph_t glyph = run_template_glyphs[run_template.first_glyph + glyph_in_run];\n"
+			"		\n"
+			"		// The same float operations as in glyph_run_emit() so the glyphs end up at exactly the same positions\n"
+			"		precise float x_offset = float(instance.pen_x + glyph.pen_x) * run_template.font_scale;\n"
+			"		precise float glyph_pos_x = (instance.x + x_offset) + glyph.left_side_bearing_px;\n"
+			"		float glyph_pos_x_px;\n"
+			"		subpixel_shift = modf(glyph_pos_x, glyph_pos_x_px);\n"
+			"		precise float baseline_y = instance.y + run_template.baseline;\n"
+			"		float top = round(baseline_y) - float(glyph.distance_from_baseline_to_top_px);\n"
+			"		float left = glyph_pos_x_px - float(glyph_left_padding);\n"
+			"		\n"
+			"		tex_ltrb = vec4(glyph.tex_coords_left_top & 0xFFFFu, glyph.tex_coords_left_top >> 16, glyph.tex_coords_right_bottom & 0xFFFFu, glyph.tex_coords_right_bottom >> 16);\n"
+			"		ltrb = vec4(left, top, left + (tex_ltrb.z - tex_ltrb.x), top + (tex_ltrb.w - tex_ltrb.y));\n"
+			"		rgba = unpackUnorm4x8(instance.color);\n"
+			"		index = run_ltrb_indices[gl_VertexID % 6];\n"
+			"		kind = RECT_GLYPH;\n"
+			"	}\n"
+			"	\n"
+			"	// Trim the rect to its clip rect. Glyphs map one texel to one pixel, so the tex coords move by the same amount.\n"
+			"	// Clip rects are on pixel boundaries like the rects, so the trimmed rect covers exactly the pixels glScissor()\n"
+			"	// would let through and nothing has to be discarded in the fragment shader. Rects outside of their clip rect end\n"
+			"	// up empty and aren't rasterized at all.\n"
+			"	if (!expand_run_templates && rect_clip_index != 0) {\n"
+			"		vec4 clip = clip_rects[rect_clip_index];\n"
+			"		vec4 clipped = vec4(max(ltrb.xy, clip.xy), min(ltrb.zw, clip.zw));\n"
+			"		clipped.zw = max(clipped.zw, clipped.xy);\n"
+			"		tex_ltrb += clipped - ltrb;\n"
+			"		ltrb = clipped;\n"
+			"	}\n"
+			"	\n"
+			"	// Convert color to pre-multiplied alpha\n"
+			"	color = vec4(rgba.rgb * rgba.a, rgba.a);\n"
+			"	\n"
+			"	vec2 pos   = vec2(ltrb[index.x],     ltrb[index.y]);\n"
+			"	tex_coords = vec2(tex_ltrb[index.x], tex_ltrb[index.y]);\n"
+			"	\n"
+			"	vec2 axes_flip  = vec2(1, -1);  // to flip y axis from bottom-up (OpenGL standard) to top-down (normal for UIs)\n"
+			"	vec2 pos_in_ndc = (pos / half_viewport_size - 1.0) * axes_flip;\n"
+			"	gl_Position = vec4(pos_in_ndc, 0, 1);\n"
+			"}\n"
+		,
+		// Fragment shader
+			"#version 450 core\n"
+			RECT_KIND_SHADER_DEFINES
+			"\n"
+			"layout(location = 1) uniform float coverage_adjustment;\n"
+			"\n"
+			"// Note: binding is the number of the texture unit, not the uniform location. We don't care about the uniform location\n"
+			"// since we already set the texture unit via the binding here and don't have to set it via OpenGL as a uniform.\n"
+			"layout(binding = 0) uniform sampler2DRect glyph_atlas;\n"
+			"\n"
+			"in      vec2  tex_coords;\n"
+			"in flat vec4  color;\n"
+			"in flat float subpixel_shift;\n"
+			"in flat uint  kind;\n"
+			"\n"
+			"// Use dual-source blending to blend individual color components with different weights instead of just one weight (alpha) for the entire pixel\n"
+			"layout(location = 0, index = 0) out vec4 fragment_color;\n"
+			"layout(location = 0, index = 1) out vec4 blend_weights;\n"
+			"\n"
+			"void main() {\n"
+			"	// Solid rects don't need the glyph atlas. Just do normal pre-multiplied alpha blending by using the same\n"
+			"	// blend weight (alpha) for all subpixels.\n"
+			"	if (kind == RECT_SOLID) {\n"
+			"		fragment_color = color;\n"
+			"		blend_weights = vec4(color.a);\n"
+			"		return;\n"
+			"	}\n"
+			"	\n"
+			"	// Shift the subpixel weights according to the subpixel position of this specific glyph (the atlas only contains the glyph with a subpixel shift of 0)\n"
+			"	// Based on the shifting code from the paper Higher Quality 2D Text Rendering by Nicolas P. Rougier, Listing 2. Subpixel positioning fragment shader, from https://jcgt.org/published/0002/01/04/paper.pdf\n"
+			"	vec3 current  = texelFetch(glyph_atlas, ivec2(tex_coords) + ivec2( 0, 0)).rgb;\n"
+			"	vec3 previous = texelFetch(glyph_atlas, ivec2(tex_coords) + ivec2(-1, 0)).rgb;\n"
+			"	float r = current.r, g = current.g, b = current.b;\n"
+			"	if (subpixel_shift <= 1.0/3.0) {\n"
+			"		float z = 3.0 * subpixel_shift;\n"
+			"		r = mix(current.r, previous.b, z);\n"
+			"		g = mix(current.g, current.r, z);\n"
+			"		b = mix(current.b, current.g, z);\n"
+			"	} else if (subpixel_shift <= 2.0/3.0) {\n"
+			"		float z = 3.0 * subpixel_shift - 1.0;\n"
+			"		r = mix(previous.b, previous.g, z);\n"
+			"		g = mix(current.r,  previous.b, z);\n"
+			"		b = mix(current.g,  current.r,  z);\n"
+			"	} else if (subpixel_shift < 1.0) {\n"
+			"		float z = 3.0 * subpixel_shift - 2.0;\n"
+			"		r = mix(previous.g, previous.r, z);\n"
+			"		g = mix(previous.b, previous.g, z);\n"
+			"		b = mix(current.r,  previous.b, z);\n"
+			"	}\n"
+			"	vec3 pixel_coverages = vec3(r, g, b);\n"
+			"	\n"
+			"	// Coverage adjustment variant 1: Increase or decrease the slope of the gradient by a linear factor.\n"
+			"	// Gives sharper results than variant 2 but overdoing it degrades quality quickly.\n"
+			"	// coverage_adjustment = 0: does nothing\n"
+			"	// coverage_adjustment = +0.2: makes the glyphs slightly bolder (multiply slope by 1.2 with coverage 0 as reference point)\n"
+			"	// coverage_adjustment = -0.2: makes them slightly thinner (multiply slope by 1.2 with coverage 1 as reference point)\n"
+			"	if (coverage_adjustment >= 0) {\n"
+			"		pixel_coverages = min(pixel_coverages * (1 + coverage_adjustment), 1);\n"
+			"	} else {\n"
+			"		pixel_coverages = max((1 - (1 - pixel_coverages) * (1 + -coverage_adjustment)), 0);\n"
+			"	}\n"
+			"	\n"
+			"	// Coverage adjustment variant 2: Use a power function to distort the coverages toward higher or lower values.\n"
+			"	// Note: The code might look similar to gamma correction \n"
+			"	// coverage_adjustment = 1.0: does nothing\n"
+			"	// coverage_adjustment = 0.80: makes the glyphs slightly bolder, nice for source code, etc.\n"
+			"	// coverage_adjustment = 1.20: makes them slightly thinner, but can make bright text on bright backgrounds harder to read.\n"
+			"	// coverage_adjustment = 2.2 and 0.45: Gives you the look of text distorted by gamma correction (2.2 for black on white, 0.45 = 1/2.2 for white on black).\n"
+			"	// Comment variant 1 and uncomment this one to give it a try.\n"
+			"	//pixel_coverages = pow(pixel_coverages, vec3(coverage_adjustment));\n"
+			"	\n"
+			"	// Use dual-source blending to blend each subpixel (color channel) individually.\n"
+			"	// Note: The blend equation is setup for pre-multiplied alpha blending. color is already pre-multiplied in the vertex shader.\n"
+			"	// color * vec4(pixel_coverages, 1) gives us a color mask where all subpixels of the glyph have the proper values for the text\n"
+			"	// color and all other subpixels are 0. This is what we add to the framebuffer (since color is pre-multiplied).\n"
+			"	// The blend weights are then set to remove the portion of the background we no longer want. The blend equation does a 1 - alpha\n"
+			"	// for each channel so here we set the weights to the part that the glyph color contributes. But only where the glyph actually"
+			"	// covers the subpixels, thats what color.a * pixel_coverages does.\n"
+			"	fragment_color = color * vec4(pixel_coverages, 1);\n"
+			"	blend_weights = vec4(color.a * pixel_coverages, color.a);\n"
+			"}\n"
+	);
+	if (!shader_program)
+		return 1;
+	
+	// Small fixed buffer that just contains the 6 vertices (two triangles) making up one rectange.
+	// Note: ltrb is short for left, top, right , bottom and those coordinates are used to describe a rectangle on the
+	// screen. Requires only half the data as 4 complete points. Thats mostly for rect_instance_t but here we use
+	// the same convention.
+	struct { uint16_t ltrb_index_x, ltrb_index_y; } rect_vertices[] = {
+		{ 0, 1 }, // left  top
+		{ 0, 3 }, // left  bottom
+		{ 2, 1 }, // right top
+		{ 0, 3 }, // left  bottom
+		{ 2, 3 }, // right bottom
+		{ 2, 1 }, // right top
+	};
+	GLuint rect_vertices_vbo = 0;
+	glCreateBuffers(1, &rect_vertices_vbo);
+	glNamedBufferStorage(rect_vertices_vbo, sizeof(rect_vertices), rect_vertices, 0);
+	
+	// GPU buffer for the per-rectangle information (see rect_instance_t). The text renderer collects the rects of a
+	// frame on the CPU side and uploads them right before drawing them.
+	GLuint rect_instances_vbo = 0;
+	glCreateBuffers(1, &rect_instances_vbo);
+	
+	// The clip rects for rect_instance_t.clip_index (see CLIP_RECT_CAPACITY), bound to uniform buffer binding 0
+	GLuint clip_rects_ubo = 0;
+	glCreateBuffers(1, &clip_rects_ubo);
+	glNamedBufferStorage(clip_rects_ubo, CLIP_RECT_CAPACITY * 4 * sizeof(float), NULL, GL_DYNAMIC_STORAGE_BIT);
+	
+	// With --frames-in-flight the main window is paced with fences and the rect instances go into the pacer's stream
+	// buffer. Each frame's region holds 16k rects, draws that don't fit fall back to glNamedBufferData().
+	frame_pacer_t pacer;
+	if (frames_in_flight > 0)
+		frame_pacer_init(&pacer, frames_in_flight, 16 * 1024 * sizeof(rect_instance_t));
+	
+	// Create the vertex array object (VAO) that reads one entry from rect_vertices_vbo for each vertex and one entry
 	// from rect_instances_vbo for each instance and feeds the data into the vertex shader.
-	GLuint vao = 0;
-	glCreateVertexArrays(1, &vao);
-		glVertexArrayVertexBuffer(vao, 0, rect_vertices_vbo,  0, sizeof(rect_vertices[0]));  // Set data source 0 to rect_vertices_vbo, with offset 0 and proper stride
-		glVertexArrayVertexBuffer(vao, 1, rect_instances_vbo, 0, sizeof(rect_instance_t));   // Set data source 1 to rect_instances_vbo, with offset 0 and proper stride
-		glVertexArrayBindingDivisor(vao, 1, 1);  // Advance data source 1 every 1 instance instead of for every vertex (3rd argument is 1 instead of 0)
-	// layout(location = 0) in uvec2 ltrb_index
-		glEnableVertexArrayAttrib( vao, 0);     // read ltrb_index from a data source
-		glVertexArrayAttribBinding(vao, 0, 0);  // read from data source 0
-		glVertexArrayAttribIFormat(vao, 0, 2, GL_UNSIGNED_SHORT, 0);  // read 2 unsigned shorts starting at offset 0 and feed it into the vertex shader as integers instead of float (that's what the I means in glVertexArrayAttribIFormat)
-	// layout(location = 1) in vec4  rect_ltrb
-		glEnableVertexArrayAttrib( vao, 1);     // read it from a data source
-		glVertexArrayAttribBinding(vao, 1, 1);  // read from data source 1
-		glVertexArrayAttribFormat( vao, 1, 4, GL_SHORT, false, offsetof(rect_instance_t, pos));
-	// layout(location = 2) in vec4  rect_tex_ltrb
-		glEnableVertexArrayAttrib( vao, 2);     // read it from a data source
-		glVertexArrayAttribBinding(vao, 2, 1);  // read from data source 1
-		glVertexArrayAttribFormat( vao, 2, 4, GL_SHORT, false, offsetof(rect_instance_t, tex_coords));
-	// layout(location = 3) in vec4  rect_color
-		glEnableVertexArrayAttrib( vao, 3);     // read it from a data source
-		glVertexArrayAttribBinding(vao, 3, 1);  // read from data source 1
-		glVertexArrayAttribFormat( vao, 3, 4, GL_UNSIGNED_BYTE, true, offsetof(rect_instance_t, color));  // read 4 unsigned bytes starting at the offset of the "color" member, convert them to float and normalize the value range 0..255 to 0..1.
-	// layout(location = 4) in float rect_subpixel_shift
-		glEnableVertexArrayAttrib( vao, 4);     // read it from a data source
-		glVertexArrayAttribBinding(vao, 4, 1);  // read from data source 1
-		glVertexArrayAttribFormat( vao, 4, 1, GL_FLOAT, false, offsetof(rect_instance_t, subpixel_shift));
-	
-	
-	// A simple mockup of an atlas allocator that you would use to allocate and manage small glyph rectangles in the
-	// atlas texture. The mockup uses the codepoint of a character as an index and stores the relevant glyph data there,
-	// e.g. glyph_atlas_item_t atlas_item = glyph_atlas_codepoint_to_tex_coords['H'].
-	// Additionally we just make each atlas item 32x32 pixel in size. The position in the altas texture is also derived
-	// from the codepoint / index: Simple left to right and top to bottom stacking.
-	// You wouldn't want such a lousy atlas allocator for anything real. It can only handle the first 127 codepoints
-	// (that includes just basic ASCII), can only manage one version of a glyph (no different font sizes) and it wastes
-	// phenomenal amounts of space. But it's ok for demonstration purposes while being simple enough to not distract
-	// from the font rendering itself.
-	// It uses a GL_TEXTURE_RECTANGLE so we can use pixel coordinates instead of coordinates in the range 0..1. But that
-	// doesn't really matter since we use texelFetch() in the fragment shader and that works on integer coordinates
-	// anyway. Rectangle textures can't have mipmaps but we don't want them for the glyph atlas.
-	uint32_t glyph_atlas_width = 512, glyph_atlas_height = 512;
-	GLuint glyph_atlas_texture = 0;
-	glCreateTextures(GL_TEXTURE_RECTANGLE, 1, &glyph_atlas_texture);
-	glTextureStorage2D(glyph_atlas_texture, 1, GL_RGB8, glyph_atlas_width, glyph_atlas_height);
-	
-	typedef struct { bool filled; int16_rect_t tex_coords; int glyph_index, distance_from_baseline_to_top_px; } glyph_atlas_item_t;
-	glyph_atlas_item_t glyph_atlas_items[127] = {};
+	// VAOs are container objects and can't be shared between OpenGL contexts (unlike buffers, textures and shader
+	// programs). So this is a nested function (a GCC extension) that is called for each context.
+	GLuint create_rect_vao() {
+		GLuint vao = 0;
+		glCreateVertexArrays(1, &vao);
+			glVertexArrayVertexBuffer(vao, 0, rect_vertices_vbo,  0, sizeof(rect_vertices[0]));  // Set data source 0 to rect_vertices_vbo, with offset 0 and proper stride
+			glVertexArrayVertexBuffer(vao, 1, rect_instances_vbo, 0, sizeof(rect_instance_t));   // Set data source 1 to rect_instances_vbo, with offset 0 and proper stride
+			glVertexArrayBindingDivisor(vao, 1, 1);  // Advance data source 1 every 1 instance instead of for every vertex (3rd argument is 1 instead of 0)
+		// layout(location = 0) in uvec2 ltrb_index
+			glEnableVertexArrayAttrib( vao, 0);     // read ltrb_index from a data source
+			glVertexArrayAttribBinding(vao, 0, 0);  // read from data source 0
+			glVertexArrayAttribIFormat(vao, 0, 2, GL_UNSIGNED_SHORT, 0);  // read 2 unsigned shorts starting at offset 0 and feed it into the vertex shader as integers instead of float (that's what the I means in glVertexArrayAttribIFormat)
+		// layout(location = 1) in vec4  rect_ltrb
+			glEnableVertexArrayAttrib( vao, 1);     // read it from a data source
+			glVertexArrayAttribBinding(vao, 1, 1);  // read from data source 1
+			glVertexArrayAttribFormat( vao, 1, 4, GL_SHORT, false, offsetof(rect_instance_t, pos));
+		// layout(location = 2) in vec4  rect_tex_ltrb
+			glEnableVertexArrayAttrib( vao, 2);     // read it from a data source
+			glVertexArrayAttribBinding(vao, 2, 1);  // read from data source 1
+			glVertexArrayAttribFormat( vao, 2, 4, GL_SHORT, false, offsetof(rect_instance_t, tex_coords));
+		// layout(location = 3) in vec4  rect_color
+			glEnableVertexArrayAttrib( vao, 3);     // read it from a data source
+			glVertexArrayAttribBinding(vao, 3, 1);  // read from data source 1
+			glVertexArrayAttribFormat( vao, 3, 4, GL_UNSIGNED_BYTE, true, offsetof(rect_instance_t, color));  // read 4 unsigned bytes starting at the offset of the "color" member, convert them to float and normalize the value range 0..255 to 0..1.
+		// layout(location = 4) in float rect_subpixel_shift
+			glEnableVertexArrayAttrib( vao, 4);     // read it from a data source
+			glVertexArrayAttribBinding(vao, 4, 1);  // read from data source 1
+			glVertexArrayAttribFormat( vao, 4, 1, GL_FLOAT, false, offsetof(rect_instance_t, subpixel_shift));
+		// layout(location = 5) in uint  rect_kind
+			glEnableVertexArrayAttrib( vao, 5);     // read it from a data source
+			glVertexArrayAttribBinding(vao, 5, 1);  // read from data source 1
+			glVertexArrayAttribIFormat(vao, 5, 1, GL_UNSIGNED_SHORT, offsetof(rect_instance_t, kind));
+		// layout(location = 6) in uint  rect_clip_index
+			glEnableVertexArrayAttrib( vao, 6);     // read it from a data source
+			glVertexArrayAttribBinding(vao, 6, 1);  // read from data source 1
+			glVertexArrayAttribIFormat(vao, 6, 1, GL_UNSIGNED_SHORT, offsetof(rect_instance_t, clip_index));
+		return vao;
+	}
+	GLuint vao = create_rect_vao();  // the VAO of the current context
 	
 	
-	// Load the example font
-	void* font_data = fload("Ubuntu-R.ttf", NULL);
-	stbtt_fontinfo font_info;
-	stbtt_InitFont(&font_info, font_data, 0);
+	// The glyph atlas texture and the hash table to find glyphs in it, see glyph_atlas_get().
+	glyph_atlas_t glyph_atlas;
+	glyph_atlas_init(&glyph_atlas, 512, 512);
 	
+	// Run benchmarks that need OpenGL instead of the demo if requested
+	if (bench) {
+		if ( strcmp(bench, "gpu-layout") == 0 )
+			return bench_gpu_layout(&font, &glyph_atlas);
+		if ( strcmp(bench, "run-templates") == 0 )
+			return bench_run_templates(&font, &glyph_atlas);
+		if ( strcmp(bench, "batch-raster") == 0 )
+			return bench_batch_raster(&font);
+		if ( strcmp(bench, "pack-lcd") == 0 )
+			return bench_pack_lcd(&font);
+		if ( strcmp(bench, "clip") == 0 )
+			return bench_clip(&font, &glyph_atlas, shader_program, vao, rect_instances_vbo, clip_rects_ubo);
+		if ( strcmp(bench, "greeking") == 0 )
+			return bench_greeking(&font, &glyph_atlas, shader_program, vao, rect_instances_vbo);
+		fprintf(stderr, "Unknown benchmark: %s\n", bench);
+		return 1;
+	}
 	
-	bool quit = false;
-	while(!quit) {
-		// Wait for anything to happen
-		SDL_WaitEvent(NULL);
+	// Parameters for drawing the example text
+	float font_size_pt = 10, pos_x = 10, pos_y = 10, coverage_adjustment = 0.0;
+	color_t text_color = (color_t){218, 218, 218, 255}, selection_color = (color_t){51, 102, 170, 255}, underline_color = (color_t){218, 218, 218, 160};
+	const char* text = "The quick brown fox jumps over the lazy dog.";
+	// Highlight "quick brown" as selected and underline the whole text
+	int selection_start = 4, selection_end = 15;
+	float selection_left   = pos_x + text_measure(&font, font_size_pt, text, selection_start).width;
+	float selection_right  = pos_x + text_measure(&font, font_size_pt, text, selection_end).width;
+	text_extents_t text_extents = text_measure(&font, font_size_pt, text, strlen(text));
+	
+	// The text never changes, so convert it into a glyph run once. Each redraw then just puts the glyphs from the
+	// run into the text renderer without decoding UTF-8, looking up glyph indices or kerning again.
+	glyph_t text_glyphs[255];
+	int text_glyph_count = glyph_run_from_text(&font, font_size_pt, text, text_glyphs, sizeof(text_glyphs) / sizeof(text_glyphs[0]));
+	
+	// Text typed into the window is shown in a line below the example text. Mostly so there is something that reacts
+	// to the keyboard when measuring the input latency (see --late-latch).
+	char typed_text[255] = "";
+	int typed_text_length = 0;
+	
+	// With --gpu-layout the text is laid out by a compute shader instead. Since the text doesn't change that only has
+	// to be done once and each redraw just draws the instances the compute shader wrote.
+	gpu_text_layout_t gpu_layout;
+	if (use_gpu_layout) {
+		if ( !gpu_text_layout_init(&gpu_layout) )
+			return 1;
+		gpu_text_layout_upload(&gpu_layout, &glyph_atlas, &font, font_size_pt, text);
+		gpu_text_layout_run(&gpu_layout, pos_x, pos_y, text_color);
+	}
+	
+	
+	// With --dashboard the window shows a grid of panels with lots of text. Each panel is a cached text layer and only
+	// re-rendered when its text changes. The first panel shows the number of redraws so it changes with every redraw
+	// while all other panels just get copied into the window.
+	text_layer_t dashboard_panels[9];
+	int dashboard_redraws = 0, dashboard_panel_renders = 0;
+	if (dashboard) {
+		for (int i = 0; i < 9; i++) {
+			color_t background = (color_t){ 32 + (i % 3) * 12, 40 + (i / 3) * 10, 48, 255 };
+			text_layer_init(&dashboard_panels[i], 10 + (i % 3) * 262, 10 + (i / 3) * 195, 252, 185, background);
+		}
+	}
+	
+	// With --log-view the window shows a scrollable log with 100k lines. Scrolling with the mouse wheel reuses the last
+	// frame via a scroll_cache_t and only draws the lines that became visible. With --smooth-scroll the wheel only moves
+	// the scroll target and each frame scrolls half of the remaining way there (an animation, see frame_scheduler_t).
+	scroll_cache_t log_view_cache = {};
+	int log_view_line_count = 100000, log_view_scroll_px = 0, log_view_scroll_delta_px = 0, log_view_scroll_target_px = 0;
+	int log_view_line_height = round((font.ascent - font.descent + font.line_gap) * font_scale_for_size(&font, font_size_pt));
+	int64_t log_view_frames = 0, log_view_glyphs_drawn = 0, log_view_instance_bytes = 0;
+	
+	// With --run-templates the log view draws each word with a glyph run template instead of one rect per glyph
+	glyph_run_templates_t run_templates;
+	if (use_run_templates)
+		glyph_run_templates_init(&run_templates);
+	if (log_view) {
+		scroll_cache_resize(&log_view_cache, window_width, window_height);
+		// The log is plain ASCII, so put all of it into the atlas at once instead of glyph by glyph as the first page is drawn
+		int ascii_glyph_indices[95];
+		for (int i = 0; i < 95; i++)
+			ascii_glyph_indices[i] = stbtt_FindGlyphIndex(&font.info, 32 + i);
+		glyph_atlas_prewarm(&glyph_atlas, &font, font_scale_for_size(&font, font_size_pt), ascii_glyph_indices, 95);
+	}
+	
+	// With --tail the log view shows a log file instead and follows it as it grows (see log_file_t). While the view is
+	// at the end of the log it stays there and the new lines scroll in. Otherwise appends only extend the line index and
+	// nothing is drawn unless changed lines are visible (e.g. the last line grew). Changed lines are collected as a strip
+	// in log coordinates and drawn together with the strip the scroll cache exposed.
+	log_file_t tail_file = {};
+	bool log_view_follow = true;
+	int log_view_damage_top_px = 0, log_view_damage_bottom_px = 0, tail_updates_drawn = 0;
+	if (tail_path) {
+		if ( !log_file_open(&tail_file, tail_path, SDL_RegisterEvents(1), tail_poll_ms) ) {
+			fprintf(stderr, "Failed to open %s: %s\n", tail_path, strerror(errno));
+			return 1;
+		}
+		log_view_line_count = log_file_line_count(&tail_file);
+		int bottom_scroll_px = log_view_line_count * log_view_line_height - window_height;
+		log_view_scroll_px = log_view_scroll_target_px = (bottom_scroll_px > 0) ? bottom_scroll_px : 0;
+	}
+	
+	// The immediate mode text renderer draws the demo, the dashboard panels and the log view (see text_renderer_t).
+	// With --record it also writes everything it draws into a text trace.
+	text_renderer_t text_renderer;
+	text_renderer_init(&text_renderer, shader_program, vao, rect_instances_vbo, clip_rects_ubo, &glyph_atlas, (frames_in_flight > 0) ? &pacer : NULL);
+	text_renderer.coverage_adjustment = coverage_adjustment;
+	if (record_path) {
+		if ( !text_trace_writer_open(&text_renderer.trace, record_path) ) {
+			fprintf(stderr, "Failed to create the trace %s: %s\n", record_path, strerror(errno));
+			return 1;
+		}
+		text_trace_add_font(&text_renderer.trace, &font, font_path);
+	}
+	
+	// Functions to draw rects that don't come from the text renderer. They're nested functions (a GCC extension) so
+	// they can use all the OpenGL objects and variables above. viewport_width and viewport_height are the size of the
+	// currently bound framebuffer.
+	// Draws rect instances that are already in a GPU buffer with an indirect draw command (e.g. from gpu_text_layout_t)
+	void draw_rect_instances_indirect(int viewport_width, int viewport_height, GLuint instances_buffer, GLuint draw_command_buffer) {
+		text_renderer_bind(&text_renderer, viewport_width, viewport_height);
+			glVertexArrayVertexBuffer(text_renderer.vao, 1, instances_buffer, 0, sizeof(rect_instance_t));
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw_command_buffer);
+				glDrawArraysIndirect(GL_TRIANGLES, NULL);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			glVertexArrayVertexBuffer(text_renderer.vao, 1, rect_instances_vbo, 0, sizeof(rect_instance_t));
+		text_renderer_unbind(&text_renderer);
+	}
+	
+	// Draws the run instances of run_templates (see glyph_run_templates_t) and empties them. Uses the run template mode
+	// of the rect shader with its own empty VAO since all data comes from the shader storage buffers.
+	// With --frames-in-flight the instances go into the stream buffer of the frame pacer like the rects of
+	// text_renderer_draw_rects(). Its regions are 256 byte aligned, the largest GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+	// the spec allows, so they can be bound as shader storage buffer right away.
+	void draw_run_instances(int viewport_width, int viewport_height) {
+		if (run_templates.instance_count == 0)
+			return;
 		
-		// Process all pending events
+		size_t instances_size = run_templates.instance_count * sizeof(run_templates.instances[0]);
+		ptrdiff_t stream_offset = (text_renderer.pacer) ? frame_pacer_stream(text_renderer.pacer, run_templates.instances, instances_size) : -1;
+		GLuint instances_buffer = (stream_offset >= 0) ? text_renderer.pacer->stream_buffer : run_templates.instances_buffer;
+		glyph_run_templates_upload(&run_templates, stream_offset < 0);
+		
+		text_renderer_bind(&text_renderer, viewport_width, viewport_height);
+			glBindVertexArray(run_templates.vao);
+			glProgramUniform1i(shader_program, 2, true);
+			glProgramUniform1i(shader_program, 3, subpixel_positioning_left_padding + horizontal_filter_padding);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, run_templates.template_glyphs_buffer);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, run_templates.templates_buffer);
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, instances_buffer, (stream_offset >= 0) ? stream_offset : 0, instances_size);
+				glDrawArraysInstanced(GL_TRIANGLES, 0, 6 * run_templates.max_template_glyph_count, run_templates.instance_count);
+			glProgramUniform1i(shader_program, 2, false);
+		text_renderer_unbind(&text_renderer);
+		
+		if (stream_offset < 0)
+			glInvalidateBufferData(run_templates.instances_buffer);
+		run_templates.instance_count = 0;
+	}
+	
+	// Draws the example text into the current framebuffer
+	void draw_demo(int viewport_width, int viewport_height) {
+		glClearColor(0.25, 0.25, 0.25, 1.0);
+		glClear(GL_COLOR_BUFFER_BIT);
+		
+		// The selection background, every glyph of the text and the underline are drawn in that order within the same
+		// draw call. The text never changes so it's drawn from the glyph run, the typed text is laid out each frame.
+		text_begin_frame(&text_renderer, viewport_width, viewport_height);
+			text_draw_rect(&text_renderer, solid_rect(selection_left, pos_y, selection_right, pos_y + text_extents.height, selection_color));
+			if (!use_gpu_layout)
+				text_draw_run(&text_renderer, &font, font_size_pt, text_glyphs, text_glyph_count, pos_x, pos_y, text_color);
+			text_draw_rect(&text_renderer, text_underline_rect(&font, font_size_pt, pos_x, pos_y, text_extents.width, underline_color));
+			if (typed_text_length > 0) {
+				// The typed text is a field as wide as the example text, longer text is clipped
+				float field_y = pos_y + 2 * text_extents.height;
+				text_clip_begin(&text_renderer, pos_x, field_y, pos_x + text_extents.width, field_y + text_extents.height);
+					text_draw(&text_renderer, &font, font_size_pt, pos_x, field_y, text_color, typed_text);
+				text_clip_end(&text_renderer);
+			}
+		text_end_frame(&text_renderer);
+		
+		// Draw the instances written by the compute shader on top (the text of the demo in --gpu-layout mode)
+		if (use_gpu_layout)
+			draw_rect_instances_indirect(viewport_width, viewport_height, gpu_layout.instances_buffer, gpu_layout.draw_command_buffer);
+	}
+	
+	// --replay: Draw the frames of a text trace with the immediate mode text renderer, as fast as possible and
+	// instead of the demo. Each frame is timed twice: until text_end_frame() returned (the CPU side: layout, glyph
+	// rasterization and the draw calls) and until glFinish() returned after it (everything done by the GPU too, in a
+	// window including the swap). Headless frames are drawn into a framebuffer object of a hidden window.
+	if (replay_path) {
+		bool headless = (strcmp(replay_mode, "headless") == 0);
+		int width = replay_trace.max_viewport_width, height = replay_trace.max_viewport_height;
+		GLuint texture = 0, framebuffer = 0;
+		if (headless) {
+			glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+			glTextureStorage2D(texture, 1, GL_RGBA8, width, height);
+			glCreateFramebuffers(1, &framebuffer);
+			glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, texture, 0);
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		} else {
+			SDL_SetWindowSize(window, width, height);
+			SDL_GL_SetSwapInterval(0);
+		}
+		
+		double* cpu_seconds = malloc(replay_trace.frame_count * sizeof(cpu_seconds[0]));
+		double* frame_seconds = malloc(replay_trace.frame_count * sizeof(frame_seconds[0]));
+		text_trace_record_t record;
+		int frame = 0;
+		uint64_t frame_start = 0;
+		bool quit = false;
+		while ( !quit && text_trace_next(&replay_trace, &record) ) {
+			switch (record.type) {
+				case TEXT_TRACE_FRAME_BEGIN:
+					frame_start = SDL_GetPerformanceCounter();
+					glViewport(0, 0, record.viewport_width, record.viewport_height);
+					glClearColor(0.25, 0.25, 0.25, 1.0);
+					glClear(GL_COLOR_BUFFER_BIT);
+					text_begin_frame(&text_renderer, record.viewport_width, record.viewport_height);
+					break;
+				case TEXT_TRACE_FRAME_END:
+					text_end_frame(&text_renderer);
+					cpu_seconds[frame] = seconds_since(frame_start);
+					if (!headless)
+						SDL_GL_SwapWindow(window);
+					glFinish();
+					frame_seconds[frame] = seconds_since(frame_start);
+					frame++;
+					
+					// Closing the window stops the replay
+					SDL_Event event;
+					while ( !headless && SDL_PollEvent(&event) )
+						quit = quit || (event.type == SDL_QUIT);
+					break;
+				case TEXT_TRACE_TEXT:
+					text_draw(&text_renderer, record.font, record.font_size_pt, record.x, record.y, record.color, record.text);
+					break;
+				case TEXT_TRACE_RUN:
+					text_draw_run(&text_renderer, record.font, record.font_size_pt, record.glyphs, record.length, record.x, record.y, record.color);
+					break;
+				case TEXT_TRACE_RECT:
+					text_draw_rect(&text_renderer, record.rect);
+					break;
+				case TEXT_TRACE_CLIP_BEGIN:
+					text_clip_begin(&text_renderer, record.clip[0], record.clip[1], record.clip[2], record.clip[3]);
+					break;
+				case TEXT_TRACE_CLIP_END:
+					text_clip_end(&text_renderer);
+					break;
+			}
+		}
+		
+		printf("replay %s: %d frames, %lld bytes of text, %lld glyphs in runs, %lld rects, %.1f draw calls per frame, atlas cleared %d times\n",
+			replay_mode, frame, (long long)replay_trace.text_bytes, (long long)replay_trace.run_glyphs, (long long)replay_trace.rects,
+			text_renderer.draw_calls / (double)(frame ? frame : 1), text_renderer.atlas_clears);
+		if (frame > 0) {
+			text_trace_report(headless ? "headless, CPU" : "window, CPU", cpu_seconds, frame, NULL);
+			text_trace_report(headless ? "headless, until glFinish()" : "window, until swap and glFinish()", frame_seconds, frame, replay_timings_path);
+		}
+		free(cpu_seconds);
+		free(frame_seconds);
+		if (headless) {
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glDeleteFramebuffers(1, &framebuffer);
+			glDeleteTextures(1, &texture);
+		}
+		text_trace_destroy(&replay_trace);
+		return 0;
+	}
+	
+	// With --windows=N the demo text is shown in N-1 more windows. Each one has its own OpenGL context but they all
+	// share objects with the main context. So the shader program, the buffers and most importantly the glyph atlas
+	// exist only once and each glyph is rasterized and uploaded once, no matter in how many windows it is shown. Only
+	// the VAO has to be created per context. glyph_atlas_sync() takes care of glyphs uploaded by another context.
+	typedef struct {
+		SDL_Window*   window;
+		SDL_GLContext gl_ctx;
+		GLuint        vao;
+		int           width, height;
+		bool          redraw;
+	} extra_window_t;
+	extra_window_t extra_windows[15] = {};
+	if (extra_window_count > 0) {
+		// Everything the main context did so far (e.g. the compute shader layout) has to be done before another context
+		// uses it.
+		glFinish();
+		SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+		for (int i = 0; i < extra_window_count; i++) {
+			extra_window_t* w = &extra_windows[i];
+			char title[64];
+			snprintf(title, sizeof(title), "Minimal subpixel font rendering, window %d", i + 2);
+			w->width = window_width;
+			w->height = window_height;
+			w->window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, w->width, w->height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+			// Creating the context makes it current, so the new context shares with the main context as long as we switch
+			// back to it after each window.
+			w->gl_ctx = SDL_GL_CreateContext(w->window);
+			SDL_GL_SetSwapInterval(1);
+			gl_init_debug_log();
+			w->vao = create_rect_vao();
+			SDL_GL_MakeCurrent(window, gl_ctx);
+		}
+		SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+	}
+	
+	
+	// Input latency (--latency-report). SDL timestamps input events (typed text and the mouse wheel) in milliseconds
+	// when they arrive. Those arrival times are kept until the next frame of the main window is presented, then the time
+	// from each arrival to the return of SDL_GL_SwapWindow() is recorded. With vsync the swap returns at the vblank that
+	// shows the frame, so that's (roughly) the time until the input is on screen.
+	uint64_t counter_frequency = SDL_GetPerformanceFrequency();
+	uint64_t pending_input_counters[64];
+	int pending_input_count = 0, input_latency_count = 0;
+	double input_latency_sum = 0, input_latency_max = 0;
+	
+	// With --late-latch the loop doesn't draw right after an event arrived. It sleeps until just before the next vblank
+	// minus the time a frame takes to render, takes all events that arrived in the meantime and only then lays out and
+	// draws. So a frame shows the freshest input instead of the input of a frame ago. The vblanks are estimated from the
+	// times SDL_GL_SwapWindow() returned and the refresh rate of the display (refined by the measured swap intervals).
+	// The render time is measured up to a glFinish() before the swap. The estimate follows increases immediately and
+	// decreases slowly since a too short estimate costs a whole frame.
+	double refresh_period = 1.0 / 60, render_time_estimate = 0.002, late_latch_margin = 0.001;
+	SDL_DisplayMode display_mode;
+	if ( SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &display_mode) == 0 && display_mode.refresh_rate > 0 )
+		refresh_period = 1.0 / display_mode.refresh_rate;
+	uint64_t last_swap_counter = 0, frame_start_counter = 0, target_vblank_counter = 0;
+	int late_latch_frames = 0, late_latch_misses = 0;
+	
+	// Frames since the last summary of --gl-debug=perf
+	int gl_debug_perf_frames = 0;
+	
+	// The events only invalidate the main window and the frame scheduler decides when to draw. So e.g. the resize
+	// events of a window drag within one refresh period end up in one frame instead of one frame each. The loop used to
+	// draw one frame for each batch of events that changed something, event_batches_with_invalidations counts those to
+	// report how many frames the scheduler saved.
+	frame_scheduler_t scheduler = { .frame_interval = refresh_period };
+	int event_batches_with_invalidations = 0;
+	
+	// Converts the SDL timestamp of an input event to a performance counter value and remembers it until the next swap
+	void input_arrived(uint32_t timestamp_ms) {
+		uint64_t now = SDL_GetPerformanceCounter();
+		uint32_t age_ms = SDL_GetTicks() - timestamp_ms;
+		if (pending_input_count < (int)(sizeof(pending_input_counters) / sizeof(pending_input_counters[0])))
+			pending_input_counters[pending_input_count++] = now - age_ms * counter_frequency / 1000;
+	}
+	
+	// Swaps the main window and does the bookkeeping for the input latency and --late-latch
+	void swap_main_window() {
+		if (late_latch)
+			glFinish();
+		uint64_t render_end_counter = SDL_GetPerformanceCounter();
+		SDL_GL_SwapWindow(window);
+		uint64_t now = SDL_GetPerformanceCounter();
+		if (frames_in_flight > 0)
+			frame_pacer_end_frame(&pacer);
+		
+		if (last_swap_counter != 0) {
+			double interval = (now - last_swap_counter) / (double)counter_frequency;
+			double periods = round(interval / refresh_period);
+			if ( periods >= 1 && periods <= 4 && fabs(interval - periods * refresh_period) < 0.1 * refresh_period )
+				refresh_period = 0.95 * refresh_period + 0.05 * interval / periods;
+		}
+		last_swap_counter = now;
+		scheduler.frame_interval = refresh_period;
+		
+		// Frames that weren't late latched (e.g. the first one, which also fills the glyph atlas) don't go into the render
+		// time estimate
+		if (late_latch && target_vblank_counter != 0) {
+			double render_time = (render_end_counter - frame_start_counter) / (double)counter_frequency;
+			render_time_estimate = (render_time > render_time_estimate) ? render_time : 0.95 * render_time_estimate + 0.05 * render_time;
+			late_latch_frames++;
+			if (now > target_vblank_counter + refresh_period / 2 * counter_frequency)
+				late_latch_misses++;
+			target_vblank_counter = 0;
+		}
+		
+		for (int i = 0; i < pending_input_count; i++) {
+			double latency = (now - pending_input_counters[i]) / (double)counter_frequency;
+			input_latency_sum += latency;
+			input_latency_max = (latency > input_latency_max) ? latency : input_latency_max;
+		}
+		input_latency_count += pending_input_count;
+		pending_input_count = 0;
+		
+		if (gl_debug_level == GL_DEBUG_LEVEL_PERF) {
+			gl_debug_perf_frames++;
+			if (gl_debug_perf_frames >= gl_debug_perf_report_interval) {
+				gl_debug_perf_report(gl_debug_perf_frames);
+				gl_debug_perf_frames = 0;
+			}
+		}
+	}
+	
+	// Scrolls the log view to new_scroll_px (clamped to the log). With --smooth-scroll only the target moves.
+	void log_view_scroll_to(int new_scroll_px) {
+		int max_scroll_px = log_view_line_count * log_view_line_height - window_height;
+		max_scroll_px = (max_scroll_px < 0) ? 0 : max_scroll_px;
+		new_scroll_px = (new_scroll_px < 0) ? 0 : (new_scroll_px > max_scroll_px) ? max_scroll_px : new_scroll_px;
+		log_view_scroll_target_px = new_scroll_px;
+		if (!smooth_scroll) {
+			log_view_scroll_delta_px += new_scroll_px - log_view_scroll_px;
+			log_view_scroll_px = new_scroll_px;
+		}
+		log_view_follow = (new_scroll_px == max_scroll_px);
+		frame_scheduler_invalidate(&scheduler);
+	}
+	
+	// Indexes what was appended to the --tail file and damages the lines that changed
+	void log_view_tail_updated() {
+		int line_count_before = log_view_line_count;
+		int first_changed_line = log_file_update(&tail_file);
+		if (first_changed_line == -1)
+			return;
+		log_view_line_count = log_file_line_count(&tail_file);
+		
+		// Stay at the end of the log if we're there (or if the log got shorter than the view)
+		int max_scroll_px = log_view_line_count * log_view_line_height - window_height;
+		if (log_view_follow || log_view_scroll_target_px > max_scroll_px)
+			log_view_scroll_to(max_scroll_px);
+		
+		// Lines after the new end of a truncated file are damaged too since they vanished
+		int damage_top_px = first_changed_line * log_view_line_height;
+		int damage_bottom_px = ((log_view_line_count > line_count_before) ? log_view_line_count : line_count_before) * log_view_line_height;
+		if (log_view_damage_bottom_px > log_view_damage_top_px) {
+			damage_top_px    = (log_view_damage_top_px    < damage_top_px)    ? log_view_damage_top_px    : damage_top_px;
+			damage_bottom_px = (log_view_damage_bottom_px > damage_bottom_px) ? log_view_damage_bottom_px : damage_bottom_px;
+		}
+		log_view_damage_top_px = damage_top_px;
+		log_view_damage_bottom_px = damage_bottom_px;
+		if (damage_top_px < log_view_scroll_px + window_height && damage_bottom_px > log_view_scroll_px) {
+			frame_scheduler_invalidate(&scheduler);
+			tail_updates_drawn++;
+		}
+	}
+	
+	// Processes all pending events
+	bool quit = false, window_resized = false;
+	void process_events() {
+		int invalidations_before = scheduler.invalidations;
 		SDL_Event event;
-		bool redraw = false;
 		while( SDL_PollEvent(&event) ) {
 			if (event.type == SDL_QUIT) {
 				quit = true;
 				break;
+			} else if ( event.type == SDL_WINDOWEVENT && event.window.windowID != SDL_GetWindowID(window) ) {
+				// Events for the extra windows of --windows
+				for (int i = 0; i < extra_window_count; i++) {
+					extra_window_t* w = &extra_windows[i];
+					if ( w->window == NULL || event.window.windowID != SDL_GetWindowID(w->window) )
+						continue;
+					
+					if (event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+						w->redraw = true;
+					} else if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
+						w->width = event.window.data1;
+						w->height = event.window.data2;
+						w->redraw = true;
+					} else if (event.window.event == SDL_WINDOWEVENT_CLOSE) {
+						SDL_GL_MakeCurrent(w->window, w->gl_ctx);
+						glDeleteVertexArrays(1, &w->vao);
+						SDL_GL_MakeCurrent(window, gl_ctx);
+						SDL_GL_DeleteContext(w->gl_ctx);
+						SDL_DestroyWindow(w->window);
+						*w = (extra_window_t){};
+					}
+				}
 			} else if ( event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED ) {
-				redraw = true;
+				frame_scheduler_invalidate(&scheduler);
 			} else if ( event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_RESIZED ) {
+				// The viewport and the log view cache are resized at the next frame, only once for all resizes until then
 				window_width = event.window.data1;
 				window_height = event.window.data2;
+				window_resized = true;
+				frame_scheduler_invalidate(&scheduler);
+			} else if ( event.type == SDL_MOUSEWHEEL && log_view ) {
+				// Scroll by 3 lines per wheel step
+				log_view_scroll_to(log_view_scroll_target_px - event.wheel.y * 3 * log_view_line_height);
+				input_arrived(event.common.timestamp);
+			} else if ( tail_path && event.type == tail_file.update_event_type ) {
+				log_view_tail_updated();
+			} else if (event.type == SDL_TEXTINPUT) {
+				int length = strlen(event.text.text);
+				if (typed_text_length + length < (int)sizeof(typed_text)) {
+					memcpy(typed_text + typed_text_length, event.text.text, length + 1);
+					typed_text_length += length;
+				}
+				frame_scheduler_invalidate(&scheduler);
+				input_arrived(event.common.timestamp);
+			}
+		}
+		
+		if (scheduler.invalidations > invalidations_before)
+			event_batches_with_invalidations++;
+	}
+	
+	
+	while(!quit) {
+		// Wait for events until the next frame is due or, if no frame is needed, until anything happens
+		int timeout_ms = frame_scheduler_timeout_ms(&scheduler);
+		if (timeout_ms < 0)
+			SDL_WaitEvent(NULL);
+		else if (timeout_ms > 0)
+			SDL_WaitEventTimeout(NULL, timeout_ms);
+		
+		process_events();
+		bool frame_due = !quit && frame_scheduler_timeout_ms(&scheduler) == 0;
+		
+		// With --late-latch sleep until the next vblank we can still make minus the render time, then take the events
+		// that arrived in the meantime
+		if (late_latch && frame_due && last_swap_counter != 0) {
+			double since_swap = (SDL_GetPerformanceCounter() - last_swap_counter) / (double)counter_frequency;
+			double next_vblank = (floor(since_swap / refresh_period) + 1) * refresh_period;
+			while (next_vblank - render_time_estimate - late_latch_margin < since_swap)
+				next_vblank += refresh_period;
+			SDL_Delay((next_vblank - render_time_estimate - late_latch_margin - since_swap) * 1000);
+			target_vblank_counter = last_swap_counter + next_vblank * counter_frequency;
+			process_events();
+		}
+		
+		if (frame_due) {
+			frame_scheduler_begin_frame(&scheduler);
+			if (frames_in_flight > 0)
+				frame_pacer_begin_frame(&pacer);
+			frame_start_counter = SDL_GetPerformanceCounter();
+			if (window_resized) {
 				glViewport(0, 0, window_width, window_height);
-				redraw = true;
+				if (log_view)
+					scroll_cache_resize(&log_view_cache, window_width, window_height);
+				if (tail_path && log_view_follow)
+					log_view_scroll_to(log_view_line_count * log_view_line_height);
+				window_resized = false;
 			}
 		}
 		
-		// Redraw if necessary
-		if (redraw) {
-			// Parameters for drawing the example text
-			float font_size_pt = 10, pos_x = 10, pos_y = 10, coverage_adjustment = 0.0;
-			color_t text_color = (color_t){218, 218, 218, 255};
-			const char* text = "The quick brown fox jumps over the lazy dog.";
+		// Redraw the dashboard if necessary
+		if (frame_due && dashboard) {
+			dashboard_redraws++;
+			text_layer_invalidate(&dashboard_panels[0]);
 			
-			// Put every glpyh in text into rect_buffer 
-			{
-				// Get the font metrics, the the stbtt_ScaleForMappingEmToPixels() and stbtt_GetFontVMetrics() documentation
-				// for details.
-				// 
-				// From "Font Size in Pixels or Points" in stb_truetype.h
-				// > Windows traditionally uses a convention that there are 96 pixels per inch, thus making 'inch'
-				// > measurements have nothing to do with inches, and thus effectively defining a point to be 1.333 pixels.
-				float font_size_px = font_size_pt * 1.333333;
-				float font_scale = stbtt_ScaleForMappingEmToPixels(&font_info, font_size_px);
-				
-				int font_ascent = 0, font_descent = 0, font_line_gap = 0;
-				stbtt_GetFontVMetrics(&font_info, &font_ascent, &font_descent, &font_line_gap);
-				float line_height = (font_ascent - font_descent + font_line_gap) * font_scale;  // Based on the docs of stbtt_GetFontVMetrics()
-				float baseline = font_ascent * font_scale;
+			for (int i = 0; i < 9; i++) {
+				text_layer_t* panel = &dashboard_panels[i];
+				if (panel->valid)
+					continue;
 				
-				// Keep track of the current position while we process glyph after glyph
-				float current_x = pos_x;
-				float current_y = pos_y + round(baseline);
+				// Render the panel text onto its background
+				char panel_text[1024];
+				int panel_text_filled = snprintf(panel_text, sizeof(panel_text), "Panel %d, redraws: %d, panel renders: %d\n", i + 1, (i == 0) ? dashboard_redraws : 0, dashboard_panel_renders);
+				for (int line = 0; line < 10; line++)
+					panel_text_filled += snprintf(panel_text + panel_text_filled, sizeof(panel_text) - panel_text_filled, "server-%02d: %4d req/s, %3d ms p99\n", line + i * 10, (line * 7919 + i * 104729) % 5000, (line * 31 + i * 17) % 250);
 				
-				// Iterate over the UTF-8 text codepoint by codepoint. A codepoint is basically the 32 bit ID of a character
-				// as defined by Unicode.
-				uint32_t prev_codepoint = 0;
-				for(utf8_iterator_t it = utf8_first(text); it.codepoint != 0; it = utf8_next(it)) {
-					uint32_t codepoint = it.codepoint;
-					
-					// Apply kerning
-					if (prev_codepoint)
-						current_x += stbtt_GetCodepointKernAdvance(&font_info, prev_codepoint, codepoint) * font_scale;
-					prev_codepoint = codepoint;
-					
-					if (codepoint == '\n') {
-						// Handle line breaks
-						current_x = pos_x;
-						current_y += round(line_height);
-					} else {
-						int horizontal_filter_padding = 1, subpixel_positioning_left_padding = 1;
-						
-						// Check if that glyph is already in the glyph atlas
-						assert(codepoint <= 127);
-						glyph_atlas_item_t glyph_atlas_item = glyph_atlas_items[codepoint];
-						if (glyph_atlas_item.filled) {
-							// The atlas item for this codepoint is already filled, so we already rasterized the glyph, put it in the atlas texture and stored
-							// the relevant data in an atlas item. Everything is already done, so just use the atlas item.
-						} else {
-							// The atlas item is not yet filled, meaning the glyph hasn't been rasterized yet. So we do that now and put it into the glyph atlas.
-							
-							// Find the glyph index first for faster lookup in the following functions. Otherwise stb_truetype has to search through a translation
-							// table from codepoint to index at each call.
-							int glyph_index = stbtt_FindGlyphIndex(&font_info, codepoint);
-							
-							// Get glyph dimensions, see stbtt_GetGlyphBitmapBox() and stbtt_GetCodepointBitmapBox() for details.
-							int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
-							stbtt_GetGlyphBitmapBox(&font_info, glyph_index, font_scale, font_scale, &x0, &y0, &x1, &y1);
-							int glyph_width_px = x1 - x0, glyph_height_px = y1 - y0;
-							int distance_from_baseline_to_top_px = -y0;  // y0 from stbtt_GetGlyphBitmapBox() is negative (e.g. -11), that's why we flip it here.
-							
-							// Only render glyphs that actually have some visual representation (skip spaces, etc.)
-							if (glyph_width_px > 0 && glyph_height_px > 0) {
-								int padded_glyph_width_px  = subpixel_positioning_left_padding + horizontal_filter_padding + glyph_width_px + horizontal_filter_padding;
-								int padded_glyph_height_px = glyph_height_px;
-								
-								// Here you would usually ask the glyph atlas to allocate a region with the size of padded_glyph_width_px and padded_glyph_height_px size.
-								// If the atlas is already full you would render all the rectangles already in the buffer because they expect that their glyphs are in the
-								// texture atlas. After that is done we can clear out old glyphs to make room for our new glyph here and continue on rendering the text.
-								
-								// Instead we just use our mockup atlas allocator. Every region in there is 32x32 in size and we assume that the padded glyph fits inside.
-								// The position in the atlas texture is derived from the codepoint. Just putting all lower 128 ASCII chars left to right and top to bottom
-								// in the atlas.
-								// AGAIN: Don't use this for anything other than demonstration purposes. It's horribly limited and inefficient!
-								int atlas_item_width = 32, atlas_item_height = 32;
-								int atlas_item_x = (codepoint % (glyph_atlas_width  / atlas_item_width )) * atlas_item_width;
-								int atlas_item_y = (codepoint / (glyph_atlas_height / atlas_item_height)) * atlas_item_height;
-								assert(padded_glyph_width_px <= atlas_item_width && padded_glyph_height_px <= atlas_item_height);
-								
-								// Create an RGB bitmap with the size of the atlas item and rasterize the glyph into it.
-								// This is larger than need be, but avoids coordinate transformation and range checks when applying the FreeType LCD filter below. Also
-								// initialize it to zeor for the same reason. We rasterize the glyph as an grayscale image with 3x the horizontal resolution so we have
-								// one coverage (grayscale) value for each subpixel.
-								// Note: You probably don't want to allocate and free a bitmap each time we render a glyph. You can create a permanent scratch buffer
-								// with the maximum glyph size or resize it on demand. We alloc and free here just for demonstration purposes.
-								int horizontal_resolution = 3;
-								int bitmap_stride     = atlas_item_width * horizontal_resolution;
-								int bitmap_size       = bitmap_stride * atlas_item_height;
-								uint8_t* glyph_bitmap = calloc(1, bitmap_size);
-								// Position of the rasterized glyph within the atlas item when padding is taken into account
-								int glyph_offset_x = (subpixel_positioning_left_padding + horizontal_filter_padding) * horizontal_resolution;
-								// Rasterize the glyph into glyph_bitmap
-								stbtt_MakeGlyphBitmap(&font_info,
-									glyph_bitmap + glyph_offset_x,
-									atlas_item_width * horizontal_resolution, atlas_item_height, bitmap_stride,
-									font_scale * horizontal_resolution, font_scale,
-									glyph_index
-								);
-								
-								// Allocate an RGB bitmap with the size of the atlas item and clear it out to black. That way we overwrite the entire atlas item with black,
-								// even if the padded glyph is smaller. Not really necessary but keeps the atlas clean.
-								// We then apply the FreeType LCD filter by reading from the glyph bitmap, filtering and writing to the atlas item bitmap.
-								// Note: As above you probably don't want to allocate a new bitmap for each glyph. Just create another permanent scratch bitmap for this step.
-								uint8_t* atlas_item_bitmap = calloc(1, bitmap_size);
-								
-								// Apply the FreeType LCD filter to avoid subpixel anti-aliasing color fringes,
-								// taken from FT_LCD_FILTER_DEFAULT in https://freetype.org/freetype2/docs/reference/ft2-lcd_rendering.html
-								// Just iterate over all the subpixels the filter can reach, no need to filter the entire bitmap when the results would just be 0.
-								uint8_t filter_weights[5] = { 0x08, 0x4D, 0x56, 0x4D, 0x08 };
-								for (int y = 0; y < padded_glyph_height_px; y++) {
-									// We don't need to filter the first 4 and last 1 subpixels. The filter kernel is only 5 wide and it can only distribute data
-									// at most 2 subpixels in each direction.
-									// The first 6 subpixels are just padding (subpixel_positioning_left_padding and horizontal_filter_padding) so the first 4
-									// subpixels in atlas_item_bitmap can't collect any data from the first subpixel in glyph_bitmap. Hence we start at 4 instead of 0.
-									// The last subpixel is padding again (horizontal_filter_padding) and only the 3rd and 2nd subpixel from the right can collect
-									// data from the last subpixel of the glyph_bitmap. So we skip the last subpixel as well.
-									int x_end = padded_glyph_width_px * horizontal_resolution - 1;
-									for (int x = 4; x < x_end; x++) {
-										// Apply the kernel aka filter taps while reading from glyph_bitmap. kernel_x_end makes sure we don't read over the end of the bitmap.
-										int sum = 0, filter_weight_index = 0, kernel_x_end = (x == x_end - 1) ? x + 1 : x + 2;
-										for (int kernel_x = x - 2; kernel_x <= kernel_x_end; kernel_x++) {
-											assert(kernel_x >= 0 && kernel_x < x_end + 1);  // There is 1 more subpixel after the last processed one, so we can access that one just fine.
-											assert(y        >= 0 && y        < padded_glyph_height_px);
-											int offset = kernel_x + y*bitmap_stride;
-											assert(offset >= 0 && offset < bitmap_size);
-											sum += glyph_bitmap[offset] * filter_weights[filter_weight_index++];
-										}
-										
-										// Do the division once at the end instead of for each filter weight and make sure we handle overflows.
-										// Rounding causes some pixels to accumulate a +1 which overflows from 255 to 0 and causes one subpixel artifacts.
-										// Put the result into atlas_item_bitmap.
-										sum = sum / 255;
-										atlas_item_bitmap[x + y*bitmap_stride] = (sum > 255) ? 255 : sum;
-									}
-								}
-								free(glyph_bitmap);
-								
-								// Upload the filtered atlas item bitmap into the glyph atlas texture
-								glTextureSubImage2D(glyph_atlas_texture, 0, atlas_item_x, atlas_item_y, atlas_item_width, atlas_item_height, GL_RGB, GL_UNSIGNED_BYTE, atlas_item_bitmap);
-								free(atlas_item_bitmap);
-								
-								glyph_atlas_item.tex_coords.left   = atlas_item_x;
-								glyph_atlas_item.tex_coords.top    = atlas_item_y;
-								glyph_atlas_item.tex_coords.right  = atlas_item_x + padded_glyph_width_px;
-								glyph_atlas_item.tex_coords.bottom = atlas_item_y + padded_glyph_height_px;
-							} else {
-								// The glyph has no visual representation (e.g. space). Just set the glyph atlas entry to some
-								// value we can check for later on to see if the glyph has no visual representation.
-								glyph_atlas_item.tex_coords.left   = -1;
-								glyph_atlas_item.tex_coords.top    = -1;
-								glyph_atlas_item.tex_coords.right  = -1;
-								glyph_atlas_item.tex_coords.bottom = -1;
-							}
-							
-							// Finish up the glyph atlas item and put it back into the array
-							glyph_atlas_item.glyph_index                      = glyph_index;
-							glyph_atlas_item.distance_from_baseline_to_top_px = distance_from_baseline_to_top_px;
-							glyph_atlas_item.filled                           = true;
-							glyph_atlas_items[codepoint] = glyph_atlas_item;
-						}
-						
-						int glyph_advance_width = 0, glyph_left_side_bearing = 0;
-						stbtt_GetGlyphHMetrics(&font_info, glyph_atlas_item.glyph_index, &glyph_advance_width, &glyph_left_side_bearing);
-						
-						// Only render glyphs that actually have some visual representation (skip spaces, etc.)
-						if (glyph_atlas_item.tex_coords.left != -1) {
-							float glyph_pos_x = current_x + (glyph_left_side_bearing * font_scale);
-							float glyph_pos_x_px = 0;
-							float glyph_pos_x_subpixel_shift = modff(glyph_pos_x, &glyph_pos_x_px);
-							float glyph_pos_y_px = current_y - glyph_atlas_item.distance_from_baseline_to_top_px;
-							int glyph_width_with_horiz_filter_padding = glyph_atlas_item.tex_coords.right  - glyph_atlas_item.tex_coords.left;
-							int glyph_height                          = glyph_atlas_item.tex_coords.bottom - glyph_atlas_item.tex_coords.top;
-							
-							rect_buffer[rect_buffer_filled++] = (rect_instance_t){
-								.pos.left   = glyph_pos_x_px - (subpixel_positioning_left_padding + horizontal_filter_padding),
-								.pos.right  = glyph_pos_x_px - (subpixel_positioning_left_padding + horizontal_filter_padding) + glyph_width_with_horiz_filter_padding,
-								.pos.top    = glyph_pos_y_px,
-								.pos.bottom = glyph_pos_y_px + glyph_height,
-								.subpixel_shift = glyph_pos_x_subpixel_shift,
-								.tex_coords     = glyph_atlas_item.tex_coords,
-								.color          = text_color
-							};
-						}
-						
-						current_x += glyph_advance_width * font_scale;
-					}
+				text_layer_begin(panel);
+					text_begin_frame(&text_renderer, panel->width, panel->height);
+						text_draw(&text_renderer, &font, font_size_pt, 8, 8, text_color, panel_text);
+					text_end_frame(&text_renderer);
+				text_layer_end(panel, window_width, window_height);
+				dashboard_panel_renders++;
+			}
+			
+			// Each panel is now just one copy into the window
+			glClearColor(0.25, 0.25, 0.25, 1.0);
+			glClear(GL_COLOR_BUFFER_BIT);
+			for (int i = 0; i < 9; i++)
+				text_layer_composite(&dashboard_panels[i], window_height);
+			
+			swap_main_window();
+		}
+		
+		// Redraw the log view if necessary
+		if (frame_due && log_view) {
+			// With --smooth-scroll move half of the remaining way (at least 1 px) to the scroll target and keep animating
+			// until it's reached
+			if (log_view_scroll_px != log_view_scroll_target_px) {
+				int step = (log_view_scroll_target_px - log_view_scroll_px) / 2;
+				if (step == 0)
+					step = log_view_scroll_target_px - log_view_scroll_px;
+				log_view_scroll_delta_px += step;
+				log_view_scroll_px += step;
+				if (log_view_scroll_px != log_view_scroll_target_px)
+					frame_scheduler_animate(&scheduler);
+			}
+			
+			// Shift the last frame by the scroll delta and find out which strip we have to draw
+			int damaged_top = 0, damaged_bottom = 0;
+			scroll_cache_scroll(&log_view_cache, log_view_scroll_delta_px, &damaged_top, &damaged_bottom);
+			log_view_scroll_delta_px = 0;
+			
+			// Add the lines of the --tail file that changed as far as they're in view
+			if (log_view_damage_bottom_px > log_view_damage_top_px) {
+				int top = log_view_damage_top_px - log_view_scroll_px, bottom = log_view_damage_bottom_px - log_view_scroll_px;
+				top = (top < 0) ? 0 : top;
+				bottom = (bottom > window_height) ? window_height : bottom;
+				if (top < bottom && damaged_bottom > damaged_top) {
+					damaged_top    = (top    < damaged_top)    ? top    : damaged_top;
+					damaged_bottom = (bottom > damaged_bottom) ? bottom : damaged_bottom;
+				} else if (top < bottom) {
+					damaged_top = top;
+					damaged_bottom = bottom;
 				}
+				log_view_damage_top_px = log_view_damage_bottom_px = 0;
 			}
 			
-			// Draw all the rects in rect_buffer
-			{
+			if (damaged_bottom > damaged_top) {
+				glBindFramebuffer(GL_FRAMEBUFFER, log_view_cache.framebuffers[log_view_cache.current]);
+				glEnable(GL_SCISSOR_TEST);
+				glScissor(0, window_height - damaged_bottom, window_width, damaged_bottom - damaged_top);
 				glClearColor(0.25, 0.25, 0.25, 1.0);
 				glClear(GL_COLOR_BUFFER_BIT);
+				// The text renderer clips the lines to the strip with a clip rect, so they end up in its trace with --record.
+				// Run templates don't support clip rects and still need the scissor test.
+				if (!use_run_templates) {
+					glDisable(GL_SCISSOR_TEST);
+					text_begin_frame(&text_renderer, window_width, window_height);
+					text_clip_begin(&text_renderer, 0, damaged_top, window_width, damaged_bottom);
+				}
+				int64_t rects_drawn_before = text_renderer.rects_drawn;
 				
-				// Upload the rect buffer to the GPU.
-				// Allow the GPU driver to create a new buffer storage for each draw command. That way it doesn't have to wait for
-				// the previous draw command to finish to reuse the same buffer storage.
-				glNamedBufferData(rect_instances_vbo, rect_buffer_filled * sizeof(rect_buffer[0]), rect_buffer, GL_DYNAMIC_DRAW);
-				
-				// Setup pre-multiplied alpha blending (that's why the source factor is GL_ONE) with dual source blending so we can blend
-				// each subpixel individually for subpixel anti-aliased glyph rendering (that's what GL_ONE_MINUS_SRC1_COLOR does).
-				glEnable(GL_BLEND);
-				glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC1_COLOR);
-				
-				glBindVertexArray(vao);
-					glUseProgram(shader_program);
-						// layout(location = 0) uniform vec2 half_viewport_size
-						// Note: Do a float division on window_width and window_height to properly handle uneven window dimensions.
-						// An integer division causes 1px artifacts in the middle of windows due to a wrong transform.
-						glProgramUniform2f(shader_program, 0, window_width / 2.0f, window_height / 2.0f);
-						// layout(location = 1) uniform float coverage_adjustment
-						glProgramUniform1f(shader_program, 1, coverage_adjustment);
-						
-						glBindTextureUnit(0, glyph_atlas_texture);
+				// Only lay out the lines that touch the damaged strip. Take one more line on each side for glyphs that reach
+				// outside of their line (the clip rect cuts them off at the strip).
+				int first_line = (log_view_scroll_px + damaged_top) / log_view_line_height - 1;
+				int last_line  = (log_view_scroll_px + damaged_bottom) / log_view_line_height + 1;
+				for (int line = (first_line < 0) ? 0 : first_line; line <= last_line && line < log_view_line_count; line++) {
+					// Room for the 128 glyphs drawn per line, even if each one is 4 bytes of UTF-8. Zero terminated for the run
+					// templates.
+					char line_text[513];
+					const char* text = line_text;
+					size_t text_length = 0;
+					if (tail_path) {
+						text_length = log_file_read_line(&tail_file, line, line_text, sizeof(line_text) - 1);
+						line_text[text_length] = '\0';
+					} else {
+						log_line_text(line, line_text, sizeof(line_text));
+						text_length = strlen(line_text);
+					}
+					float line_y = line * log_view_line_height - log_view_scroll_px;
+					
+					// Lines of a --tail file can contain any glyphs. The text renderer starts a new atlas page by itself when
+					// they don't fit anymore, the scroll cache keeps what was drawn with the old page.
+					if (!use_run_templates) {
+						glyph_t line_glyphs[128];
+						int line_glyph_count = glyph_run_from_utf8(&font, font_size_pt, text, text_length, line_glyphs, sizeof(line_glyphs) / sizeof(line_glyphs[0]));
+						text_draw_run(&text_renderer, &font, font_size_pt, line_glyphs, line_glyph_count, pos_x, line_y, text_color);
+						log_view_glyphs_drawn += line_glyph_count;
+						continue;
+					}
+					
+					// Just one run instance per word. When the templates, instances or the atlas are full draw what we have
+					// and continue the line with empty templates. If that fails right away the word's glyphs didn't fit into
+					// the atlas, so start a new atlas page as well.
+					size_t words_done = 0;
+					bool line_done = false;
+					while (!line_done) {
+						int instances_before = run_templates.instance_count;
+						line_done = glyph_run_templates_add_text(&run_templates, &glyph_atlas, &font, font_size_pt, line_text, pos_x, line_y, text_color, &words_done);
+						log_view_instance_bytes += (run_templates.instance_count - instances_before) * sizeof(glyph_run_instance_t);
+						for (int i = instances_before; i < run_templates.instance_count; i++)
+							log_view_glyphs_drawn += run_templates.templates[run_templates.instances[i].template_index].glyph_count;
 						
-						glDrawArraysInstanced(GL_TRIANGLES, 0, 6, rect_buffer_filled);
-					glUseProgram(0);
-				glBindVertexArray(0);
-				
-				// We don't need the contents of the CPU or GPU buffer anymore
-				glInvalidateBufferData(rect_instances_vbo);
-				rect_buffer_filled = 0;
+						if (!line_done) {
+							bool templates_were_empty = (run_templates.template_count == 0);
+							draw_run_instances(window_width, window_height);
+							glyph_run_templates_clear(&run_templates);
+							if (templates_were_empty)
+								glyph_atlas_clear(&glyph_atlas);
+						}
+					}
+				}
+				if (use_run_templates) {
+					draw_run_instances(window_width, window_height);
+					glDisable(GL_SCISSOR_TEST);
+				} else {
+					text_clip_end(&text_renderer);
+					text_end_frame(&text_renderer);
+					log_view_instance_bytes += (text_renderer.rects_drawn - rects_drawn_before) * sizeof(rect_instance_t);
+				}
 				
-				SDL_GL_SwapWindow(window);
+				glBindFramebuffer(GL_FRAMEBUFFER, 0);
 			}
+			log_view_frames++;
+			
+			scroll_cache_present(&log_view_cache);
+			swap_main_window();
+		}
+		
+		// Redraw if necessary
+		if (frame_due && !dashboard && !log_view) {
+			draw_demo(window_width, window_height);
+			swap_main_window();
+		}
+		
+		// Redraw the extra windows of --windows if necessary. The text renderer draws with its vao, so point it to the VAO
+		// of the window's context while drawing there.
+		for (int i = 0; i < extra_window_count; i++) {
+			extra_window_t* w = &extra_windows[i];
+			if (w->window == NULL || !w->redraw)
+				continue;
+			
+			GLuint main_vao = text_renderer.vao;
+			SDL_GL_MakeCurrent(w->window, w->gl_ctx);
+			text_renderer.vao = w->vao;
+				glViewport(0, 0, w->width, w->height);
+				draw_demo(w->width, w->height);
+				SDL_GL_SwapWindow(w->window);
+			text_renderer.vao = main_vao;
+			SDL_GL_MakeCurrent(window, gl_ctx);
+			w->redraw = false;
 		}
 	}
 	
 	
 	// Cleanup
+	if (extra_window_count > 0) {
+		int windows_open = 1;
+		for (int i = 0; i < extra_window_count; i++) {
+			extra_window_t* w = &extra_windows[i];
+			if (w->window == NULL)
+				continue;
+			SDL_GL_MakeCurrent(w->window, w->gl_ctx);
+			glDeleteVertexArrays(1, &w->vao);
+			SDL_GL_MakeCurrent(window, gl_ctx);
+			SDL_GL_DeleteContext(w->gl_ctx);
+			SDL_DestroyWindow(w->window);
+			windows_open++;
+		}
+		printf("windows: %d glyphs rasterized for %d windows (%d still open)\n", glyph_atlas.items_used, extra_window_count + 1, windows_open);
+	}
+	if (log_view) {
+		printf("log view: %lld glyphs drawn in %lld frames, %.1f glyphs per frame, %.1f KiB of instances per frame%s\n", (long long)log_view_glyphs_drawn, (long long)log_view_frames,
+			log_view_glyphs_drawn / (double)(log_view_frames ? log_view_frames : 1), log_view_instance_bytes / 1024.0 / (log_view_frames ? log_view_frames : 1),
+			use_run_templates ? " (run templates)" : "");
+		scroll_cache_destroy(&log_view_cache);
+	}
+	if (tail_path) {
+		printf("tail: %d lines, %d updates indexed %.1f MiB in %.3f ms (%.3f ms per update), %d updates had changes in view\n",
+			log_file_line_count(&tail_file), tail_file.updates, tail_file.bytes_indexed / (1024.0 * 1024.0), tail_file.index_seconds * 1000,
+			tail_file.index_seconds * 1000 / (tail_file.updates ? tail_file.updates : 1), tail_updates_drawn);
+		log_file_close(&tail_file);
+	}
+	if (dashboard) {
+		for (int i = 0; i < 9; i++)
+			text_layer_destroy(&dashboard_panels[i]);
+	}
+	if (latency_report) {
+		printf("frame scheduler: %d frames for %d invalidations in %d event batches (%d redundant frames avoided), %d animation frames\n",
+			scheduler.frames, scheduler.invalidations, event_batches_with_invalidations,
+			event_batches_with_invalidations - (scheduler.frames - scheduler.animation_frames), scheduler.animation_frames);
+	}
+	if (text_renderer.frames > 0) {
+		int frames = text_renderer.frames;
+		printf("immediate mode text: %d frames, %.1f text calls and %.1f draw calls per frame, atlas cleared %d times\n", frames,
+			text_renderer.calls / (double)frames, text_renderer.draw_calls / (double)frames, text_renderer.atlas_clears);
+	}
+	if (text_renderer.trace.file) {
+		int frames = text_renderer.trace.frames, skipped = text_renderer.trace.skipped_records;
+		long size = ftell(text_renderer.trace.file);
+		int64_t records = text_renderer.trace.records;
+		if ( text_trace_writer_close(&text_renderer.trace) )
+			printf("record: %d frames, %lld records, %.1f KiB written to %s, %d records with unknown fonts skipped\n", frames, (long long)records, size / 1024.0, record_path, skipped);
+		else
+			fprintf(stderr, "Failed to write the trace %s\n", record_path);
+	}
+	text_renderer_destroy(&text_renderer);
+	if (frames_in_flight > 0) {
+		int timed = pacer.gpu_frames_timed ? pacer.gpu_frames_timed : 1;
+		printf("frame pacing: %d frames in flight, %d frames, CPU waited %.3f ms per frame for fences, GPU busy %.3f ms and idle %.3f ms per frame, %d draws didn't fit into the stream buffer\n",
+			frames_in_flight, pacer.frames, pacer.cpu_wait_seconds * 1000 / (pacer.frames ? pacer.frames : 1),
+			pacer.gpu_busy_seconds * 1000 / timed, pacer.gpu_idle_seconds * 1000 / timed, pacer.stream_overflows);
+		frame_pacer_destroy(&pacer);
+	}
+	if (gl_debug_level == GL_DEBUG_LEVEL_PERF) {
+		gl_debug_perf_report(gl_debug_perf_frames);
+		int ids = 0, warnings = 0;
+		for (size_t i = 0; i < sizeof(gl_debug_perf_entries) / sizeof(gl_debug_perf_entries[0]); i++) {
+			ids += (gl_debug_perf_entries[i].total_count > 0);
+			warnings += gl_debug_perf_entries[i].total_count;
+		}
+		printf("gl debug: %d performance warnings with %d different ids\n", warnings, ids);
+	}
+	if (latency_report) {
+		printf("latency: %d input events, event to swap %.2f ms mean, %.2f ms max, refresh %.2f Hz", input_latency_count,
+			input_latency_sum * 1000 / (input_latency_count ? input_latency_count : 1), input_latency_max * 1000, 1 / refresh_period);
+		if (late_latch)
+			printf(", late latch: render estimate %.2f ms, %d of %d frames missed their vblank", render_time_estimate * 1000, late_latch_misses, late_latch_frames);
+		printf("\n");
+	}
+	if (use_gpu_layout)
+		gpu_text_layout_destroy(&gpu_layout);
+	if (use_run_templates)
+		glyph_run_templates_destroy(&run_templates);
 	glDeleteVertexArrays(1, &vao);
 	glDeleteBuffers(1, &rect_vertices_vbo);
 	glDeleteBuffers(1, &rect_instances_vbo);
+	glDeleteBuffers(1, &clip_rects_ubo);
 	glDeleteProgram(shader_program);
-	glDeleteTextures(1, &glyph_atlas_texture);
+	glyph_atlas_destroy(&glyph_atlas);
 	
 	SDL_GL_DeleteContext(gl_ctx);
 	SDL_DestroyWindow(window);
+	font_destroy(&font);
+	free(font_data);
 	
 	return 0;
 }
\ No newline at end of file
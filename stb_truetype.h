@@ -123,6 +123,12 @@
 //        #define STBTT_RASTERIZER_VERSION 1
 //   which will incur about a 15% speed hit.
 //
+//   Curves are flattened with recursive subdivision by default. With
+//        #define STBTT_FLATTEN_ANALYTIC
+//   stbtt_Rasterize(), stbtt_RasterizeEx(), stbtt_MakeGlyphBitmapBatch() and
+//   everything built on them use stbtt_FlattenShape() instead (segment counts
+//   from Wang's formula, same tolerance, slightly different points).
+//
 // ADDITIONAL DOCUMENTATION
 //
 //   Immediately after this block comment are a series of sample programs.
@@ -557,6 +563,20 @@ STBTT_DEF int  stbtt_PackBegin(stbtt_pack_context *spc, unsigned char *pixels, i
 //
 // Returns 0 on failure, 1 on success.
 
+STBTT_DEF int  stbtt_PackBeginLcd(stbtt_pack_context *spc, unsigned char *pixels, int width, int height, int stride_in_bytes, int padding, void *alloc_context);
+// Same as stbtt_PackBegin, but the bitmap is RGB (3 bytes per pixel, so
+// stride_in_bytes defaults to width*3) and the characters are rendered for
+// LCD subpixel anti-aliasing: 3x horizontal resolution, one coverage per
+// subpixel, filtered with the FreeType LCD filter (see STBTT_BATCH_LCD_FILTER).
+// Oversampling is ignored. Each character gets 1 pixel of padding on the left
+// for shifting it by up to 1 pixel (subpixel positioning) plus 1 pixel on
+// both sides the filter can spread into. The stbtt_packedchar of a character
+// describes that padded rectangle: x0..x1 in the bitmap, and xoff is where its
+// left edge is relative to the pen position. That's usually a fraction of a
+// pixel, round it down and shift the rectangle by the rest (in subpixels)
+// when drawing. All characters of a stbtt_PackFontRanges call are rendered
+// with one stbtt_MakeGlyphBitmapBatch call.
+
 STBTT_DEF void stbtt_PackEnd  (stbtt_pack_context *spc);
 // Cleans up the packing context and frees all memory.
 
@@ -609,6 +629,11 @@ STBTT_DEF void stbtt_PackSetOversampling(stbtt_pack_context *spc, unsigned int h
 // To use with PackFontRangesGather etc., you must set it before calls
 // call to PackFontRangesGatherRects.
 
+STBTT_DEF void stbtt_PackSetSimdPrefilter(stbtt_pack_context *spc, int use_simd);
+// The box filters that go with oversampling use SSE2 when the library was
+// compiled with it (see STBTT_NO_SIMD). The output is the same either way, pass
+// use_simd=0 to use the scalar filters, e.g. to compare them. The default is 1.
+
 STBTT_DEF void stbtt_GetPackedQuad(const stbtt_packedchar *chardata, int pw, int ph,  // same data as above
                                int char_index,             // character to display
                                float *xpos, float *ypos,   // pointers to current position in screen pixel space
@@ -640,6 +665,8 @@ struct stbtt_pack_context {
    unsigned int   h_oversample, v_oversample;
    unsigned char *pixels;
    void  *nodes;
+   int   simd_prefilter;
+   int   lcd;
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -848,6 +875,12 @@ STBTT_DEF void stbtt_MakeGlyphBitmapSubpixelPrefilter(const stbtt_fontinfo *info
 STBTT_DEF void stbtt_GetGlyphBitmapBox(const stbtt_fontinfo *font, int glyph, float scale_x, float scale_y, int *ix0, int *iy0, int *ix1, int *iy1);
 STBTT_DEF void stbtt_GetGlyphBitmapBoxSubpixel(const stbtt_fontinfo *font, int glyph, float scale_x, float scale_y,float shift_x, float shift_y, int *ix0, int *iy0, int *ix1, int *iy1);
 
+// the same as above, but for a glyph box (in font units) you already got from stbtt_GetGlyphBox()
+// (all 0 for glyphs without a shape). that way a cache of glyph boxes saves looking up the glyph
+// header in the font again for every scale and every bitmap.
+STBTT_DEF void stbtt_GetBitmapBoxForGlyphBox(int x0, int y0, int x1, int y1, float scale_x, float scale_y, float shift_x, float shift_y, int *ix0, int *iy0, int *ix1, int *iy1);
+STBTT_DEF void stbtt_MakeGlyphBitmapSubpixelWithBox(const stbtt_fontinfo *info, unsigned char *output, int out_w, int out_h, int out_stride, float scale_x, float scale_y, float shift_x, float shift_y, int x0, int y0, int x1, int y1, int glyph);
+
 
 // @TODO: don't expose this structure
 typedef struct
@@ -867,6 +900,64 @@ STBTT_DEF void stbtt_Rasterize(stbtt__bitmap *result,        // 1-channel bitmap
                                int invert,                   // if non-zero, vertically flip shape
                                void *userdata);              // context for to STBTT_MALLOC
 
+// rasterizers for stbtt_RasterizeEx(). the first two are the scanline loops of rasterizer
+// version 2 (with version 1 both are the version 1 rasterizer).
+#define STBTT_RASTERIZER_DEFAULT      0  // active edges in a linked list
+#define STBTT_RASTERIZER_EDGE_ARRAYS  1  // active edges in arrays, output is bit-identical to the default
+#define STBTT_RASTERIZER_ACCUMULATE   2  // signed area accumulation buffer (like font-rs), no sorting and no
+                                         // active edges. faster for small glyphs, within 1/255 of version 2
+
+STBTT_DEF void stbtt_RasterizeEx(stbtt__bitmap *result, float flatness_in_pixels, stbtt_vertex *vertices, int num_verts, float scale_x, float scale_y, float shift_x, float shift_y, int x_off, int y_off, int invert, int rasterizer, void *userdata);
+// same as stbtt_Rasterize, but with one of the STBTT_RASTERIZER_* values above
+
+// growable storage for a shape flattened into line segments. zero-initialize it, pass it to
+// any number of stbtt_FlattenShape() calls (it only grows, so after a few glyphs there are no
+// more allocations) and release it with stbtt_FreeFlattenedShape().
+typedef struct
+{
+   float *points;            // x,y pairs
+   int num_points, points_capacity;
+   int *contour_lengths;     // number of points of each contour
+   int num_contours, contours_capacity;
+} stbtt_flattened_shape;
+
+STBTT_DEF int stbtt_FlattenShape(stbtt_flattened_shape *shape, stbtt_vertex *vertices, int num_verts, float objspace_flatness, void *userdata);
+// flattens the curves of a shape into shape->points in a single pass. unlike the recursive
+// subdivision used by stbtt_Rasterize, the number of segments of each curve is computed up-front
+// with Wang's formula, so a curve never deviates more than objspace_flatness from its segments
+// (for stbtt_Rasterize's tolerance pass flatness_in_pixels / scale). returns 0 if out of memory.
+// the rasterizers only use it with STBTT_FLATTEN_ANALYTIC, otherwise it's just there to call directly.
+
+STBTT_DEF void stbtt_RasterizeFlattened(stbtt__bitmap *result, const stbtt_flattened_shape *shape, float scale_x, float scale_y, float shift_x, float shift_y, int x_off, int y_off, int invert, void *userdata);
+// same as stbtt_Rasterize, but for a shape that was already flattened with stbtt_FlattenShape
+
+STBTT_DEF void stbtt_FreeFlattenedShape(stbtt_flattened_shape *shape, void *userdata);
+
+// one glyph for stbtt_MakeGlyphBitmapBatch(). x,y,w,h is a rectangle in the output image (in bytes,
+// so with STBTT_BATCH_LCD_FILTER that's subpixels). the glyph is rasterized like
+// stbtt_MakeGlyphBitmapSubpixel() into the part of the rectangle that starts glyph_x bytes from its
+// left edge, the rest is left as padding for the filter.
+typedef struct
+{
+   int glyph;
+   float scale_x, scale_y;
+   float shift_x, shift_y;
+   int x, y, w, h;
+   int glyph_x;
+   int has_box;   // if non-zero box is the glyph box from stbtt_GetGlyphBox() and isn't looked up again
+   int box[4];    // x0,y0,x1,y1 in font units
+} stbtt_glyph_request;
+
+#define STBTT_BATCH_GRAYSCALE   0  // write the coverage straight into the output, padding is not touched
+#define STBTT_BATCH_LCD_FILTER  1  // apply the FreeType 5-tap LCD filter {8,77,86,77,8}/255 to each row and
+                                   // write the whole rectangle (padding included)
+
+STBTT_DEF void stbtt_MakeGlyphBitmapBatch(const stbtt_fontinfo *info, unsigned char *output, int out_stride, const stbtt_glyph_request *requests, int num_requests, int flags);
+// rasterizes many glyphs into one image. the flattened shape, the edge list, the scanline buffer and
+// the active edge heap are allocated once for the whole batch instead of once per glyph, and the
+// output of each glyph is bit-identical to stbtt_MakeGlyphBitmapSubpixel() with the same parameters
+// (with STBTT_BATCH_LCD_FILTER the same as filtering that output with the kernel above).
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Signed Distance Function (or Field) rendering
@@ -1048,6 +1139,13 @@ typedef int stbtt__test_oversample_pow2[(STBTT_MAX_OVERSAMPLE & (STBTT_MAX_OVERS
 #define STBTT_RASTERIZER_VERSION 2
 #endif
 
+// the oversampling prefilters use SSE2 where it's always available (x86-64 or
+// SSE2 builds), #define STBTT_NO_SIMD to always use the scalar versions
+#if !defined(STBTT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define STBTT__SSE2
+#include <emmintrin.h>
+#endif
+
 #ifdef _MSC_VER
 #define STBTT__NOTUSED(v)  (void)(v)
 #else
@@ -2308,6 +2406,15 @@ STBTT_DEF void stbtt_FreeShape(const stbtt_fontinfo *info, stbtt_vertex *v)
 // antialiasing software rasterizer
 //
 
+static void stbtt__bitmap_box(int x0, int y0, int x1, int y1, float scale_x, float scale_y, float shift_x, float shift_y, int *ix0, int *iy0, int *ix1, int *iy1)
+{
+   // move to integral bboxes (treating pixels as little squares, what pixels get touched)?
+   if (ix0) *ix0 = STBTT_ifloor( x0 * scale_x + shift_x);
+   if (iy0) *iy0 = STBTT_ifloor(-y1 * scale_y + shift_y);
+   if (ix1) *ix1 = STBTT_iceil ( x1 * scale_x + shift_x);
+   if (iy1) *iy1 = STBTT_iceil (-y0 * scale_y + shift_y);
+}
+
 STBTT_DEF void stbtt_GetGlyphBitmapBoxSubpixel(const stbtt_fontinfo *font, int glyph, float scale_x, float scale_y,float shift_x, float shift_y, int *ix0, int *iy0, int *ix1, int *iy1)
 {
    int x0=0,y0=0,x1,y1; // =0 suppresses compiler warning
@@ -2318,11 +2425,20 @@ STBTT_DEF void stbtt_GetGlyphBitmapBoxSubpixel(const stbtt_fontinfo *font, int g
       if (ix1) *ix1 = 0;
       if (iy1) *iy1 = 0;
    } else {
-      // move to integral bboxes (treating pixels as little squares, what pixels get touched)?
-      if (ix0) *ix0 = STBTT_ifloor( x0 * scale_x + shift_x);
-      if (iy0) *iy0 = STBTT_ifloor(-y1 * scale_y + shift_y);
-      if (ix1) *ix1 = STBTT_iceil ( x1 * scale_x + shift_x);
-      if (iy1) *iy1 = STBTT_iceil (-y0 * scale_y + shift_y);
+      stbtt__bitmap_box(x0,y0,x1,y1, scale_x,scale_y, shift_x,shift_y, ix0,iy0,ix1,iy1);
+   }
+}
+
+STBTT_DEF void stbtt_GetBitmapBoxForGlyphBox(int x0, int y0, int x1, int y1, float scale_x, float scale_y, float shift_x, float shift_y, int *ix0, int *iy0, int *ix1, int *iy1)
+{
+   if (x0 == 0 && y0 == 0 && x1 == 0 && y1 == 0) {
+      // e.g. space character, like stbtt_GetGlyphBitmapBoxSubpixel() this ignores the shift
+      if (ix0) *ix0 = 0;
+      if (iy0) *iy0 = 0;
+      if (ix1) *ix1 = 0;
+      if (iy1) *iy1 = 0;
+   } else {
+      stbtt__bitmap_box(x0,y0,x1,y1, scale_x,scale_y, shift_x,shift_y, ix0,iy0,ix1,iy1);
    }
 }
 
@@ -2614,21 +2730,22 @@ static void stbtt__rasterize_sorted_edges(stbtt__bitmap *result, stbtt__edge *e,
 #elif STBTT_RASTERIZER_VERSION == 2
 
 // the edge passed in here does not cross the vertical line at x or the vertical line at x+1
-// (i.e. it has already been clipped to those)
-static void stbtt__handle_clipped_edge(float *scanline, int x, stbtt__active_edge *e, float x0, float y0, float x1, float y1)
+// (i.e. it has already been clipped to those). takes the fields of the edge it needs directly,
+// so the active edge arrays can use it without building a stbtt__active_edge
+static void stbtt__handle_clipped_edge_fields(float *scanline, int x, float direction, float sy, float ey, float x0, float y0, float x1, float y1)
 {
    if (y0 == y1) return;
    STBTT_assert(y0 < y1);
-   STBTT_assert(e->sy <= e->ey);
-   if (y0 > e->ey) return;
-   if (y1 < e->sy) return;
-   if (y0 < e->sy) {
-      x0 += (x1-x0) * (e->sy - y0) / (y1-y0);
-      y0 = e->sy;
+   STBTT_assert(sy <= ey);
+   if (y0 > ey) return;
+   if (y1 < sy) return;
+   if (y0 < sy) {
+      x0 += (x1-x0) * (sy - y0) / (y1-y0);
+      y0 = sy;
    }
-   if (y1 > e->ey) {
-      x1 += (x1-x0) * (e->ey - y1) / (y1-y0);
-      y1 = e->ey;
+   if (y1 > ey) {
+      x1 += (x1-x0) * (ey - y1) / (y1-y0);
+      y1 = ey;
    }
 
    if (x0 == x)
@@ -2643,15 +2760,20 @@ static void stbtt__handle_clipped_edge(float *scanline, int x, stbtt__active_edg
       STBTT_assert(x1 >= x && x1 <= x+1);
 
    if (x0 <= x && x1 <= x)
-      scanline[x] += e->direction * (y1-y0);
+      scanline[x] += direction * (y1-y0);
    else if (x0 >= x+1 && x1 >= x+1)
       ;
    else {
       STBTT_assert(x0 >= x && x0 <= x+1 && x1 >= x && x1 <= x+1);
-      scanline[x] += e->direction * (y1-y0) * (1-((x0-x)+(x1-x))/2); // coverage = 1 - average x position
+      scanline[x] += direction * (y1-y0) * (1-((x0-x)+(x1-x))/2); // coverage = 1 - average x position
    }
 }
 
+static void stbtt__handle_clipped_edge(float *scanline, int x, stbtt__active_edge *e, float x0, float y0, float x1, float y1)
+{
+   stbtt__handle_clipped_edge_fields(scanline, x, e->direction, e->sy, e->ey, x0, y0, x1, y1);
+}
+
 static void stbtt__fill_active_edges_new(float *scanline, float *scanline_fill, int len, stbtt__active_edge *e, float y_top)
 {
    float y_bottom = y_top+1;
@@ -2814,20 +2936,16 @@ static void stbtt__fill_active_edges_new(float *scanline, float *scanline_fill,
 }
 
 // directly AA rasterize edges w/o supersampling
-static void stbtt__rasterize_sorted_edges(stbtt__bitmap *result, stbtt__edge *e, int n, int vsubsample, int off_x, int off_y, void *userdata)
+// the heap for the active edges and the scanline buffer (result->w*2+1 floats) are passed in,
+// so stbtt_MakeGlyphBitmapBatch can reuse them for many glyphs
+static void stbtt__rasterize_sorted_edges_scratch(stbtt__bitmap *result, stbtt__edge *e, int n, int vsubsample, int off_x, int off_y, stbtt__hheap *hh, float *scanline, void *userdata)
 {
-   stbtt__hheap hh = { 0, 0, 0 };
    stbtt__active_edge *active = NULL;
    int y,j=0, i;
-   float scanline_data[129], *scanline, *scanline2;
+   float *scanline2;
 
    STBTT__NOTUSED(vsubsample);
 
-   if (result->w > 64)
-      scanline = (float *) STBTT_malloc((result->w*2+1) * sizeof(float), userdata);
-   else
-      scanline = scanline_data;
-
    scanline2 = scanline + result->w;
 
    y = off_y;
@@ -2850,7 +2968,7 @@ static void stbtt__rasterize_sorted_edges(stbtt__bitmap *result, stbtt__edge *e,
             *step = z->next; // delete from list
             STBTT_assert(z->direction);
             z->direction = 0;
-            stbtt__hheap_free(&hh, z);
+            stbtt__hheap_free(hh, z);
          } else {
             step = &((*step)->next); // advance through list
          }
@@ -2859,7 +2977,7 @@ static void stbtt__rasterize_sorted_edges(stbtt__bitmap *result, stbtt__edge *e,
       // insert all edges that start before the bottom of this scanline
       while (e->y0 <= scan_y_bottom) {
          if (e->y0 != e->y1) {
-            stbtt__active_edge *z = stbtt__new_active(&hh, e, off_x, scan_y_top, userdata);
+            stbtt__active_edge *z = stbtt__new_active(hh, e, off_x, scan_y_top, userdata);
             if (z != NULL) {
                STBTT_assert(z->ey >= scan_y_top);
                // insert at front
@@ -2899,15 +3017,369 @@ static void stbtt__rasterize_sorted_edges(stbtt__bitmap *result, stbtt__edge *e,
       ++j;
    }
 
+   // give the edges that are still active back to the heap
+   while (active) {
+      stbtt__active_edge *z = active;
+      active = active->next;
+      stbtt__hheap_free(hh, z);
+   }
+}
+
+// directly AA rasterize edges w/o supersampling
+static void stbtt__rasterize_sorted_edges(stbtt__bitmap *result, stbtt__edge *e, int n, int vsubsample, int off_x, int off_y, void *userdata)
+{
+   stbtt__hheap hh = { 0, 0, 0 };
+   float scanline_data[129], *scanline;
+
+   if (result->w > 64)
+      scanline = (float *) STBTT_malloc((result->w*2+1) * sizeof(float), userdata);
+   else
+      scanline = scanline_data;
+
+   stbtt__rasterize_sorted_edges_scratch(result, e, n, vsubsample, off_x, off_y, &hh, scanline, userdata);
+
    stbtt__hheap_cleanup(&hh, userdata);
 
    if (scanline != scanline_data)
       STBTT_free(scanline, userdata);
 }
+
+// active edges as a structure of arrays, for STBTT_RASTERIZER_EDGE_ARRAYS
+typedef struct
+{
+   float *fx, *fdx, *fdy, *direction, *sy, *ey;
+   int count, capacity;
+} stbtt__active_edge_arrays;
+
+static int stbtt__active_edge_arrays_grow(stbtt__active_edge_arrays *a, float *stack_data, void *userdata)
+{
+   int capacity = a->capacity * 2;
+   float *p = (float *) STBTT_malloc(capacity * 6 * sizeof(float), userdata);
+   if (p == NULL) return 0;
+   STBTT_memcpy(p + 0*capacity, a->fx,        a->count * sizeof(float));
+   STBTT_memcpy(p + 1*capacity, a->fdx,       a->count * sizeof(float));
+   STBTT_memcpy(p + 2*capacity, a->fdy,       a->count * sizeof(float));
+   STBTT_memcpy(p + 3*capacity, a->direction, a->count * sizeof(float));
+   STBTT_memcpy(p + 4*capacity, a->sy,        a->count * sizeof(float));
+   STBTT_memcpy(p + 5*capacity, a->ey,        a->count * sizeof(float));
+   if (a->fx != stack_data)
+      STBTT_free(a->fx, userdata);
+   a->fx = p + 0*capacity;
+   a->fdx = p + 1*capacity;
+   a->fdy = p + 2*capacity;
+   a->direction = p + 3*capacity;
+   a->sy = p + 4*capacity;
+   a->ey = p + 5*capacity;
+   a->capacity = capacity;
+   return 1;
+}
+
+// stbtt__fill_active_edges_new for the active edge arrays, newest edge first like the list. the
+// common cases (vertical edges and edges inside the bitmap) read the arrays directly, only edges
+// that leave the bitmap go through the brute force path of the list version
+static void stbtt__fill_active_edge_arrays(float *scanline, float *scanline_fill, int len, const stbtt__active_edge_arrays *a, float y_top)
+{
+   float y_bottom = y_top+1;
+   int c;
+
+   for (c=a->count-1; c >= 0; --c) {
+      float x0 = a->fx[c], dx = a->fdx[c], direction = a->direction[c], sy = a->sy[c], ey = a->ey[c];
+      STBTT_assert(ey >= y_top);
+
+      if (dx == 0) {
+         if (x0 < len) {
+            if (x0 >= 0) {
+               stbtt__handle_clipped_edge_fields(scanline,(int) x0, direction, sy, ey, x0,y_top, x0,y_bottom);
+               stbtt__handle_clipped_edge_fields(scanline_fill-1,(int) x0+1, direction, sy, ey, x0,y_top, x0,y_bottom);
+            } else {
+               stbtt__handle_clipped_edge_fields(scanline_fill-1,0, direction, sy, ey, x0,y_top, x0,y_bottom);
+            }
+         }
+      } else {
+         float xb = x0 + dx;
+         float x_top, x_bottom;
+         float sy0,sy1;
+         float dy = a->fdy[c];
+         STBTT_assert(sy <= y_bottom && ey >= y_top);
+
+         if (sy > y_top) {
+            x_top = x0 + dx * (sy - y_top);
+            sy0 = sy;
+         } else {
+            x_top = x0;
+            sy0 = y_top;
+         }
+         if (ey < y_bottom) {
+            x_bottom = x0 + dx * (ey - y_top);
+            sy1 = ey;
+         } else {
+            x_bottom = xb;
+            sy1 = y_bottom;
+         }
+
+         if (x_top >= 0 && x_bottom >= 0 && x_top < len && x_bottom < len) {
+            if ((int) x_top == (int) x_bottom) {
+               // only spans one pixel
+               int x = (int) x_top;
+               float height = sy1 - sy0;
+               scanline[x] += direction * (1-((x_top - x) + (x_bottom-x))/2)  * height;
+               scanline_fill[x] += direction * height;
+            } else {
+               int x,x1,x2;
+               float y_crossing, step, area;
+               if (x_top > x_bottom) {
+                  // flip scanline vertically; signed area is the same
+                  float t;
+                  sy0 = y_bottom - (sy0 - y_top);
+                  sy1 = y_bottom - (sy1 - y_top);
+                  t = sy0, sy0 = sy1, sy1 = t;
+                  t = x_bottom, x_bottom = x_top, x_top = t;
+                  dy = -dy;
+                  x0 = xb;
+               }
+
+               x1 = (int) x_top;
+               x2 = (int) x_bottom;
+               y_crossing = (x1+1 - x0) * dy + y_top;
+
+               area = direction * (y_crossing-sy0);
+               scanline[x1] += area * (1-((x_top - x1)+(x1+1-x1))/2);
+
+               step = direction * dy;
+               for (x = x1+1; x < x2; ++x) {
+                  scanline[x] += area + step/2;
+                  area += step;
+               }
+               y_crossing += dy * (x2 - (x1+1));
+
+               STBTT_assert(STBTT_fabs(area) <= 1.01f);
+
+               scanline[x2] += area + direction * (1-((x2-x2)+(x_bottom-x2))/2) * (sy1-y_crossing);
+
+               scanline_fill[x2] += direction * (sy1-sy0);
+            }
+         } else {
+            // rare, leave the clipping to the list version
+            stbtt__active_edge z;
+            z.next = 0;
+            z.fx = x0;
+            z.fdx = dx;
+            z.fdy = dy;
+            z.direction = direction;
+            z.sy = sy;
+            z.ey = ey;
+            stbtt__fill_active_edges_new(scanline, scanline_fill, len, &z, y_top);
+         }
+      }
+   }
+}
+
+// the same as stbtt__rasterize_sorted_edges, but without the linked list of active edges and
+// its heap. the active edges are kept in arrays that are compacted in place when edges end and
+// stepped to the next scanline in one loop without pointer chasing (which compilers vectorize).
+// new edges are appended and the arrays are walked backwards, so the edges are accumulated in the
+// same order as with the list (which inserts at the front). the output is bit-identical.
+static void stbtt__rasterize_sorted_edges_arrays(stbtt__bitmap *result, stbtt__edge *e, int n, int vsubsample, int off_x, int off_y, void *userdata)
+{
+   float edge_data[64*6];
+   stbtt__active_edge_arrays active;
+   int y,j=0, i,c;
+   float scanline_data[129], *scanline, *scanline2;
+
+   STBTT__NOTUSED(vsubsample);
+
+   active.count = 0;
+   active.capacity = 64;
+   active.fx = edge_data + 0*64;
+   active.fdx = edge_data + 1*64;
+   active.fdy = edge_data + 2*64;
+   active.direction = edge_data + 3*64;
+   active.sy = edge_data + 4*64;
+   active.ey = edge_data + 5*64;
+
+   if (result->w > 64)
+      scanline = (float *) STBTT_malloc((result->w*2+1) * sizeof(float), userdata);
+   else
+      scanline = scanline_data;
+
+   scanline2 = scanline + result->w;
+
+   y = off_y;
+   e[n].y0 = (float) (off_y + result->h) + 1;
+
+   while (j < result->h) {
+      // find center of pixel for this scanline
+      float scan_y_top    = y + 0.0f;
+      float scan_y_bottom = y + 1.0f;
+
+      STBTT_memset(scanline , 0, result->w*sizeof(scanline[0]));
+      STBTT_memset(scanline2, 0, (result->w+1)*sizeof(scanline[0]));
+
+      // remove all active edges that terminate before the top of this scanline, keep the order
+      // of the remaining ones
+      for (c=0; c < active.count && active.ey[c] > scan_y_top; ++c)
+         ; // nothing to move before the first removed edge
+      for (i=c; i < active.count; ++i) {
+         if (active.ey[i] <= scan_y_top)
+            continue;
+         active.fx[c] = active.fx[i];
+         active.fdx[c] = active.fdx[i];
+         active.fdy[c] = active.fdy[i];
+         active.direction[c] = active.direction[i];
+         active.sy[c] = active.sy[i];
+         active.ey[c] = active.ey[i];
+         ++c;
+      }
+      active.count = c;
+
+      // insert all edges that start before the bottom of this scanline, same as stbtt__new_active
+      while (e->y0 <= scan_y_bottom) {
+         if (e->y0 != e->y1 && (active.count < active.capacity || stbtt__active_edge_arrays_grow(&active, edge_data, userdata))) {
+            float dxdy = (e->x1 - e->x0) / (e->y1 - e->y0);
+            c = active.count++;
+            active.fdx[c] = dxdy;
+            active.fdy[c] = dxdy != 0.0f ? (1.0f/dxdy) : 0.0f;
+            active.fx[c] = e->x0 + dxdy * (scan_y_top - e->y0);
+            active.fx[c] -= off_x;
+            active.direction[c] = e->invert ? 1.0f : -1.0f;
+            active.sy[c] = e->y0;
+            active.ey[c] = e->y1;
+            STBTT_assert(active.ey[c] >= scan_y_top);
+         }
+         ++e;
+      }
+
+      // now process all active edges
+      stbtt__fill_active_edge_arrays(scanline, scanline2+1, result->w, &active, scan_y_top);
+
+      {
+         float sum = 0;
+         for (i=0; i < result->w; ++i) {
+            float k;
+            int m;
+            sum += scanline2[i];
+            k = scanline[i] + sum;
+            k = (float) STBTT_fabs(k)*255 + 0.5f;
+            m = (int) k;
+            if (m > 255) m = 255;
+            result->pixels[j*result->stride + i] = (unsigned char) m;
+         }
+      }
+      // advance all the edges
+      for (c=0; c < active.count; ++c)
+         active.fx[c] += active.fdx[c];
+
+      ++y;
+      ++j;
+   }
+
+   if (active.fx != edge_data)
+      STBTT_free(active.fx, userdata);
+   if (scanline != scanline_data)
+      STBTT_free(scanline, userdata);
+}
 #else
 #error "Unrecognized value of STBTT_RASTERIZER_VERSION"
 #endif
 
+// rasterizes the edges by drawing each one as signed area deltas into a float buffer with one
+// entry per pixel (plus two columns for edges on the right border). a prefix sum over each row
+// then turns the deltas into coverage. the same approach as font-rs by Raph Levien. works with
+// both rasterizer versions, the edges are always one sample per pixel row.
+static void stbtt__rasterize_edges_accumulate(stbtt__bitmap *result, stbtt__edge *e, int n, int vsubsample, int off_x, int off_y, void *userdata)
+{
+   int w = result->w, h = result->h, stride = w+2, i, y;
+   float acc_data[32*34], *acc;
+   float vscale = 1.0f / vsubsample;
+
+   if (stride*h > 32*34) {
+      acc = (float *) STBTT_malloc(stride*h * sizeof(float), userdata);
+      if (acc == NULL) return;
+   } else {
+      acc = acc_data;
+   }
+   STBTT_memset(acc, 0, stride*h * sizeof(float));
+
+   for (i=0; i < n; ++i) {
+      // edges always go downwards (y0 < y1), invert tells the original direction
+      float x0 = e[i].x0 - off_x, y0 = e[i].y0 * vscale - off_y;
+      float x1 = e[i].x1 - off_x, y1 = e[i].y1 * vscale - off_y;
+      float dir = e[i].invert ? 1.0f : -1.0f;
+      float dxdy, x;
+      int ystart, yend;
+      if (y0 == y1) continue;
+      // the glyph box should contain the whole outline, but clamp anything outside of it to the
+      // left and right border so we stay inside the buffer
+      if (x0 < 0) x0 = 0;
+      if (x0 > w) x0 = (float) w;
+      if (x1 < 0) x1 = 0;
+      if (x1 > w) x1 = (float) w;
+      dxdy = (x1 - x0) / (y1 - y0);
+      x = x0;
+      ystart = (int) y0;
+      if (y0 < 0) {
+         x -= y0 * dxdy;
+         ystart = 0;
+      }
+      yend = STBTT_iceil(y1);
+      if (yend > h) yend = h;
+
+      for (y=ystart; y < yend; ++y) {
+         float *row = acc + y*stride;
+         float dy = (y+1 < y1 ? y+1 : y1) - (y > y0 ? y : y0);
+         float xnext = x + dxdy * dy;
+         float d = dy * dir;
+         float xa = x < xnext ? x : xnext, xb = x < xnext ? xnext : x;
+         float xa_floor = (float) STBTT_ifloor(xa), xb_ceil = (float) STBTT_iceil(xb);
+         int xa_i = (int) xa_floor, xb_i = (int) xb_ceil;
+         if (xb_i <= xa_i + 1) {
+            // the line stays within one pixel, split d by the average x position
+            float xmf = 0.5f * (x + xnext) - xa_floor;
+            row[xa_i]   += d - d * xmf;
+            row[xa_i+1] += d * xmf;
+         } else {
+            // the line crosses several pixels, distribute d by the area of each pixel left of it
+            float slope = 1.0f / (xb - xa);
+            float xa_f = xa - xa_floor;
+            float a0 = 0.5f * slope * (1 - xa_f) * (1 - xa_f);
+            float xb_f = xb - xb_ceil + 1;
+            float am = 0.5f * slope * xb_f * xb_f;
+            row[xa_i] += d * a0;
+            if (xb_i == xa_i + 2) {
+               row[xa_i+1] += d * (1 - a0 - am);
+            } else {
+               float a1 = slope * (1.5f - xa_f), a2;
+               int xi;
+               row[xa_i+1] += d * (a1 - a0);
+               for (xi=xa_i+2; xi < xb_i-1; ++xi)
+                  row[xi] += d * slope;
+               a2 = a1 + (xb_i - xa_i - 3) * slope;
+               row[xb_i-1] += d * (1 - a2 - am);
+            }
+            row[xb_i] += d * am;
+         }
+         x = xnext;
+      }
+   }
+
+   // accumulate the deltas of each row into coverage, with the same rounding as version 2
+   for (y=0; y < h; ++y) {
+      float *row = acc + y*stride, sum = 0;
+      for (i=0; i < w; ++i) {
+         float k;
+         int m;
+         sum += row[i];
+         k = (float) STBTT_fabs(sum)*255 + 0.5f;
+         m = (int) k;
+         if (m > 255) m = 255;
+         result->pixels[y*result->stride + i] = (unsigned char) m;
+      }
+   }
+
+   if (acc != acc_data)
+      STBTT_free(acc, userdata);
+}
+
 #define STBTT__COMPARE(a,b)  ((a)->y0 < (b)->y0)
 
 static void stbtt__sort_edges_ins_sort(stbtt__edge *p, int n)
@@ -3001,30 +3473,12 @@ typedef struct
    float x,y;
 } stbtt__point;
 
-static void stbtt__rasterize(stbtt__bitmap *result, stbtt__point *pts, int *wcount, int windings, float scale_x, float scale_y, float shift_x, float shift_y, int off_x, int off_y, int invert, void *userdata)
+// blows out the windings into explicit edge lists. e needs room for one edge per point plus
+// one more as a sentinel. returns the number of edges.
+static int stbtt__build_edges(stbtt__edge *e, stbtt__point *pts, int *wcount, int windings, float scale_x, float scale_y, float shift_x, float shift_y, int invert, int vsubsample)
 {
    float y_scale_inv = invert ? -scale_y : scale_y;
-   stbtt__edge *e;
-   int n,i,j,k,m;
-#if STBTT_RASTERIZER_VERSION == 1
-   int vsubsample = result->h < 8 ? 15 : 5;
-#elif STBTT_RASTERIZER_VERSION == 2
-   int vsubsample = 1;
-#else
-   #error "Unrecognized value of STBTT_RASTERIZER_VERSION"
-#endif
-   // vsubsample should divide 255 evenly; otherwise we won't reach full opacity
-
-   // now we have to blow out the windings into explicit edge lists
-   n = 0;
-   for (i=0; i < windings; ++i)
-      n += wcount[i];
-
-   e = (stbtt__edge *) STBTT_malloc(sizeof(*e) * (n+1), userdata); // add an extra one as a sentinel
-   if (e == 0) return;
-   n = 0;
-
-   m=0;
+   int n=0,i,j,k,m=0;
    for (i=0; i < windings; ++i) {
       stbtt__point *p = pts + m;
       m += wcount[i];
@@ -3047,12 +3501,48 @@ static void stbtt__rasterize(stbtt__bitmap *result, stbtt__point *pts, int *wcou
          ++n;
       }
    }
+   return n;
+}
+
+static void stbtt__rasterize(stbtt__bitmap *result, stbtt__point *pts, int *wcount, int windings, float scale_x, float scale_y, float shift_x, float shift_y, int off_x, int off_y, int invert, int rasterizer, void *userdata)
+{
+   stbtt__edge *e;
+   int n,i;
+#if STBTT_RASTERIZER_VERSION == 1
+   int vsubsample = result->h < 8 ? 15 : 5;
+#elif STBTT_RASTERIZER_VERSION == 2
+   int vsubsample = 1;
+#else
+   #error "Unrecognized value of STBTT_RASTERIZER_VERSION"
+#endif
+   // vsubsample should divide 255 evenly; otherwise we won't reach full opacity
+
+   // now we have to blow out the windings into explicit edge lists
+   n = 0;
+   for (i=0; i < windings; ++i)
+      n += wcount[i];
+
+   e = (stbtt__edge *) STBTT_malloc(sizeof(*e) * (n+1), userdata); // add an extra one as a sentinel
+   if (e == 0) return;
+   n = stbtt__build_edges(e, pts, wcount, windings, scale_x, scale_y, shift_x, shift_y, invert, vsubsample);
+
+   // the accumulation buffer doesn't care about the order of the edges
+   if (rasterizer == STBTT_RASTERIZER_ACCUMULATE) {
+      stbtt__rasterize_edges_accumulate(result, e, n, vsubsample, off_x, off_y, userdata);
+      STBTT_free(e, userdata);
+      return;
+   }
 
    // now sort the edges by their highest point (should snap to integer, and then by x)
    //STBTT_sort(e, n, sizeof(e[0]), stbtt__edge_compare);
    stbtt__sort_edges(e, n);
 
    // now, traverse the scanlines and find the intersections on each scanline, use xor winding rule
+#if STBTT_RASTERIZER_VERSION == 2
+   if (rasterizer == STBTT_RASTERIZER_EDGE_ARRAYS)
+      stbtt__rasterize_sorted_edges_arrays(result, e, n, vsubsample, off_x, off_y, userdata);
+   else
+#endif
    stbtt__rasterize_sorted_edges(result, e, n, vsubsample, off_x, off_y, userdata);
 
    STBTT_free(e, userdata);
@@ -3128,45 +3618,68 @@ static void stbtt__tesselate_cubic(stbtt__point *points, int *num_points, float
    }
 }
 
-// returns number of contours
-static stbtt__point *stbtt_FlattenCurves(stbtt_vertex *vertices, int num_verts, float objspace_flatness, int **contour_lengths, int *num_contours, void *userdata)
+// makes room for more points and contours, only ever grows the buffers
+static int stbtt__flattened_shape_reserve(stbtt_flattened_shape *shape, int points, int contours, void *userdata)
+{
+   if (shape->num_points + points > shape->points_capacity) {
+      int capacity = shape->points_capacity ? shape->points_capacity * 2 : 256;
+      float *p;
+      while (capacity < shape->num_points + points)
+         capacity *= 2;
+      p = (float *) STBTT_malloc(capacity * 2 * sizeof(float), userdata);
+      if (p == NULL) return 0;
+      if (shape->num_points) STBTT_memcpy(p, shape->points, shape->num_points * 2 * sizeof(float));
+      STBTT_free(shape->points, userdata);
+      shape->points = p;
+      shape->points_capacity = capacity;
+   }
+   if (shape->num_contours + contours > shape->contours_capacity) {
+      int capacity = shape->contours_capacity ? shape->contours_capacity * 2 : 16;
+      int *c;
+      while (capacity < shape->num_contours + contours)
+         capacity *= 2;
+      c = (int *) STBTT_malloc(capacity * sizeof(int), userdata);
+      if (c == NULL) return 0;
+      if (shape->num_contours) STBTT_memcpy(c, shape->contour_lengths, shape->num_contours * sizeof(int));
+      STBTT_free(shape->contour_lengths, userdata);
+      shape->contour_lengths = c;
+      shape->contours_capacity = capacity;
+   }
+   return 1;
+}
+
+// the two pass recursive subdivision into a reusable stbtt_flattened_shape. stbtt_FlattenCurves() wraps
+// it, so stbtt_MakeGlyphBitmapBatch() gets exactly the same points as stbtt_Rasterize() (unless both
+// use stbtt_FlattenShape() with STBTT_FLATTEN_ANALYTIC)
+static int stbtt__flatten_curves_into(stbtt_flattened_shape *shape, stbtt_vertex *vertices, int num_verts, float objspace_flatness, void *userdata)
 {
    stbtt__point *points=0;
-   int num_points=0;
+   int num_points=0, num_contours=0;
 
    float objspace_flatness_squared = objspace_flatness * objspace_flatness;
-   int i,n=0,start=0, pass;
+   int i,n,start=0, pass;
 
-   // count how many "moves" there are to get the contour count
+   shape->num_points = 0;
+   shape->num_contours = 0;
    for (i=0; i < num_verts; ++i)
       if (vertices[i].type == STBTT_vmove)
-         ++n;
-
-   *num_contours = n;
-   if (n == 0) return 0;
-
-   *contour_lengths = (int *) STBTT_malloc(sizeof(**contour_lengths) * n, userdata);
-
-   if (*contour_lengths == 0) {
-      *num_contours = 0;
-      return 0;
-   }
+         ++num_contours;
+   if (num_contours == 0) return 1;
+   if (!stbtt__flattened_shape_reserve(shape, 0, num_contours, userdata)) return 0;
 
-   // make two passes through the points so we don't need to realloc
    for (pass=0; pass < 2; ++pass) {
       float x=0,y=0;
       if (pass == 1) {
-         points = (stbtt__point *) STBTT_malloc(num_points * sizeof(points[0]), userdata);
-         if (points == NULL) goto error;
+         if (!stbtt__flattened_shape_reserve(shape, num_points, 0, userdata)) return 0;
+         points = (stbtt__point *) shape->points;
       }
       num_points = 0;
       n= -1;
       for (i=0; i < num_verts; ++i) {
          switch (vertices[i].type) {
             case STBTT_vmove:
-               // start the next contour
                if (n >= 0)
-                  (*contour_lengths)[n] = num_points - start;
+                  shape->contour_lengths[n] = num_points - start;
                ++n;
                start = num_points;
 
@@ -3194,28 +3707,259 @@ static stbtt__point *stbtt_FlattenCurves(stbtt_vertex *vertices, int num_verts,
                break;
          }
       }
-      (*contour_lengths)[n] = num_points - start;
+      shape->contour_lengths[n] = num_points - start;
    }
 
-   return points;
-error:
-   STBTT_free(points, userdata);
-   STBTT_free(*contour_lengths, userdata);
-   *contour_lengths = 0;
-   *num_contours = 0;
-   return NULL;
+   shape->num_points = num_points;
+   shape->num_contours = num_contours;
+   return 1;
 }
 
-STBTT_DEF void stbtt_Rasterize(stbtt__bitmap *result, float flatness_in_pixels, stbtt_vertex *vertices, int num_verts, float scale_x, float scale_y, float shift_x, float shift_y, int x_off, int y_off, int invert, void *userdata)
+// returns number of contours
+static stbtt__point *stbtt_FlattenCurves(stbtt_vertex *vertices, int num_verts, float objspace_flatness, int **contour_lengths, int *num_contours, void *userdata)
+{
+   stbtt_flattened_shape shape = { 0 };
+   if (!stbtt__flatten_curves_into(&shape, vertices, num_verts, objspace_flatness, userdata) || shape.num_contours == 0) {
+      STBTT_free(shape.points, userdata);
+      STBTT_free(shape.contour_lengths, userdata);
+      *contour_lengths = 0;
+      *num_contours = 0;
+      return NULL;
+   }
+   *contour_lengths = shape.contour_lengths;
+   *num_contours = shape.num_contours;
+   return (stbtt__point *) shape.points;
+}
+
+// Wang's formula: a bezier of degree d split into n uniform segments deviates at most
+// d*(d-1)/8 * max|second difference of the control points| / n^2 from them. solve for n.
+static int stbtt__wang_segments(float d_times_d_minus_1_over_8, float max_second_difference, float objspace_flatness)
+{
+   float n = (float) STBTT_sqrt(d_times_d_minus_1_over_8 * max_second_difference / objspace_flatness);
+   if (n <= 1) return 1;
+   if (n >= 65536) return 65536; // same limit as the recursive subdivision
+   return STBTT_iceil(n);
+}
+
+STBTT_DEF int stbtt_FlattenShape(stbtt_flattened_shape *shape, stbtt_vertex *vertices, int num_verts, float objspace_flatness, void *userdata)
+{
+   float x=0,y=0;
+   int i, start=0;
+
+   shape->num_points = 0;
+   shape->num_contours = 0;
+   for (i=0; i < num_verts; ++i) {
+      stbtt_vertex *v = &vertices[i];
+      switch (v->type) {
+         case STBTT_vmove:
+            // start the next contour
+            if (!stbtt__flattened_shape_reserve(shape, 1, 1, userdata)) return 0;
+            if (shape->num_contours > 0)
+               shape->contour_lengths[shape->num_contours-1] = shape->num_points - start;
+            shape->num_contours++;
+            start = shape->num_points;
+            // fallthrough
+         case STBTT_vline:
+            if (!stbtt__flattened_shape_reserve(shape, 1, 0, userdata)) return 0;
+            x = v->x, y = v->y;
+            shape->points[shape->num_points*2+0] = x;
+            shape->points[shape->num_points*2+1] = y;
+            shape->num_points++;
+            break;
+         case STBTT_vcurve: {
+            float ddx = x - 2*v->cx + v->x, ddy = y - 2*v->cy + v->y;
+            int n = stbtt__wang_segments(2.0f/8, (float) STBTT_sqrt(ddx*ddx + ddy*ddy), objspace_flatness), j;
+            float *p;
+            if (!stbtt__flattened_shape_reserve(shape, n, 0, userdata)) return 0;
+            p = shape->points + shape->num_points*2;
+            for (j=1; j < n; ++j) {
+               float t = (float) j / n, mt = 1-t;
+               *p++ = mt*mt*x + 2*mt*t*v->cx + t*t*v->x;
+               *p++ = mt*mt*y + 2*mt*t*v->cy + t*t*v->y;
+            }
+            x = v->x, y = v->y;
+            *p++ = x;
+            *p++ = y;
+            shape->num_points += n;
+            break;
+         }
+         case STBTT_vcubic: {
+            float ddx0 = x - 2*v->cx + v->cx1, ddy0 = y - 2*v->cy + v->cy1;
+            float ddx1 = v->cx - 2*v->cx1 + v->x, ddy1 = v->cy - 2*v->cy1 + v->y;
+            float dd0 = ddx0*ddx0 + ddy0*ddy0, dd1 = ddx1*ddx1 + ddy1*ddy1;
+            int n = stbtt__wang_segments(6.0f/8, (float) STBTT_sqrt(dd0 > dd1 ? dd0 : dd1), objspace_flatness), j;
+            float *p;
+            if (!stbtt__flattened_shape_reserve(shape, n, 0, userdata)) return 0;
+            p = shape->points + shape->num_points*2;
+            for (j=1; j < n; ++j) {
+               float t = (float) j / n, mt = 1-t;
+               float a = mt*mt*mt, b = 3*mt*mt*t, c = 3*mt*t*t, d = t*t*t;
+               *p++ = a*x + b*v->cx + c*v->cx1 + d*v->x;
+               *p++ = a*y + b*v->cy + c*v->cy1 + d*v->y;
+            }
+            x = v->x, y = v->y;
+            *p++ = x;
+            *p++ = y;
+            shape->num_points += n;
+            break;
+         }
+      }
+   }
+   if (shape->num_contours > 0)
+      shape->contour_lengths[shape->num_contours-1] = shape->num_points - start;
+   return 1;
+}
+
+STBTT_DEF void stbtt_RasterizeFlattened(stbtt__bitmap *result, const stbtt_flattened_shape *shape, float scale_x, float scale_y, float shift_x, float shift_y, int x_off, int y_off, int invert, void *userdata)
+{
+   if (shape->num_contours > 0)
+      stbtt__rasterize(result, (stbtt__point *) shape->points, shape->contour_lengths, shape->num_contours, scale_x, scale_y, shift_x, shift_y, x_off, y_off, invert, STBTT_RASTERIZER_DEFAULT, userdata);
+}
+
+STBTT_DEF void stbtt_FreeFlattenedShape(stbtt_flattened_shape *shape, void *userdata)
+{
+   STBTT_free(shape->points, userdata);
+   STBTT_free(shape->contour_lengths, userdata);
+   shape->points = NULL;
+   shape->contour_lengths = NULL;
+   shape->num_points = shape->points_capacity = 0;
+   shape->num_contours = shape->contours_capacity = 0;
+}
+
+STBTT_DEF void stbtt_RasterizeEx(stbtt__bitmap *result, float flatness_in_pixels, stbtt_vertex *vertices, int num_verts, float scale_x, float scale_y, float shift_x, float shift_y, int x_off, int y_off, int invert, int rasterizer, void *userdata)
 {
    float scale = scale_x > scale_y ? scale_y : scale_x;
+#ifdef STBTT_FLATTEN_ANALYTIC
+   stbtt_flattened_shape shape = { 0 };
+   if (stbtt_FlattenShape(&shape, vertices, num_verts, flatness_in_pixels / scale, userdata) && shape.num_contours > 0)
+      stbtt__rasterize(result, (stbtt__point *) shape.points, shape.contour_lengths, shape.num_contours, scale_x, scale_y, shift_x, shift_y, x_off, y_off, invert, rasterizer, userdata);
+   stbtt_FreeFlattenedShape(&shape, userdata);
+#else
    int winding_count, *winding_lengths;
    stbtt__point *windings = stbtt_FlattenCurves(vertices, num_verts, flatness_in_pixels / scale, &winding_lengths, &winding_count, userdata);
    if (windings) {
-      stbtt__rasterize(result, windings, winding_lengths, winding_count, scale_x, scale_y, shift_x, shift_y, x_off, y_off, invert, userdata);
+      stbtt__rasterize(result, windings, winding_lengths, winding_count, scale_x, scale_y, shift_x, shift_y, x_off, y_off, invert, rasterizer, userdata);
       STBTT_free(winding_lengths, userdata);
       STBTT_free(windings, userdata);
    }
+#endif
+}
+
+STBTT_DEF void stbtt_Rasterize(stbtt__bitmap *result, float flatness_in_pixels, stbtt_vertex *vertices, int num_verts, float scale_x, float scale_y, float shift_x, float shift_y, int x_off, int y_off, int invert, void *userdata)
+{
+   stbtt_RasterizeEx(result, flatness_in_pixels, vertices, num_verts, scale_x, scale_y, shift_x, shift_y, x_off, y_off, invert, STBTT_RASTERIZER_DEFAULT, userdata);
+}
+
+STBTT_DEF void stbtt_MakeGlyphBitmapBatch(const stbtt_fontinfo *info, unsigned char *output, int out_stride, const stbtt_glyph_request *requests, int num_requests, int flags)
+{
+   static const unsigned char lcd_filter[5] = { 0x08, 0x4D, 0x56, 0x4D, 0x08 };
+   void *userdata = info->userdata;
+   stbtt_flattened_shape shape = { 0 };
+   unsigned char *coverage = NULL;
+   int coverage_capacity = 0;
+#if STBTT_RASTERIZER_VERSION == 2
+   stbtt__hheap hh = { 0, 0, 0 };
+   stbtt__edge *e = NULL;
+   float *scanline = NULL;
+   int e_capacity = 0, scanline_capacity = 0;
+#endif
+   int r;
+
+   for (r=0; r < num_requests; ++r) {
+      const stbtt_glyph_request *q = &requests[r];
+      unsigned char *out = output + q->y*out_stride + q->x;
+      float scale = q->scale_x > q->scale_y ? q->scale_y : q->scale_x;
+      int ix0,iy0,num_verts,x,y;
+      stbtt_vertex *vertices;
+      stbtt__bitmap gbm;
+
+      if (q->w <= 0 || q->h <= 0) continue;
+
+      gbm.w = q->w - q->glyph_x;
+      gbm.h = q->h;
+      if (flags & STBTT_BATCH_LCD_FILTER) {
+         // rasterize into a cleared coverage buffer, the filter then reads from there
+         if (q->w * q->h > coverage_capacity) {
+            STBTT_free(coverage, userdata);
+            coverage_capacity = q->w * q->h * 2;
+            coverage = (unsigned char *) STBTT_malloc(coverage_capacity, userdata);
+            if (coverage == NULL) goto error;
+         }
+         STBTT_memset(coverage, 0, q->w * q->h);
+         gbm.pixels = coverage + q->glyph_x;
+         gbm.stride = q->w;
+      } else {
+         gbm.pixels = out + q->glyph_x;
+         gbm.stride = out_stride;
+      }
+
+      num_verts = stbtt_GetGlyphShape(info, q->glyph, &vertices);
+      if (q->has_box)
+         stbtt_GetBitmapBoxForGlyphBox(q->box[0], q->box[1], q->box[2], q->box[3], q->scale_x, q->scale_y, q->shift_x, q->shift_y, &ix0,&iy0,0,0);
+      else
+         stbtt_GetGlyphBitmapBoxSubpixel(info, q->glyph, q->scale_x, q->scale_y, q->shift_x, q->shift_y, &ix0,&iy0,0,0);
+      if (gbm.w > 0 && num_verts > 0) {
+#ifdef STBTT_FLATTEN_ANALYTIC
+         if (!stbtt_FlattenShape(&shape, vertices, num_verts, 0.35f / scale, userdata)) {
+#else
+         if (!stbtt__flatten_curves_into(&shape, vertices, num_verts, 0.35f / scale, userdata)) {
+#endif
+            STBTT_free(vertices, userdata);
+            goto error;
+         }
+      } else {
+         shape.num_contours = 0;
+      }
+      STBTT_free(vertices, userdata);
+
+      if (shape.num_contours > 0) {
+#if STBTT_RASTERIZER_VERSION == 2
+         // same steps as stbtt__rasterize(), just with the buffers of the batch
+         int n;
+         if (shape.num_points + 1 > e_capacity) {
+            STBTT_free(e, userdata);
+            e_capacity = (shape.num_points + 1) * 2;
+            e = (stbtt__edge *) STBTT_malloc(e_capacity * sizeof(*e), userdata);
+            if (e == NULL) goto error;
+         }
+         if (gbm.w*2+1 > scanline_capacity) {
+            STBTT_free(scanline, userdata);
+            scanline_capacity = gbm.w*2+1;
+            scanline = (float *) STBTT_malloc(scanline_capacity * sizeof(float), userdata);
+            if (scanline == NULL) goto error;
+         }
+         n = stbtt__build_edges(e, (stbtt__point *) shape.points, shape.contour_lengths, shape.num_contours, q->scale_x, q->scale_y, q->shift_x, q->shift_y, 1, 1);
+         stbtt__sort_edges(e, n);
+         stbtt__rasterize_sorted_edges_scratch(&gbm, e, n, 1, ix0, iy0, &hh, scanline, userdata);
+#else
+         stbtt__rasterize(&gbm, (stbtt__point *) shape.points, shape.contour_lengths, shape.num_contours, q->scale_x, q->scale_y, q->shift_x, q->shift_y, ix0, iy0, 1, STBTT_RASTERIZER_DEFAULT, userdata);
+#endif
+      }
+
+      if (flags & STBTT_BATCH_LCD_FILTER) {
+         // samples outside of the rectangle count as 0
+         for (y=0; y < q->h; ++y) {
+            unsigned char *src = coverage + y*q->w, *dst = out + y*out_stride;
+            for (x=0; x < q->w; ++x) {
+               int k, sum = 0;
+               for (k=-2; k <= 2; ++k)
+                  if (x+k >= 0 && x+k < q->w)
+                     sum += src[x+k] * lcd_filter[k+2];
+               sum /= 255;
+               dst[x] = (unsigned char) (sum > 255 ? 255 : sum);
+            }
+         }
+      }
+   }
+
+error:
+   STBTT_free(coverage, userdata);
+   stbtt_FreeFlattenedShape(&shape, userdata);
+#if STBTT_RASTERIZER_VERSION == 2
+   STBTT_free(e, userdata);
+   STBTT_free(scanline, userdata);
+   stbtt__hheap_cleanup(&hh, userdata);
+#endif
 }
 
 STBTT_DEF void stbtt_FreeBitmap(unsigned char *bitmap, void *userdata)
@@ -3269,13 +4013,20 @@ STBTT_DEF unsigned char *stbtt_GetGlyphBitmap(const stbtt_fontinfo *info, float
 }
 
 STBTT_DEF void stbtt_MakeGlyphBitmapSubpixel(const stbtt_fontinfo *info, unsigned char *output, int out_w, int out_h, int out_stride, float scale_x, float scale_y, float shift_x, float shift_y, int glyph)
+{
+   int x0=0,y0=0,x1=0,y1=0;
+   stbtt_GetGlyphBox(info, glyph, &x0,&y0,&x1,&y1);
+   stbtt_MakeGlyphBitmapSubpixelWithBox(info, output, out_w, out_h, out_stride, scale_x, scale_y, shift_x, shift_y, x0,y0,x1,y1, glyph);
+}
+
+STBTT_DEF void stbtt_MakeGlyphBitmapSubpixelWithBox(const stbtt_fontinfo *info, unsigned char *output, int out_w, int out_h, int out_stride, float scale_x, float scale_y, float shift_x, float shift_y, int x0, int y0, int x1, int y1, int glyph)
 {
    int ix0,iy0;
    stbtt_vertex *vertices;
    int num_verts = stbtt_GetGlyphShape(info, glyph, &vertices);
    stbtt__bitmap gbm;   
 
-   stbtt_GetGlyphBitmapBoxSubpixel(info, glyph, scale_x, scale_y, shift_x, shift_y, &ix0,&iy0,0,0);
+   stbtt_GetBitmapBoxForGlyphBox(x0,y0,x1,y1, scale_x, scale_y, shift_x, shift_y, &ix0,&iy0,0,0);
    gbm.pixels = output;
    gbm.w = out_w;
    gbm.h = out_h;
@@ -3484,6 +4235,8 @@ STBTT_DEF int stbtt_PackBegin(stbtt_pack_context *spc, unsigned char *pixels, in
    spc->stride_in_bytes = stride_in_bytes != 0 ? stride_in_bytes : pw;
    spc->h_oversample = 1;
    spc->v_oversample = 1;
+   spc->simd_prefilter = 1;
+   spc->lcd = 0;
 
    stbrp_init_target(context, pw-padding, ph-padding, nodes, num_nodes);
 
@@ -3493,6 +4246,21 @@ STBTT_DEF int stbtt_PackBegin(stbtt_pack_context *spc, unsigned char *pixels, in
    return 1;
 }
 
+STBTT_DEF int stbtt_PackBeginLcd(stbtt_pack_context *spc, unsigned char *pixels, int pw, int ph, int stride_in_bytes, int padding, void *alloc_context)
+{
+   if (!stbtt_PackBegin(spc, NULL, pw, ph, stride_in_bytes, padding, alloc_context))
+      return 0;
+
+   spc->pixels = pixels;
+   spc->stride_in_bytes = stride_in_bytes != 0 ? stride_in_bytes : pw*3;
+   spc->lcd = 1;
+
+   if (pixels)
+      STBTT_memset(pixels, 0, spc->stride_in_bytes*ph); // background of 0 around pixels
+
+   return 1;
+}
+
 STBTT_DEF void stbtt_PackEnd  (stbtt_pack_context *spc)
 {
    STBTT_free(spc->nodes    , spc->user_allocator_context);
@@ -3509,9 +4277,91 @@ STBTT_DEF void stbtt_PackSetOversampling(stbtt_pack_context *spc, unsigned int h
       spc->v_oversample = v_oversample;
 }
 
+STBTT_DEF void stbtt_PackSetSimdPrefilter(stbtt_pack_context *spc, int use_simd)
+{
+   spc->simd_prefilter = use_simd;
+}
+
 #define STBTT__OVER_MASK  (STBTT_MAX_OVERSAMPLE-1)
 
-static void stbtt__h_prefilter(unsigned char *pixels, int w, int h, int stride_in_bytes, unsigned int kernel_width)
+// LCD mode: 1 pixel for subpixel positioning and 1 pixel for the filter on the left, 1 pixel for the filter on the right
+#define STBTT__LCD_LEFT_PADDING  2
+#define STBTT__LCD_PADDING       3
+
+#ifdef STBTT__SSE2
+// both prefilters compute out[i] = (in[i-kernel_width+1] + ... + in[i]) / kernel_width
+// (with in[] = 0 before the first pixel), same as the scalar versions below. the sums
+// of up to 8 pixels fit in 16 bits and the divide is a multiply by the rounded up
+// reciprocal, (t * ceil(65536/k)) >> 16 == t/k for all t <= 8*255 and k = 2..8.
+
+// blocks of 16 pixels go from right to left through each row, so a block still reads
+// the original pixels left of it and the filter can work in place. the first few
+// pixels of the row (less than one block plus the kernel) use the scalar ring buffer.
+static void stbtt__h_prefilter_sse2(unsigned char *pixels, int w, int h, int stride_in_bytes, unsigned int kernel_width)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i reciprocal = _mm_set1_epi16((short) ((65536 + kernel_width-1) / kernel_width));
+   int kw = (int) kernel_width;
+   int j;
+   for (j=0; j < h; ++j) {
+      unsigned char buffer[STBTT_MAX_OVERSAMPLE];
+      unsigned int total = 0;
+      int i, k;
+      for (i=w-16; i >= kw-1; i -= 16) {
+         __m128i lo = zero, hi = zero;
+         for (k=0; k < kw; ++k) {
+            __m128i p = _mm_loadu_si128((const __m128i *) (pixels + i - k));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(p, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(p, zero));
+         }
+         lo = _mm_mulhi_epu16(lo, reciprocal);
+         hi = _mm_mulhi_epu16(hi, reciprocal);
+         _mm_storeu_si128((__m128i *) (pixels + i), _mm_packus_epi16(lo, hi));
+      }
+
+      STBTT_memset(buffer, 0, kernel_width);
+      for (k=0; k < i+16; ++k) {
+         total += pixels[k] - buffer[k & STBTT__OVER_MASK];
+         buffer[(k+kernel_width) & STBTT__OVER_MASK] = pixels[k];
+         pixels[k] = (unsigned char) (total / kernel_width);
+      }
+
+      pixels += stride_in_bytes;
+   }
+}
+
+// row parallel: the rows go from bottom to top, so the kernel_width rows a row sums up
+// are still the original ones. columns left over at the right edge use the scalar filter.
+static void stbtt__v_prefilter_scalar(unsigned char *pixels, int w, int h, int stride_in_bytes, unsigned int kernel_width);
+static void stbtt__v_prefilter_sse2(unsigned char *pixels, int w, int h, int stride_in_bytes, unsigned int kernel_width)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i reciprocal = _mm_set1_epi16((short) ((65536 + kernel_width-1) / kernel_width));
+   int kw = (int) kernel_width;
+   int w16 = w & ~15;
+   int i;
+   for (i=h-1; i >= 0; --i) {
+      unsigned char *row = pixels + i*stride_in_bytes;
+      int rows = i+1 < kw ? i+1 : kw;
+      int x, k;
+      for (x=0; x < w16; x += 16) {
+         __m128i lo = zero, hi = zero;
+         for (k=0; k < rows; ++k) {
+            __m128i p = _mm_loadu_si128((const __m128i *) (row - k*stride_in_bytes + x));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(p, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(p, zero));
+         }
+         lo = _mm_mulhi_epu16(lo, reciprocal);
+         hi = _mm_mulhi_epu16(hi, reciprocal);
+         _mm_storeu_si128((__m128i *) (row + x), _mm_packus_epi16(lo, hi));
+      }
+   }
+   if (w16 < w)
+      stbtt__v_prefilter_scalar(pixels + w16, w - w16, h, stride_in_bytes, kernel_width);
+}
+#endif
+
+static void stbtt__h_prefilter_scalar(unsigned char *pixels, int w, int h, int stride_in_bytes, unsigned int kernel_width)
 {
    unsigned char buffer[STBTT_MAX_OVERSAMPLE];
    int safe_w = w - kernel_width;
@@ -3573,7 +4423,7 @@ static void stbtt__h_prefilter(unsigned char *pixels, int w, int h, int stride_i
    }
 }
 
-static void stbtt__v_prefilter(unsigned char *pixels, int w, int h, int stride_in_bytes, unsigned int kernel_width)
+static void stbtt__v_prefilter_scalar(unsigned char *pixels, int w, int h, int stride_in_bytes, unsigned int kernel_width)
 {
    unsigned char buffer[STBTT_MAX_OVERSAMPLE];
    int safe_h = h - kernel_width;
@@ -3635,6 +4485,30 @@ static void stbtt__v_prefilter(unsigned char *pixels, int w, int h, int stride_i
    }
 }
 
+static void stbtt__h_prefilter(unsigned char *pixels, int w, int h, int stride_in_bytes, unsigned int kernel_width, int use_simd)
+{
+#ifdef STBTT__SSE2
+   if (use_simd && kernel_width >= 2 && kernel_width <= 8) {
+      stbtt__h_prefilter_sse2(pixels, w, h, stride_in_bytes, kernel_width);
+      return;
+   }
+#endif
+   STBTT__NOTUSED(use_simd);
+   stbtt__h_prefilter_scalar(pixels, w, h, stride_in_bytes, kernel_width);
+}
+
+static void stbtt__v_prefilter(unsigned char *pixels, int w, int h, int stride_in_bytes, unsigned int kernel_width, int use_simd)
+{
+#ifdef STBTT__SSE2
+   if (use_simd && kernel_width >= 2 && kernel_width <= 8) {
+      stbtt__v_prefilter_sse2(pixels, w, h, stride_in_bytes, kernel_width);
+      return;
+   }
+#endif
+   STBTT__NOTUSED(use_simd);
+   stbtt__v_prefilter_scalar(pixels, w, h, stride_in_bytes, kernel_width);
+}
+
 static float stbtt__oversample_shift(int oversample)
 {
    if (!oversample)
@@ -3662,6 +4536,23 @@ STBTT_DEF int stbtt_PackFontRangesGatherRects(stbtt_pack_context *spc, const stb
          int x0,y0,x1,y1;
          int codepoint = ranges[i].array_of_unicode_codepoints == NULL ? ranges[i].first_unicode_codepoint_in_range + j : ranges[i].array_of_unicode_codepoints[j];
          int glyph = stbtt_FindGlyphIndex(info, codepoint);
+         if (spc->lcd) {
+            // the glyph box is looked up only here, it is parked in the packed char until
+            // stbtt_PackFontRangesRenderIntoRects() rasterizes the glyph and fills it in
+            stbtt_packedchar *bc = &ranges[i].chardata_for_range[j];
+            int box[4] = { 0, 0, 0, 0 };
+            stbtt_GetGlyphBox(info, glyph, &box[0], &box[1], &box[2], &box[3]);
+            bc->xoff  = (float) box[0];
+            bc->yoff  = (float) box[1];
+            bc->xoff2 = (float) box[2];
+            bc->yoff2 = (float) box[3];
+            // the size in pixels, the 3x horizontal resolution is in the 3 bytes of each pixel
+            stbtt_GetBitmapBoxForGlyphBox(box[0], box[1], box[2], box[3], scale, scale, 0,0, &x0,&y0,&x1,&y1);
+            rects[k].w = (stbrp_coord) (x1-x0 + STBTT__LCD_PADDING + spc->padding);
+            rects[k].h = (stbrp_coord) (y1-y0 + spc->padding);
+            ++k;
+            continue;
+         }
          stbtt_GetGlyphBitmapBoxSubpixel(info,glyph,
                                          scale * spc->h_oversample,
                                          scale * spc->v_oversample,
@@ -3690,20 +4581,101 @@ STBTT_DEF void stbtt_MakeGlyphBitmapSubpixelPrefilter(const stbtt_fontinfo *info
                                  glyph);
 
    if (prefilter_x > 1)
-      stbtt__h_prefilter(output, out_w, out_h, out_stride, prefilter_x);
+      stbtt__h_prefilter(output, out_w, out_h, out_stride, prefilter_x, 1);
 
    if (prefilter_y > 1)
-      stbtt__v_prefilter(output, out_w, out_h, out_stride, prefilter_y);
+      stbtt__v_prefilter(output, out_w, out_h, out_stride, prefilter_y, 1);
 
    *sub_x = stbtt__oversample_shift(prefilter_x);
    *sub_y = stbtt__oversample_shift(prefilter_y);
 }
 
+// LCD mode of stbtt_PackFontRangesRenderIntoRects: all characters go into one batch
+static int stbtt__pack_render_lcd(stbtt_pack_context *spc, const stbtt_fontinfo *info, stbtt_pack_range *ranges, int num_ranges, stbrp_rect *rects)
+{
+   int i,j,k,n=0, return_value = 1;
+   stbtt_glyph_request *requests;
+
+   for (i=0; i < num_ranges; ++i)
+      n += ranges[i].num_chars;
+   requests = (stbtt_glyph_request *) STBTT_malloc(sizeof(*requests) * n, spc->user_allocator_context);
+   if (requests == NULL)
+      return 0;
+
+   k = 0;
+   n = 0;
+   for (i=0; i < num_ranges; ++i) {
+      float fh = ranges[i].font_size;
+      float scale = fh > 0 ? stbtt_ScaleForPixelHeight(info, fh) : stbtt_ScaleForMappingEmToPixels(info, -fh);
+      for (j=0; j < ranges[i].num_chars; ++j) {
+         stbrp_rect *r = &rects[k];
+         if (r->was_packed) {
+            stbtt_packedchar *bc = &ranges[i].chardata_for_range[j];
+            int advance, x0,y0,sub_x0;
+            int codepoint = ranges[i].array_of_unicode_codepoints == NULL ? ranges[i].first_unicode_codepoint_in_range + j : ranges[i].array_of_unicode_codepoints[j];
+            int glyph = stbtt_FindGlyphIndex(info, codepoint);
+            stbrp_coord pad = (stbrp_coord) spc->padding;
+            stbtt_glyph_request *q = &requests[n++];
+
+            // pad on left and top
+            r->x += pad;
+            r->y += pad;
+            r->w -= pad;
+            r->h -= pad;
+            // the glyph box of stbtt_PackFontRangesGatherRects() serves both bitmap boxes and the rasterization
+            stbtt_GetGlyphHMetrics(info, glyph, &advance, NULL);
+            q->box[0] = (int) bc->xoff;
+            q->box[1] = (int) bc->yoff;
+            q->box[2] = (int) bc->xoff2;
+            q->box[3] = (int) bc->yoff2;
+            q->has_box = 1;
+            stbtt_GetBitmapBoxForGlyphBox(q->box[0], q->box[1], q->box[2], q->box[3], scale, scale, 0,0, &x0,&y0,0,0);
+            // the glyph is rasterized at 3x, so it starts at this subpixel relative to the pen
+            stbtt_GetBitmapBoxForGlyphBox(q->box[0], q->box[1], q->box[2], q->box[3], scale*3, scale, 0,0, &sub_x0,0,0,0);
+
+            // the rectangle in bytes, that is subpixels
+            q->glyph   = glyph;
+            q->scale_x = scale*3;
+            q->scale_y = scale;
+            q->shift_x = 0;
+            q->shift_y = 0;
+            q->x       = r->x*3;
+            q->y       = r->y;
+            q->w       = r->w*3;
+            q->h       = r->h;
+            q->glyph_x = STBTT__LCD_LEFT_PADDING*3;
+
+            bc->x0       = (stbtt_int16)  r->x;
+            bc->y0       = (stbtt_int16)  r->y;
+            bc->x1       = (stbtt_int16) (r->x + r->w);
+            bc->y1       = (stbtt_int16) (r->y + r->h);
+            bc->xadvance =                scale * advance;
+            bc->xoff     =                sub_x0 / 3.0f - STBTT__LCD_LEFT_PADDING;
+            bc->yoff     =       (float)  y0;
+            bc->xoff2    =                bc->xoff + r->w;
+            bc->yoff2    =       (float) (y0 + r->h);
+         } else {
+            return_value = 0; // if any fail, report failure
+         }
+
+         ++k;
+      }
+   }
+
+   stbtt_MakeGlyphBitmapBatch(info, spc->pixels, spc->stride_in_bytes, requests, n, STBTT_BATCH_LCD_FILTER);
+
+   STBTT_free(requests, spc->user_allocator_context);
+   return return_value;
+}
+
 // rects array must be big enough to accommodate all characters in the given ranges
 STBTT_DEF int stbtt_PackFontRangesRenderIntoRects(stbtt_pack_context *spc, const stbtt_fontinfo *info, stbtt_pack_range *ranges, int num_ranges, stbrp_rect *rects)
 {
    int i,j,k, return_value = 1;
 
+   if (spc->lcd)
+      return stbtt__pack_render_lcd(spc, info, ranges, num_ranges, rects);
+
    // save current values
    int old_h_over = spc->h_oversample;
    int old_v_over = spc->v_oversample;
@@ -3751,12 +4723,12 @@ STBTT_DEF int stbtt_PackFontRangesRenderIntoRects(stbtt_pack_context *spc, const
             if (spc->h_oversample > 1)
                stbtt__h_prefilter(spc->pixels + r->x + r->y*spc->stride_in_bytes,
                                   r->w, r->h, spc->stride_in_bytes,
-                                  spc->h_oversample);
+                                  spc->h_oversample, spc->simd_prefilter);
 
             if (spc->v_oversample > 1)
                stbtt__v_prefilter(spc->pixels + r->x + r->y*spc->stride_in_bytes,
                                   r->w, r->h, spc->stride_in_bytes,
-                                  spc->v_oversample);
+                                  spc->v_oversample, spc->simd_prefilter);
 
             bc->x0       = (stbtt_int16)  r->x;
             bc->y0       = (stbtt_int16)  r->y;